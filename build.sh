@@ -65,6 +65,7 @@ dobuild speedtest \
 -DBUILD_FUZZERS=Off \
 -DBUILD_UNITTESTS=Off \
 -DBUILD_SPEED_TESTS=On \
+-DBUILD_TOOLS=On \
 -DBUILD_EXHAUSTIVE_TESTS=Off \
 -DCMAKE_BUILD_TYPE=Release \
 -DFUZZ_LINKMAIN=On
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "safe_duration_cast/chronoconv.hpp"
+#include "safe_duration_cast/safe_range.hpp"
 
 #include <cassert>
 #include <limits>
@@ -28,6 +29,9 @@ testAll()
     using ToDur = std::chrono::duration<To, ToPeriod>;
     const FromDur from{ f };
     const auto to = safe_duration_cast::safe_duration_cast<ToDur>(from, ec);
+    // the safe range must agree exactly with the runtime check
+    assert(((ec == 0) ==
+            safe_duration_cast::safe_range<FromDur, ToDur>::contains(from)));
     if (ec == 0) {
       const auto ref = std::chrono::duration_cast<ToDur>(from);
       assert(to == ref);
@@ -7,6 +7,7 @@
  *
  * exhaustive tests for float types, to cover all 2^32 possible
  * float values, validating them against std::chrono:duration_cast.
+ * both floating point and integral targets are tested.
  */
 #include <iostream>
 
@@ -17,7 +18,9 @@
 #include <cstring>
 #include <future>
 #include <limits>
+#include <ratio>
 #include <thread>
+#include <type_traits>
 #include <vector>
 #include <cfenv>
 
@@ -64,6 +67,31 @@ testAll(const unsigned threadIndex, const unsigned Nthreads)
       }
       ++ret.passed;
     } else {
+      // an integral target must really be unable to hold the value. it is
+      // scaled in float, like duration_cast does, since the exact product
+      // may round past the limit. the bounds compare exactly in long double.
+      if (std::is_integral<To>::value &&
+          std::numeric_limits<long double>::digits >= 64) {
+        using Factor = std::ratio_divide<std::ratio<1>, ToPeriod>;
+        From scaled = tmp;
+        if (Factor::num != 1) {
+          scaled *= Factor::num;
+        }
+        if (Factor::den != 1) {
+          scaled /= Factor::den;
+        }
+        const long double lo =
+          static_cast<long double>(std::numeric_limits<To>::min()) - 1;
+        const long double hi =
+          static_cast<long double>(std::numeric_limits<To>::max()) + 1;
+        const long double wide = scaled;
+        if (!std::isnan(wide) && wide > lo && wide < hi) {
+          std::cout << "false rejection in " << __PRETTY_FUNCTION__
+                    << ": loopvar=" << f << "=" << tmp
+                    << " scaled=" << static_cast<double>(scaled) << std::endl;
+          std::abort();
+        }
+      }
       ++ret.problematic;
     }
   };
@@ -121,5 +149,10 @@ main()
   runThreaded<double, std::ratio<3, 5>>(nthreads);
   runThreaded<double, std::ratio<1, 1>>(nthreads);
   runThreaded<double, std::ratio<5, 3>>(nthreads);
+  runThreaded<std::int32_t, std::ratio<3, 5>>(nthreads);
+  runThreaded<std::int32_t, std::milli>(nthreads);
+  runThreaded<std::int64_t, std::nano>(nthreads);
+  runThreaded<std::uint64_t, std::ratio<1, 1>>(nthreads);
+  runThreaded<std::uint16_t, std::ratio<5, 3>>(nthreads);
   return 0;
 }
@@ -0,0 +1,145 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * exhaustive tests for conversion from integral to floating point, to cover
+ * all 2^32 possible int32 values, validating them against
+ * std::chrono:duration_cast. the exactness reported by exact_duration_cast
+ * is verified with long double arithmetic.
+ */
+#include <iostream>
+
+#include "safe_duration_cast/chronoconv.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <future>
+#include <limits>
+#include <thread>
+#include <vector>
+
+using Count = std::int64_t;
+
+struct Outcome
+{
+  Count passed = 0;
+  Count inexact = 0;
+  // exact, but reported as inexact since the count had to be rounded
+  Count conservative = 0;
+};
+
+template<class To, class ToPeriod>
+Outcome
+testAll(const unsigned threadIndex, const unsigned Nthreads)
+{
+  assert(threadIndex < Nthreads);
+  using LoopVar = std::uint32_t;
+  using From = std::int32_t;
+  static_assert(sizeof(LoopVar) == sizeof(From), "size assumption");
+
+  Outcome ret;
+  auto body = [&ret](const LoopVar i) {
+    using FromDur = std::chrono::duration<From>;
+    using ToDur = std::chrono::duration<To, ToPeriod>;
+    using Factor = std::ratio_divide<std::ratio<1>, ToPeriod>;
+    const FromDur from{ static_cast<From>(i) };
+
+    int ec = 0;
+    const auto to = safe_duration_cast::safe_duration_cast<ToDur>(from, ec);
+    const auto ref = std::chrono::duration_cast<ToDur>(from);
+    if (ec != 0 || to != ref) {
+      std::cout << "failed test in " << __PRETTY_FUNCTION__
+                << ": from=" << from.count() << " to=" << to.count()
+                << " ref=" << ref.count() << " ec=" << ec << std::endl;
+      std::abort();
+    }
+
+    // the result is exact if to*den==from*num. both sides are exact in
+    // long double, for the small ratios tested here.
+    const bool exact = static_cast<long double>(to.count()) * Factor::den ==
+                       static_cast<long double>(from.count()) * Factor::num;
+    int exact_ec = 0;
+    const auto exact_to =
+      safe_duration_cast::exact_duration_cast<ToDur>(from, exact_ec);
+    const bool rounded_count =
+      static_cast<std::int64_t>(static_cast<To>(from.count())) != from.count();
+    if (exact && exact_ec == 2 && rounded_count) {
+      ++ret.conservative;
+      return;
+    }
+    if (exact ? (exact_ec != 0 || exact_to != to) : (exact_ec != 2)) {
+      std::cout << "failed exactness test in " << __PRETTY_FUNCTION__
+                << ": from=" << from.count() << " to=" << to.count()
+                << " ec=" << exact_ec << std::endl;
+      std::abort();
+    }
+    if (exact) {
+      ++ret.passed;
+    } else {
+      ++ret.inexact;
+    }
+  };
+
+  // execute the loop body once for each possible value and
+  // also not overflowing the loop variable
+  const auto min = std::numeric_limits<LoopVar>::min();
+  const auto max = std::numeric_limits<LoopVar>::max();
+  const auto blocksize = (std::uint64_t{ max } - min + 1) / Nthreads;
+  const auto begin = threadIndex * blocksize + min;
+  const auto beforeend = [=]() {
+    if (threadIndex + 1 == Nthreads) {
+      return max;
+    } else {
+      return static_cast<LoopVar>(begin + blocksize - 1);
+    }
+  }();
+  for (LoopVar i = static_cast<LoopVar>(begin); i < beforeend; ++i) {
+    body(i);
+  }
+  body(beforeend);
+
+  return ret;
+}
+
+template<class To, class ToPeriod>
+Outcome
+runThreaded(const unsigned Nthreads)
+{
+  std::vector<std::future<Outcome>> results(Nthreads);
+
+  for (unsigned i = 0; i < Nthreads; ++i) {
+    results[i] = std::async(
+      std::launch::async, [=]() { return testAll<To, ToPeriod>(i, Nthreads); });
+  }
+  Outcome sum;
+  for (unsigned i = 0; i < Nthreads; ++i) {
+    const auto Partial = results[i].get();
+    sum.inexact += Partial.inexact;
+    sum.conservative += Partial.conservative;
+    sum.passed += Partial.passed;
+  }
+  std::cout << __PRETTY_FUNCTION__ << " inexact=" << sum.inexact
+            << "\tconservative=" << sum.conservative
+            << "\tpassed=" << sum.passed << std::endl;
+
+  return sum;
+}
+
+int
+main()
+{
+  const auto nthreads = std::thread::hardware_concurrency();
+  runThreaded<float, std::ratio<3, 5>>(nthreads);
+  runThreaded<float, std::ratio<1, 1>>(nthreads);
+  runThreaded<float, std::ratio<5, 3>>(nthreads);
+  runThreaded<float, std::kilo>(nthreads);
+  runThreaded<double, std::ratio<3, 5>>(nthreads);
+  runThreaded<double, std::ratio<1, 1>>(nthreads);
+  runThreaded<double, std::ratio<5, 3>>(nthreads);
+  runThreaded<double, std::kilo>(nthreads);
+  return 0;
+}
@@ -0,0 +1,388 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_ANY_DURATION_HPP_
+#define INCLUDE_ANY_DURATION_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ratio>
+#include <tuple>
+#include <type_traits>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+
+namespace safe_duration_cast {
+
+// the units an any_duration can have
+enum class duration_unit : unsigned char
+{
+  nanoseconds,
+  microseconds,
+  milliseconds,
+  seconds,
+  minutes,
+  hours,
+  days
+};
+
+// the representations an any_duration can have
+enum class duration_rep : unsigned char
+{
+  int32,
+  int64,
+  float64
+};
+
+namespace detail {
+
+// the periods and reps, in the order of the enums above
+using any_periods = std::tuple<std::nano,
+                               std::micro,
+                               std::milli,
+                               std::ratio<1>,
+                               std::ratio<60>,
+                               std::ratio<3600>,
+                               std::ratio<86400>>;
+using any_reps = std::tuple<std::int32_t, std::int64_t, double>;
+
+constexpr std::size_t any_period_count = std::tuple_size<any_periods>::value;
+constexpr std::size_t any_rep_count = std::tuple_size<any_reps>::value;
+
+// the index of T in the tuple List, or the size of List if it is not there
+template<typename T, typename List>
+struct index_in;
+template<typename T>
+struct index_in<T, std::tuple<>> : std::integral_constant<std::size_t, 0>
+{};
+template<typename T, typename Head, typename... Tail>
+struct index_in<T, std::tuple<Head, Tail...>>
+  : std::integral_constant<
+      std::size_t,
+      std::is_same<T, Head>::value
+        ? 0
+        : 1 + index_in<T, std::tuple<Tail...>>::value>
+{};
+
+// ratio<1000,1000> is another type than ratio<1>, so look at the reduced
+// period
+template<typename Period>
+using any_period_index = index_in<std::ratio<Period::num, Period::den>,
+                                  any_periods>;
+
+struct any_duration_access;
+
+} // namespace detail
+
+/**
+ * a duration with one of the units and representations above, chosen at
+ * runtime. it takes 16 bytes, the count and a tag for the unit and one for
+ * the representation, so it can be stored in configs and arrays.
+ *
+ * convert it to a duration type with safe_duration_cast, which dispatches
+ * on the tags through a table of the conversions for all combinations.
+ */
+class any_duration
+{
+public:
+  // zero seconds
+  any_duration()
+    : m_bits()
+    , m_unit(duration_unit::seconds)
+    , m_rep(duration_rep::int64)
+  {}
+
+  template<typename Rep, typename Period>
+  any_duration(std::chrono::duration<Rep, Period> d)
+    : m_bits()
+    , m_unit(static_cast<duration_unit>(
+        detail::any_period_index<Period>::value))
+    , m_rep(static_cast<duration_rep>(
+        detail::index_in<Rep, detail::any_reps>::value))
+  {
+    static_assert(detail::any_period_index<Period>::value <
+                    detail::any_period_count,
+                  "the period is not supported by any_duration");
+    static_assert(detail::index_in<Rep, detail::any_reps>::value <
+                    detail::any_rep_count,
+                  "the representation is not supported by any_duration");
+    const Rep count = d.count();
+    std::memcpy(&m_bits, &count, sizeof(count));
+  }
+
+  duration_unit unit() const { return m_unit; }
+  duration_rep rep() const { return m_rep; }
+
+private:
+  friend struct detail::any_duration_access;
+
+  // the count, stored as bytes so any of the representations fit
+  std::uint64_t m_bits;
+  duration_unit m_unit;
+  duration_rep m_rep;
+};
+
+static_assert(sizeof(any_duration) == 16, "any_duration should be 16 bytes");
+
+namespace detail {
+
+struct any_duration_access
+{
+  // the count, read as if the representation was Rep
+  template<typename Rep>
+  static Rep count(const any_duration& d)
+  {
+    Rep count;
+    std::memcpy(&count, &d.m_bits, sizeof(count));
+    return count;
+  }
+
+  // the unit and representation in one index, unit*any_rep_count+rep
+  static unsigned tag(const any_duration& d)
+  {
+    return static_cast<unsigned>(d.m_unit) * any_rep_count +
+           static_cast<unsigned>(d.m_rep);
+  }
+
+  // the unit and representation, cheaper to compare than the tag
+  static unsigned key(const any_duration& d)
+  {
+    return static_cast<unsigned>(d.m_unit) |
+           static_cast<unsigned>(d.m_rep) << 8;
+  }
+};
+
+// converts d, known to have Rep and Period
+template<typename To, typename Rep, typename Period>
+To
+any_cast_entry(const any_duration& d, int& ec)
+{
+  using From = std::chrono::duration<Rep, Period>;
+  using FromTag = typename dispatch_tags<From, To>::FromTag;
+  using ToTag = typename dispatch_tags<From, To>::ToTag;
+  ec = 0;
+  return safe_duration_cast_dispatch<To>(
+    From{ any_duration_access::count<Rep>(d) }, ec, FromTag{}, ToTag{});
+}
+
+/**
+ * converts a block (at most batch_block_size) of elements, if they all have
+ * the tag of the first one, known to be Rep and Period. they are copied to
+ * an array of From while checking the tags, and converted with the kernel
+ * for From. returns false, without converting, if the tags differ.
+ */
+template<typename To, typename Rep, typename Period>
+bool
+any_cast_uniform(const any_duration* in,
+                 std::size_t len,
+                 To* out,
+                 std::uint64_t& bits)
+{
+  using From = std::chrono::duration<Rep, Period>;
+  // already true, but tells the compiler the conversion below is one block
+  len = std::min(len, batch_block_size);
+  From from[batch_block_size];
+  const unsigned key = any_duration_access::key(in[0]);
+  bool mixed = false;
+  for (std::size_t j = 0; j < len; ++j) {
+    from[j] = From{ any_duration_access::count<Rep>(in[j]) };
+    mixed |= any_duration_access::key(in[j]) != key;
+  }
+  if (mixed) {
+    return false;
+  }
+  safe_duration_cast_n(from, out, len, &bits);
+  return true;
+}
+
+/**
+ * converts the elements of a block which have the given tag, known to be Rep
+ * and Period. they are gathered to an array of From, converted with the
+ * kernel for From, and scattered back. returns the failure bits, at the
+ * positions in the block.
+ */
+template<typename To, typename Rep, typename Period>
+std::uint64_t
+any_cast_group(const any_duration* in,
+               const unsigned char* tags,
+               std::size_t len,
+               unsigned char tag,
+               To* out)
+{
+  using From = std::chrono::duration<Rep, Period>;
+  From from[batch_block_size] = {};
+  unsigned char pos[batch_block_size];
+  std::size_t k = 0;
+  for (std::size_t j = 0; j < len; ++j) {
+    // always written, but only kept if the tag matches
+    pos[k] = static_cast<unsigned char>(j);
+    from[k] = From{ any_duration_access::count<Rep>(in[j]) };
+    k += tags[j] == tag;
+  }
+  To to[batch_block_size];
+  std::uint64_t bits = 0;
+  safe_duration_cast_n(from, to, k, &bits);
+  std::uint64_t failed = 0;
+  for (std::size_t i = 0; i < k; ++i) {
+    out[pos[i]] = to[i];
+    failed |= ((bits >> i) & 1U) << pos[i];
+  }
+  return failed;
+}
+
+template<typename To>
+using any_cast_fn = To (*)(const any_duration&, int&);
+
+template<typename To>
+using any_group_fn = std::uint64_t (*)(const any_duration*,
+                                       const unsigned char*,
+                                       std::size_t,
+                                       unsigned char,
+                                       To*);
+
+template<typename To>
+using any_uniform_fn = bool (*)(const any_duration*,
+                                std::size_t,
+                                To*,
+                                std::uint64_t&);
+
+template<std::size_t I>
+using any_rep_t = typename std::tuple_element<I, any_reps>::type;
+
+/**
+ * the conversions to To for all units and representations, indexed by
+ * [unit][rep]. one row per period.
+ */
+template<typename To, typename Periods = any_periods>
+struct any_cast_table;
+
+template<typename To, typename... Periods>
+struct any_cast_table<To, std::tuple<Periods...>>
+{
+  static_assert(any_rep_count == 3, "update the columns below");
+
+  static constexpr any_cast_fn<To> scalar[sizeof...(Periods)][any_rep_count] =
+    { { &any_cast_entry<To, any_rep_t<0>, Periods>,
+        &any_cast_entry<To, any_rep_t<1>, Periods>,
+        &any_cast_entry<To, any_rep_t<2>, Periods> }... };
+
+  static constexpr any_uniform_fn<To>
+    uniform[sizeof...(Periods)][any_rep_count] = {
+      { &any_cast_uniform<To, any_rep_t<0>, Periods>,
+        &any_cast_uniform<To, any_rep_t<1>, Periods>,
+        &any_cast_uniform<To, any_rep_t<2>, Periods> }...
+    };
+
+  static constexpr any_group_fn<To> group[sizeof...(Periods)][any_rep_count] =
+    { { &any_cast_group<To, any_rep_t<0>, Periods>,
+        &any_cast_group<To, any_rep_t<1>, Periods>,
+        &any_cast_group<To, any_rep_t<2>, Periods> }... };
+};
+
+template<typename To, typename... Periods>
+constexpr any_cast_fn<To> any_cast_table<To, std::tuple<Periods...>>::scalar
+  [sizeof...(Periods)][any_rep_count];
+
+template<typename To, typename... Periods>
+constexpr any_uniform_fn<To> any_cast_table<To, std::tuple<Periods...>>::uniform
+  [sizeof...(Periods)][any_rep_count];
+
+template<typename To, typename... Periods>
+constexpr any_group_fn<To> any_cast_table<To, std::tuple<Periods...>>::group
+  [sizeof...(Periods)][any_rep_count];
+
+} // namespace detail
+
+/**
+ * converts an any_duration to To, the same way safe_duration_cast converts
+ * the duration it holds.
+ */
+template<typename To>
+To
+safe_duration_cast(const any_duration& from, int& ec)
+{
+  static_assert(detail::is_duration(To{}), "To is not a duration");
+  using Table = detail::any_cast_table<To>;
+  return Table::scalar[static_cast<std::size_t>(from.unit())]
+                      [static_cast<std::size_t>(from.rep())](from, ec);
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing version
+template<typename To>
+To
+safe_duration_cast(const any_duration& from)
+{
+  int ec = 0;
+  auto ret = safe_duration_cast<To>(from, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return ret;
+}
+#endif
+
+/**
+ * converts n any_durations from in to out, the same way safe_duration_cast
+ * does. failmask and the returned summary work as for the other
+ * safe_duration_cast_n.
+ *
+ * each block of elements is grouped by unit and representation, and each
+ * group is converted with the kernel for its type. arrays where the tags
+ * are the same, or change seldom, are converted almost as fast as arrays of
+ * the duration type itself.
+ */
+template<typename To>
+batch_result
+safe_duration_cast_n(const any_duration* in,
+                     To* out,
+                     std::size_t n,
+                     std::uint64_t* failmask = nullptr)
+{
+  static_assert(detail::is_duration(To{}), "To is not a duration");
+  static_assert(detail::any_period_count * detail::any_rep_count <= 32,
+                "the tags must fit in the mask");
+  using Table = detail::any_cast_table<To>;
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += detail::batch_block_size) {
+    const std::size_t len = std::min(detail::batch_block_size, n - first);
+    // most blocks have a single tag, so that is tried first
+    const any_duration* block = in + first;
+    const unsigned first_tag = detail::any_duration_access::tag(block[0]);
+    std::uint64_t bits = 0;
+    if (!Table::uniform[first_tag / detail::any_rep_count]
+                       [first_tag % detail::any_rep_count](
+                         block, len, out + first, bits)) {
+      unsigned char tags[detail::batch_block_size];
+      std::uint32_t present = 0;
+      for (std::size_t j = 0; j < len; ++j) {
+        const unsigned tag = detail::any_duration_access::tag(block[j]);
+        tags[j] = static_cast<unsigned char>(tag);
+        present |= std::uint32_t{ 1 } << tag;
+      }
+      for (; present != 0; present &= present - 1) {
+        const int tag = detail::countr_zero64(present);
+        bits |= Table::group[tag / detail::any_rep_count]
+                            [tag % detail::any_rep_count](
+                              block,
+                              tags,
+                              len,
+                              static_cast<unsigned char>(tag),
+                              out + first);
+      }
+    }
+    detail::record_block(result, failmask, first, bits);
+  }
+  return result;
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_ANY_DURATION_HPP_ */
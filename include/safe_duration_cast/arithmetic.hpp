@@ -0,0 +1,251 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_ARITHMETIC_HPP_
+#define INCLUDE_ARITHMETIC_HPP_
+
+#include <chrono>
+#include <type_traits>
+#include <utility>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/checked_arithmetic.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * Arithmetic on durations which reports overflow instead of giving the wrong
+ * result. The operands are converted to the same type as the std::chrono
+ * operators use (the common type of the durations, or the common type of
+ * the representations), with safe_duration_cast, and then combined with an
+ * overflow check.
+ *
+ * On failure, ec is set and the result is zero. The checks select the result
+ * instead of returning early, so a loop of these can be vectorized as long as
+ * the conversion to the common type is a no-op.
+ */
+namespace detail {
+
+// converts a count to Rep, with the rules of safe_duration_cast
+template<typename Rep, typename From>
+SDC_RELAXED_CONSTEXPR Rep
+safe_rep_cast(From from, int& ec)
+{
+  return safe_duration_cast<std::chrono::duration<Rep>>(
+           std::chrono::duration<From>{ from }, ec)
+    .count();
+}
+
+// combines the error codes of converting the operands and of the operation
+template<typename Result>
+SDC_RELAXED_CONSTEXPR Result
+select_result(Result result, int ec1, int ec2, bool failed, int& ec)
+{
+  ec = ec1 ? ec1 : (ec2 ? ec2 : (failed ? 1 : 0));
+  return ec ? Result{} : result;
+}
+
+// the common duration of two durations
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+using common_duration_t =
+  typename std::common_type<std::chrono::duration<Rep1, Period1>,
+                            std::chrono::duration<Rep2, Period2>>::type;
+
+// the duration a duration times a scalar gives
+template<typename Rep1, typename Period, typename Rep2>
+using scaled_duration_t =
+  std::chrono::duration<typename std::common_type<Rep1, Rep2>::type, Period>;
+
+} // namespace detail
+
+// a + b
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR detail::common_duration_t<Rep1, Period1, Rep2, Period2>
+safe_add(std::chrono::duration<Rep1, Period1> a,
+         std::chrono::duration<Rep2, Period2> b,
+         int& ec)
+{
+  using Common = detail::common_duration_t<Rep1, Period1, Rep2, Period2>;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Common x = safe_duration_cast<Common>(a, ec1);
+  const Common y = safe_duration_cast<Common>(b, ec2);
+  typename Common::rep sum{};
+  const bool failed = detail::checked_add(x.count(), y.count(), sum);
+  return detail::select_result(Common{ sum }, ec1, ec2, failed, ec);
+}
+
+// a - b
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR detail::common_duration_t<Rep1, Period1, Rep2, Period2>
+safe_sub(std::chrono::duration<Rep1, Period1> a,
+         std::chrono::duration<Rep2, Period2> b,
+         int& ec)
+{
+  using Common = detail::common_duration_t<Rep1, Period1, Rep2, Period2>;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Common x = safe_duration_cast<Common>(a, ec1);
+  const Common y = safe_duration_cast<Common>(b, ec2);
+  typename Common::rep difference{};
+  const bool failed = detail::checked_sub(x.count(), y.count(), difference);
+  return detail::select_result(Common{ difference }, ec1, ec2, failed, ec);
+}
+
+// d * k
+template<typename Rep1, typename Period, typename Rep2>
+SDC_RELAXED_CONSTEXPR detail::scaled_duration_t<Rep1, Period, Rep2>
+safe_mul(std::chrono::duration<Rep1, Period> d, Rep2 k, int& ec)
+{
+  using Result = detail::scaled_duration_t<Rep1, Period, Rep2>;
+  using Rep = typename Result::rep;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Rep x = detail::safe_rep_cast<Rep>(d.count(), ec1);
+  const Rep y = detail::safe_rep_cast<Rep>(k, ec2);
+  Rep product{};
+  const bool failed = detail::checked_mul(x, y, product);
+  return detail::select_result(Result{ product }, ec1, ec2, failed, ec);
+}
+
+// d / k. dividing by zero is an error.
+template<typename Rep1,
+         typename Period,
+         typename Rep2,
+         typename std::enable_if<!detail::is_duration(Rep2{}), int>::type = 0>
+SDC_RELAXED_CONSTEXPR detail::scaled_duration_t<Rep1, Period, Rep2>
+safe_div(std::chrono::duration<Rep1, Period> d, Rep2 k, int& ec)
+{
+  using Result = detail::scaled_duration_t<Rep1, Period, Rep2>;
+  using Rep = typename Result::rep;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Rep x = detail::safe_rep_cast<Rep>(d.count(), ec1);
+  const Rep y = detail::safe_rep_cast<Rep>(k, ec2);
+  Rep quotient{};
+  const bool failed = detail::checked_div(x, y, quotient);
+  return detail::select_result(Result{ quotient }, ec1, ec2, failed, ec);
+}
+
+// a / b, the number of times b fits in a. dividing by zero is an error.
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR
+  typename detail::common_duration_t<Rep1, Period1, Rep2, Period2>::rep
+  safe_div(std::chrono::duration<Rep1, Period1> a,
+           std::chrono::duration<Rep2, Period2> b,
+           int& ec)
+{
+  using Common = detail::common_duration_t<Rep1, Period1, Rep2, Period2>;
+  using Rep = typename Common::rep;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Common x = safe_duration_cast<Common>(a, ec1);
+  const Common y = safe_duration_cast<Common>(b, ec2);
+  Rep quotient{};
+  const bool failed = detail::checked_div(x.count(), y.count(), quotient);
+  return detail::select_result(quotient, ec1, ec2, failed, ec);
+}
+
+// d % k, for integral representations. k being zero is an error.
+template<typename Rep1,
+         typename Period,
+         typename Rep2,
+         typename std::enable_if<!detail::is_duration(Rep2{}), int>::type = 0>
+SDC_RELAXED_CONSTEXPR detail::scaled_duration_t<Rep1, Period, Rep2>
+safe_mod(std::chrono::duration<Rep1, Period> d, Rep2 k, int& ec)
+{
+  using Result = detail::scaled_duration_t<Rep1, Period, Rep2>;
+  using Rep = typename Result::rep;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Rep x = detail::safe_rep_cast<Rep>(d.count(), ec1);
+  const Rep y = detail::safe_rep_cast<Rep>(k, ec2);
+  Rep remainder{};
+  const bool failed = detail::checked_mod(x, y, remainder);
+  return detail::select_result(Result{ remainder }, ec1, ec2, failed, ec);
+}
+
+// a % b, for integral representations. b being zero is an error.
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR detail::common_duration_t<Rep1, Period1, Rep2, Period2>
+safe_mod(std::chrono::duration<Rep1, Period1> a,
+         std::chrono::duration<Rep2, Period2> b,
+         int& ec)
+{
+  using Common = detail::common_duration_t<Rep1, Period1, Rep2, Period2>;
+  int ec1 = 0;
+  int ec2 = 0;
+  const Common x = safe_duration_cast<Common>(a, ec1);
+  const Common y = safe_duration_cast<Common>(b, ec2);
+  typename Common::rep remainder{};
+  const bool failed = detail::checked_mod(x.count(), y.count(), remainder);
+  return detail::select_result(Common{ remainder }, ec1, ec2, failed, ec);
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+namespace detail {
+template<typename Result>
+Result
+throw_on_error(Result result, int ec)
+{
+  if (ec) {
+    throw std::runtime_error("failed arithmetic");
+  }
+  return result;
+}
+} // namespace detail
+
+// throwing versions
+
+template<typename D1, typename D2>
+auto
+safe_add(D1 a, D2 b) -> decltype(safe_add(a, b, std::declval<int&>()))
+{
+  int ec = 0;
+  const auto result = safe_add(a, b, ec);
+  return detail::throw_on_error(result, ec);
+}
+
+template<typename D1, typename D2>
+auto
+safe_sub(D1 a, D2 b) -> decltype(safe_sub(a, b, std::declval<int&>()))
+{
+  int ec = 0;
+  const auto result = safe_sub(a, b, ec);
+  return detail::throw_on_error(result, ec);
+}
+
+template<typename D, typename Rep>
+auto
+safe_mul(D d, Rep k) -> decltype(safe_mul(d, k, std::declval<int&>()))
+{
+  int ec = 0;
+  const auto result = safe_mul(d, k, ec);
+  return detail::throw_on_error(result, ec);
+}
+
+template<typename D, typename T>
+auto
+safe_div(D d, T k) -> decltype(safe_div(d, k, std::declval<int&>()))
+{
+  int ec = 0;
+  const auto result = safe_div(d, k, ec);
+  return detail::throw_on_error(result, ec);
+}
+
+template<typename D, typename T>
+auto
+safe_mod(D d, T k) -> decltype(safe_mod(d, k, std::declval<int&>()))
+{
+  int ec = 0;
+  const auto result = safe_mod(d, k, ec);
+  return detail::throw_on_error(result, ec);
+}
+#endif
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_ARITHMETIC_HPP_ */
@@ -0,0 +1,91 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_BATCH_HPP_
+#define INCLUDE_BATCH_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/batch_kernel.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * the number of words needed in a failure mask for n elements.
+ */
+constexpr std::size_t
+batch_mask_words(std::size_t n)
+{
+  return (n + detail::batch_block_size - 1) / detail::batch_block_size;
+}
+
+/**
+ * converts n durations from in to out, the same way safe_duration_cast does.
+ *
+ * elements which can not be converted are set to zero in out, and get their
+ * bit set in failmask (bit i%64 of word i/64). failmask may be null, otherwise
+ * it must have room for batch_mask_words(n) words. in and out may be the same
+ * array, but must not otherwise overlap.
+ *
+ * the returned summary holds the number of failures and the index of the
+ * first one.
+ *
+ * integral conversions, and conversions from floating point to integral, go
+ * through a kernel which checks all elements without branching, so the loop
+ * can be vectorized. conversions which only
+ * scale signed 64 bit counts up use explicit simd instructions if the
+ * target has avx2 or avx512.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+batch_result
+safe_duration_cast_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+                     To* out,
+                     std::size_t n,
+                     std::uint64_t* failmask = nullptr)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  static_assert(detail::is_duration(To{}), "To is not a duration");
+
+  using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+  using ToTag = typename detail::dispatch_tags<From, To>::ToTag;
+  return detail::safe_duration_cast_n_dispatch<To>(
+    in, out, n, failmask, FromTag{}, ToTag{});
+}
+
+/**
+ * converts n durations from in to out, the same way exact_duration_cast
+ * does. elements which are out of range or would be truncated or rounded
+ * are set to zero in out and get their bit set in failmask. the ones which
+ * are in range but inexact also get their bit set in inexactmask. both masks
+ * may be null, otherwise they must have room for batch_mask_words(n) words.
+ * in and out may be the same array, but must not otherwise overlap.
+ *
+ * integral conversions use the kernel of safe_duration_cast_n, followed by
+ * a divisibility test without branches.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+batch_result
+exact_duration_cast_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+                      To* out,
+                      std::size_t n,
+                      std::uint64_t* failmask = nullptr,
+                      std::uint64_t* inexactmask = nullptr)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  static_assert(detail::is_duration(To{}), "To is not a duration");
+
+  using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+  using ToTag = typename detail::dispatch_tags<From, To>::ToTag;
+  return detail::exact_duration_cast_n_dispatch<To>(
+    in, out, n, failmask, inexactmask, FromTag{}, ToTag{});
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_BATCH_HPP_ */
@@ -0,0 +1,154 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_BUCKETIZE_HPP_
+#define INCLUDE_BUCKETIZE_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/detail/checked_arithmetic.hpp>
+#include <safe_duration_cast/detail/reciprocal.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+/**
+ * the bucket indices in Index, which are also representable in Rep.
+ */
+template<typename Rep, typename Index>
+struct bucket_index_range
+{
+  using R = std::numeric_limits<Rep>;
+  using I = std::numeric_limits<Index>;
+  static_assert(R::is_integer && I::is_integer,
+                "only integral types are supported");
+
+  static constexpr Rep lo()
+  {
+    // both lowest values are zero or negative
+    return R::is_signed && I::is_signed
+             ? (R::digits <= I::digits ? R::min() : static_cast<Rep>(I::min()))
+             : Rep{ 0 };
+  }
+  static constexpr Rep hi()
+  {
+    return static_cast<std::uintmax_t>(R::max()) <=
+               static_cast<std::uintmax_t>(I::max())
+             ? R::max()
+             : static_cast<Rep>(I::max());
+  }
+};
+
+/**
+ * maps time stamps to the index of the bucket they fall in, with buckets of
+ * a width known only at runtime. the width is divided by with a reciprocal,
+ * and the steps are checked without branching.
+ */
+template<typename Rep, typename Index>
+class bucketizer
+{
+  static_assert(std::is_integral<Rep>::value,
+                "only integral representations are supported");
+  static_assert(std::is_integral<Index>::value, "Index must be integral");
+  static_assert(std::numeric_limits<Rep>::digits <= 64,
+                "at most 64 bit representations are supported");
+
+public:
+  // a width which is not positive makes every time stamp fail
+  bucketizer(Rep width, Rep origin)
+    : m_valid(width > 0)
+    , m_reciprocal(width > 0 ? width : Rep{ 1 })
+    , m_width(width > 0 ? width : Rep{ 1 })
+    , m_origin(origin)
+  {}
+
+  // sets index to floor((ts-origin)/width). returns true on failure, and
+  // index is then zero.
+  bool bucket(Rep ts, Index& index) const
+  {
+    // wrapping arithmetic, also for types which promote to int
+    using U =
+      typename std::common_type<typename std::make_unsigned<Rep>::type,
+                                unsigned>::type;
+    using Range = bucket_index_range<Rep, Index>;
+    Rep offset;
+    const bool sub_failed = checked_sub(ts, m_origin, offset);
+    const Rep q = m_reciprocal.divide(offset);
+    // q*width does not overflow, its magnitude is at most that of offset
+    const Rep r = static_cast<Rep>(static_cast<U>(offset) -
+                                   static_cast<U>(q) * static_cast<U>(m_width));
+    // rounding towards minus infinity. q is not the lowest value if r is
+    // negative, since the width is then at least two.
+    const Rep floored = static_cast<Rep>(q - (r < 0 ? 1 : 0));
+    const bool failed = !m_valid || sub_failed || floored < Range::lo() ||
+                        floored > Range::hi();
+    index = failed ? Index{} : static_cast<Index>(floored);
+    return failed;
+  }
+
+private:
+  bool m_valid;
+  reciprocal<Rep> m_reciprocal;
+  Rep m_width;
+  Rep m_origin;
+};
+
+} // namespace detail
+
+/**
+ * the index of the bucket of width width, counted from origin, which ts
+ * falls in: floor((ts-origin)/width). ec is set if width is not positive,
+ * if ts-origin overflows the representation, or if the index does not fit
+ * in Index.
+ */
+template<typename Index = std::int64_t, typename Rep, typename Period>
+Index
+safe_bucket(std::chrono::duration<Rep, Period> ts,
+            std::chrono::duration<Rep, Period> width,
+            std::chrono::duration<Rep, Period> origin,
+            int& ec)
+{
+  Index index;
+  ec = detail::bucketizer<Rep, Index>(width.count(), origin.count())
+           .bucket(ts.count(), index)
+         ? 1
+         : 0;
+  return index;
+}
+
+/**
+ * computes the bucket index of n time stamps, like safe_bucket, into
+ * idx_out. failures are reported like for safe_duration_cast_n, and get
+ * index zero.
+ *
+ * the reciprocal of the width is computed once, so there is no division in
+ * the loop, and the loop has no branches.
+ */
+template<typename Rep, typename Period, typename Index>
+batch_result
+safe_bucketize(const std::chrono::duration<Rep, Period>* ts,
+               std::size_t n,
+               std::chrono::duration<Rep, Period> width,
+               std::chrono::duration<Rep, Period> origin,
+               Index* idx_out,
+               std::uint64_t* failmask = nullptr)
+{
+  const detail::bucketizer<Rep, Index> b(width.count(), origin.count());
+  // b is captured by value, so the compiler knows the stores to idx_out do
+  // not change it and keeps it in registers.
+  return detail::for_each_block(n, failmask, [b, ts, idx_out](std::size_t i) {
+    return b.bucket(ts[i].count(), idx_out[i]);
+  });
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_BUCKETIZE_HPP_ */
@@ -5,6 +5,8 @@
  * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
  * at your option).
  */
+#ifndef INCLUDE_CHRONOCONV_HPP_
+#define INCLUDE_CHRONOCONV_HPP_
 
 #include <safe_duration_cast/detail/chronoconv_detail.hpp>
 #include <safe_duration_cast/detail/stdutils.hpp>
@@ -38,8 +40,14 @@ namespace safe_duration_cast {
  * -Inf        |   -Inf
  *
  *
- * conversions between integral and floating point is not yet supported and wont
- * compile.
+ * for conversions from integral to floating point, the result is the same as
+ * std::chrono::duration_cast gives, unless it overflows in which case ec is
+ * set. counts beyond +-2^digits of the floating point type are rounded, use
+ * exact_duration_cast to detect that.
+ *
+ * for conversions from floating point to integral, the result is the same as
+ * std::chrono::duration_cast gives, that is the scaled value truncated
+ * towards zero. NaN, infinity and values out of range set ec.
  *
  * types not recognized as either integral or floating point (asking
  * std::numeric_limits), will result in a compilation failure.
@@ -58,31 +66,43 @@ safe_duration_cast(std::chrono::duration<FromRep, FromPeriod> from, int& ec)
   constexpr bool From_is_floating = detail::is_floating_duration(From{});
   constexpr bool To_is_floating = detail::is_floating_duration(To{});
 
-  static_assert(!(From_is_integral && To_is_floating),
-                "integral->float not supported yet");
-  static_assert(!(From_is_floating && To_is_integral),
-                "float->integral not supported yet");
-
   static_assert(From_is_floating || From_is_integral || To_is_floating ||
                   To_is_integral,
                 "conversion between non-arithmetic representations (see "
                 "std::is_arithmetic<>) is not supported");
 
-  using FromTag =
-    typename detail::conditional3<From_is_integral,
-                                  detail::tags::FromIsInt,
-                                  From_is_floating,
-                                  detail::tags::FromIsFloat,
-                                  detail::tags::NotArithmetic>::type;
-  using ToTag =
-    typename detail::conditional3<To_is_integral,
-                                  detail::tags::ToIsInt,
-                                  To_is_floating,
-                                  detail::tags::ToIsFloat,
-                                  detail::tags::NotArithmetic>::type;
+  using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+  using ToTag = typename detail::dispatch_tags<From, To>::ToTag;
   return detail::safe_duration_cast_dispatch<To>(from, ec, FromTag{}, ToTag{});
 }
 
+/**
+ * like safe_duration_cast, but also reports an error if the result is not
+ * exactly equal to the input. ec is set to 1 if the result is out of range,
+ * and 2 if it is in range but had to be truncated or rounded, for instance
+ * 1500 us to milliseconds. the result is zero in both cases.
+ *
+ * for integral conversions, the check is whether the denominator of the
+ * ratio divides the count, which is done with a multiplication by its
+ * inverse instead of a division. for floating point, the scaling is checked
+ * to be exact with fma, and values close to the subnormal range count as
+ * inexact. NaN and infinity are passed through as for safe_duration_cast.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+To
+exact_duration_cast(std::chrono::duration<FromRep, FromPeriod> from, int& ec)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  ec = 0;
+  static_assert(detail::is_duration(From{}), "From is not a duration");
+  static_assert(detail::is_duration(To{}), "To is not a duration");
+
+  using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+  using ToTag = typename detail::dispatch_tags<From, To>::ToTag;
+  return detail::exact_duration_cast_dispatch<To>(
+    from, ec, FromTag{}, ToTag{});
+}
+
 #if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
 // throwing version
 template<typename To, typename FromRep, typename FromPeriod>
@@ -98,3 +118,4 @@ safe_duration_cast(std::chrono::duration<FromRep, FromPeriod> from)
 } // func
 #endif
 } // namespace safe_duration_cast
+#endif /* INCLUDE_CHRONOCONV_HPP_ */
@@ -0,0 +1,263 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_COMPARE_HPP_
+#define INCLUDE_COMPARE_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/chronoconv_detail.hpp>
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_three_way_comparison) &&                                \
+  __cpp_lib_three_way_comparison >= 201907L
+#define SDC_HAVE_THREE_WAY_COMPARISON 1
+#include <compare>
+#else
+#define SDC_HAVE_THREE_WAY_COMPARISON 0
+#endif
+
+namespace safe_duration_cast {
+namespace detail {
+
+template<typename T>
+constexpr bool
+is_negative(T x, std::true_type /*is_signed*/)
+{
+  return x < 0;
+}
+template<typename T>
+constexpr bool
+is_negative(T /*x*/, std::false_type /*is_signed*/)
+{
+  return false;
+}
+template<typename T>
+constexpr bool
+is_negative(T x)
+{
+  return is_negative(
+    x, std::integral_constant<bool, std::numeric_limits<T>::is_signed>{});
+}
+
+// |x| in the unsigned type M
+template<typename M, typename T>
+constexpr M
+magnitude(T x)
+{
+  return is_negative(x) ? static_cast<M>(M{ 0 } - static_cast<M>(x))
+                        : static_cast<M>(x);
+}
+
+/**
+ * compares the fractions a/b and c/d exactly, giving -1, 0 or 1. b and d
+ * must be nonzero. compares the integral parts first, and if they are equal
+ * the fractional parts, by comparing their inverses the other way around.
+ * the denominators shrink like in the euclidean algorithm.
+ */
+template<typename M>
+SDC_RELAXED_CONSTEXPR int
+compare_fractions(M a, M b, M c, M d)
+{
+  for (;;) {
+    const M q1 = a / b;
+    const M q2 = c / d;
+    if (q1 != q2) {
+      return q1 < q2 ? -1 : 1;
+    }
+    const M r1 = a % b;
+    const M r2 = c % d;
+    if (r1 == 0 || r2 == 0) {
+      return r1 == r2 ? 0 : (r1 == 0 ? -1 : 1);
+    }
+    // r1/b < r2/d is the same as d/r2 < b/r1
+    a = d;
+    c = b;
+    b = r2;
+    d = r1;
+  }
+}
+
+// compares x*num with y*den, for magnitudes
+template<typename M>
+SDC_RELAXED_CONSTEXPR int
+compare_scaled(M x, M y, M num, M den)
+{
+#if SDC_HAVE_INT128
+  if
+    SDC_CONSTEXPR_IF(sizeof(M) <= sizeof(std::uint64_t))
+    {
+      // the products fit in 128 bits
+      const uint128_t lhs = static_cast<uint128_t>(x) * num;
+      const uint128_t rhs = static_cast<uint128_t>(y) * den;
+      return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+    }
+#endif
+  // x*num vs y*den is x/den vs y/num
+  return compare_fractions(x, den, y, num);
+}
+
+template<typename Rep1, typename Rep2>
+using comparison_magnitude_t = typename std::make_unsigned<
+  typename std::common_type<Rep1, Rep2, std::intmax_t>::type>::type;
+
+} // namespace detail
+
+/**
+ * compares two integral durations exactly, without converting them to a
+ * common type, which can overflow. gives a negative value if a < b, zero if
+ * a == b and a positive value if a > b.
+ *
+ * with Factor = From::period / To::period (reduced), a < b is
+ * a.count() * Factor::num < b.count() * Factor::den. the products are
+ * computed in 128 bits if the compiler has such a type, otherwise the
+ * fractions are compared through their quotients and remainders.
+ */
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR int
+safe_compare(std::chrono::duration<Rep1, Period1> a,
+             std::chrono::duration<Rep2, Period2> b)
+{
+  static_assert(std::is_integral<Rep1>::value && std::is_integral<Rep2>::value,
+                "only integral representations are supported");
+  using Factor = std::ratio_divide<Period1, Period2>;
+  using M = detail::comparison_magnitude_t<Rep1, Rep2>;
+  const Rep1 x = a.count();
+  const Rep2 y = b.count();
+  const bool xneg = detail::is_negative(x);
+  const bool yneg = detail::is_negative(y);
+  if (xneg != yneg) {
+    return xneg ? -1 : 1;
+  }
+  const int c = detail::compare_scaled(detail::magnitude<M>(x),
+                                       detail::magnitude<M>(y),
+                                       static_cast<M>(Factor::num),
+                                       static_cast<M>(Factor::den));
+  return xneg ? -c : c;
+}
+
+// a == b, exactly
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR bool
+safe_equal(std::chrono::duration<Rep1, Period1> a,
+           std::chrono::duration<Rep2, Period2> b)
+{
+  return safe_compare(a, b) == 0;
+}
+
+// a < b, exactly
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+SDC_RELAXED_CONSTEXPR bool
+safe_less(std::chrono::duration<Rep1, Period1> a,
+          std::chrono::duration<Rep2, Period2> b)
+{
+  return safe_compare(a, b) < 0;
+}
+
+#if SDC_HAVE_THREE_WAY_COMPARISON
+// a <=> b, exactly
+template<typename Rep1, typename Period1, typename Rep2, typename Period2>
+constexpr std::strong_ordering
+safe_three_way_compare(std::chrono::duration<Rep1, Period1> a,
+                       std::chrono::duration<Rep2, Period2> b)
+{
+  return safe_compare(a, b) <=> 0;
+}
+#endif
+
+namespace detail {
+
+// the first element of a sorted range whose count is not less than t.
+// halves the range without branching, and counts the last few elements
+// in a loop the compiler can vectorize.
+template<typename Duration>
+const Duration*
+lower_bound_count(const Duration* first,
+                  std::size_t len,
+                  typename Duration::rep t)
+{
+  const Duration* base = first;
+  constexpr std::size_t linear = 32;
+  while (len > linear) {
+    const std::size_t half = len / 2;
+    base += (base[half - 1].count() < t) ? half : 0;
+    len -= half;
+  }
+  std::size_t below = 0;
+  for (std::size_t i = 0; i < len; ++i) {
+    below += base[i].count() < t;
+  }
+  return base + below;
+}
+
+} // namespace detail
+
+/**
+ * the first element in the sorted range [first,last) which is not less than
+ * key, compared exactly as safe_compare does. the key may have another
+ * period and representation than the elements.
+ *
+ * the key is converted once to the smallest count in the unit of the
+ * elements that is not less than it, so the search itself compares plain
+ * integers.
+ */
+template<typename Rep, typename Period, typename KeyRep, typename KeyPeriod>
+const std::chrono::duration<Rep, Period>*
+safe_lower_bound(const std::chrono::duration<Rep, Period>* first,
+                 const std::chrono::duration<Rep, Period>* last,
+                 std::chrono::duration<KeyRep, KeyPeriod> key)
+{
+  static_assert(std::is_integral<Rep>::value && std::is_integral<KeyRep>::value,
+                "only integral representations are supported");
+  using Element = std::chrono::duration<Rep, Period>;
+  const std::size_t len = static_cast<std::size_t>(last - first);
+#if SDC_HAVE_INT128
+  if
+    SDC_CONSTEXPR_IF(sizeof(Rep) <= sizeof(std::int64_t) &&
+                     sizeof(KeyRep) <= sizeof(std::int64_t))
+    {
+      // an element x is not less than key y if x*num >= y*den, that is
+      // x >= ceil(y*den/num). that product fits in 128 bits.
+      using Factor = std::ratio_divide<Period, KeyPeriod>;
+      using L = std::numeric_limits<Rep>;
+      using detail::int128_t;
+      const int128_t scaled = static_cast<int128_t>(key.count()) * Factor::den;
+      int128_t t = scaled / Factor::num;
+      if (scaled % Factor::num > 0) {
+        ++t;
+      }
+      if (t > static_cast<int128_t>(L::max())) {
+        return last;
+      }
+      if (t <= static_cast<int128_t>(L::min())) {
+        return first;
+      }
+      return detail::lower_bound_count(first, len, static_cast<Rep>(t));
+    }
+#endif
+  return std::lower_bound(first,
+                          first + len,
+                          key,
+                          [](const Element& e, decltype(key) k) {
+                            return safe_compare(e, k) < 0;
+                          });
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_COMPARE_HPP_ */
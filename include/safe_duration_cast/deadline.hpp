@@ -0,0 +1,155 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_DEADLINE_HPP_
+#define INCLUDE_DEADLINE_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/compare.hpp>
+#include <safe_duration_cast/detail/checked_arithmetic.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the deadline if timeout does not fit, in the direction of its sign. the
+// sign of the timeout is used, since the clock may be unsigned.
+template<typename TP, typename Timeout>
+constexpr TP
+deadline_limit(TP /*now*/, Timeout timeout, tags::FromIsInt)
+{
+  return is_negative(timeout.count()) ? TP::min() : TP::max();
+}
+
+template<typename TP, typename Timeout>
+TP
+deadline_limit(TP now, Timeout timeout, tags::FromIsFloat)
+{
+  // NaN has no direction, and does not wait. the comparison is quiet.
+  return std::isunordered(timeout.count(), timeout.count())
+           ? now
+           : (std::signbit(timeout.count()) ? TP::min() : TP::max());
+}
+
+// |timeout|, in a representation which can hold it
+template<typename Rep, typename Period>
+std::chrono::duration<typename std::make_unsigned<Rep>::type, Period>
+timeout_magnitude(std::chrono::duration<Rep, Period> timeout,
+                  std::true_type /*is_integral*/)
+{
+  using U = typename std::make_unsigned<Rep>::type;
+  return std::chrono::duration<U, Period>{ magnitude<U>(timeout.count()) };
+}
+
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+timeout_magnitude(std::chrono::duration<Rep, Period> timeout,
+                  std::false_type /*is_integral*/)
+{
+  return std::chrono::duration<Rep, Period>{ std::fabs(timeout.count()) };
+}
+
+// sets sum to now + timeout, and returns true if it does not fit. a signed
+// or floating point clock can hold the timeout as it is.
+template<typename Duration, typename Timeout>
+bool
+deadline_sum(Duration now,
+             Timeout timeout,
+             Duration& sum,
+             std::false_type /*is_unsigned_clock*/)
+{
+  int ec = 0;
+  const Duration t = safe_duration_cast<Duration>(timeout, ec);
+  typename Duration::rep s{};
+  const bool overflow = checked_add(now.count(), t.count(), s);
+  sum = Duration{ s };
+  return ec || overflow;
+}
+
+// an unsigned clock can not hold a negative timeout, so its magnitude is
+// converted and subtracted instead.
+template<typename Duration, typename Timeout>
+bool
+deadline_sum(Duration now,
+             Timeout timeout,
+             Duration& sum,
+             std::true_type /*is_unsigned_clock*/)
+{
+  using Rep = typename Timeout::rep;
+  const bool negative = is_negative(timeout.count());
+  int ec = 0;
+  const Duration t = safe_duration_cast<Duration>(
+    timeout_magnitude(timeout, std::is_integral<Rep>{}), ec);
+  typename Duration::rep added{};
+  typename Duration::rep subtracted{};
+  const bool add_overflow = checked_add(now.count(), t.count(), added);
+  const bool sub_overflow = checked_sub(now.count(), t.count(), subtracted);
+  sum = Duration{ negative ? subtracted : added };
+  return ec || (negative ? sub_overflow : add_overflow);
+}
+
+} // namespace detail
+
+/**
+ * the time point timeout after now, for wait_until and similar. unlike
+ * now + timeout, this does not overflow: a deadline past the end of the
+ * clock becomes time_point::max(), and one before its start
+ * time_point::min().
+ *
+ * the timeout is converted with safe_duration_cast, so it may have any
+ * representation, including floating point, without undefined behaviour.
+ * a timeout which does not fit in the clock saturates the same way, an
+ * infinite one waits forever and NaN does not wait at all. sub tick parts
+ * are truncated, like duration_cast does.
+ *
+ * the clock may have an unsigned representation. a negative timeout is then
+ * subtracted from now, and saturates at the epoch.
+ *
+ * the sum and the limit are both computed and one of them selected, so
+ * there are no branches besides those of the conversion.
+ */
+template<typename Clock,
+         typename Duration,
+         typename TimeoutRep,
+         typename TimeoutPeriod>
+std::chrono::time_point<Clock, Duration>
+safe_deadline(std::chrono::time_point<Clock, Duration> now,
+              std::chrono::duration<TimeoutRep, TimeoutPeriod> timeout)
+{
+  using TP = std::chrono::time_point<Clock, Duration>;
+  using Timeout = std::chrono::duration<TimeoutRep, TimeoutPeriod>;
+  using FromTag = typename detail::dispatch_tags<Timeout, Duration>::FromTag;
+  using Rep = typename Duration::rep;
+  Duration sum{};
+  const bool failed = detail::deadline_sum(
+    now.time_since_epoch(),
+    timeout,
+    sum,
+    std::integral_constant<bool,
+                           std::is_integral<Rep>::value &&
+                             !std::numeric_limits<Rep>::is_signed>{});
+  const TP limit = detail::deadline_limit(now, timeout, FromTag{});
+  return failed ? limit : TP{ sum };
+}
+
+/**
+ * the time point timeout from now on Clock, see above. for instance
+ *   cv.wait_until(lock, safe_deadline<std::chrono::steady_clock>(timeout));
+ */
+template<typename Clock, typename TimeoutRep, typename TimeoutPeriod>
+typename Clock::time_point
+safe_deadline(std::chrono::duration<TimeoutRep, TimeoutPeriod> timeout)
+{
+  return safe_deadline(Clock::now(), timeout);
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DEADLINE_HPP_ */
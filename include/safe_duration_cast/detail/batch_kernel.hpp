@@ -0,0 +1,593 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Building blocks for converting arrays of durations. The scalar code in
+ * chronoconv_detail.hpp returns early and writes to the error code, which
+ * keeps the compiler from vectorizing a loop around it. The code in here
+ * instead computes an error flag per element and selects the result without
+ * branching.
+ */
+#ifndef INCLUDE_DETAIL_BATCH_KERNEL_HPP_
+#define INCLUDE_DETAIL_BATCH_KERNEL_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/chronoconv_detail.hpp>
+#include <safe_duration_cast/detail/safe_range.hpp>
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+// explicit simd kernels are used if the compiler is told the target has them,
+// for instance through -mavx2 or -march=native.
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+#define SDC_BATCH_HAVE_AVX512 1
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define SDC_BATCH_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace safe_duration_cast {
+
+/**
+ * the outcome of converting an array of durations.
+ */
+struct batch_result
+{
+  // the number of elements which could not be converted
+  std::size_t failures;
+  // the index of the first element which could not be converted, or the
+  // number of elements if all were converted.
+  std::size_t first_failure;
+};
+
+namespace detail {
+
+// each word in the failure mask covers this many elements
+constexpr std::size_t batch_block_size = 64;
+
+inline int
+popcount64(std::uint64_t x)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(x);
+#else
+  int count = 0;
+  for (; x != 0; x &= x - 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+// the index of the lowest set bit. x must be nonzero.
+inline int
+countr_zero64(std::uint64_t x)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  int count = 0;
+  for (; (x & 1) == 0; x >>= 1) {
+    ++count;
+  }
+  return count;
+#endif
+}
+
+/**
+ * packs batch_block_size flags, each 0 or 1, into a bit mask. Writing flags
+ * to an array and packing them afterwards lets the compiler vectorize the
+ * loop producing the flags, which it does not do if the bits are or:ed
+ * together one at a time.
+ */
+inline std::uint64_t
+pack_flags(const unsigned char* flags)
+{
+  std::uint64_t bits = 0;
+  for (std::size_t k = 0; k < batch_block_size / 8; ++k) {
+    // the compiler turns this into a single load on little endian targets
+    std::uint64_t eight = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+      eight |= static_cast<std::uint64_t>(flags[8 * k + i]) << (8 * i);
+    }
+    // moves the lowest bit of byte i to bit 56+i
+    bits |= ((eight * 0x0102040810204080ULL) >> 56) << (8 * k);
+  }
+  return bits;
+}
+
+// stores the failure bits of the block starting at element first, and
+// updates the summary.
+inline void
+record_block(batch_result& result,
+             std::uint64_t* failmask,
+             std::size_t first,
+             std::uint64_t bits)
+{
+  if (failmask) {
+    failmask[first / batch_block_size] = bits;
+  }
+  if (bits) {
+    if (result.failures == 0) {
+      result.first_failure = first + countr_zero64(bits);
+    }
+    result.failures += popcount64(bits);
+  }
+}
+
+/**
+ * calls lane(i) for each i in [0,n). lane should return true if element i
+ * failed.
+ */
+template<typename Lane>
+batch_result
+for_each_block(std::size_t n, std::uint64_t* failmask, Lane&& lane)
+{
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += batch_block_size) {
+    const std::size_t len = std::min(batch_block_size, n - first);
+    unsigned char failed[batch_block_size] = {};
+    for (std::size_t j = 0; j < len; ++j) {
+      failed[j] = lane(first + j);
+    }
+    record_block(result, failmask, first, pack_flags(failed));
+  }
+  return result;
+}
+
+#if SDC_BATCH_HAVE_AVX2
+// the lower 64 bits of the lane wise product, which avx2 lacks an
+// instruction for.
+inline __m256i
+mullo_epi64(__m256i a, __m256i b)
+{
+  const __m256i a_hi = _mm256_srli_epi64(a, 32);
+  const __m256i b_hi = _mm256_srli_epi64(b, 32);
+  const __m256i low = _mm256_mul_epu32(a, b);
+  const __m256i cross =
+    _mm256_add_epi64(_mm256_mul_epu32(a_hi, b), _mm256_mul_epu32(a, b_hi));
+  return _mm256_add_epi64(low, _mm256_slli_epi64(cross, 32));
+}
+#endif
+
+/**
+ * the count of an element in the arrays scale_block_int64 works on, which
+ * are either durations or plain counts.
+ */
+template<typename Rep, typename Period>
+constexpr Rep
+count_of(std::chrono::duration<Rep, Period> d)
+{
+  return d.count();
+}
+constexpr std::int64_t
+count_of(std::int64_t x)
+{
+  return x;
+}
+
+/**
+ * multiplies len (at most batch_block_size) signed 64 bit counts with num,
+ * where the input is valid if it is within [min1,max1]. Invalid elements
+ * give zero as output. Returns the failure bits.
+ *
+ * the elements are loaded and stored as vectors of their counts, so they
+ * must be 64 bit signed integers, or durations with such a rep.
+ */
+template<typename To, typename From>
+std::uint64_t
+scale_block_int64(const From* in,
+                  To* out,
+                  std::size_t len,
+                  std::int64_t num,
+                  std::int64_t min1,
+                  std::int64_t max1)
+{
+  static_assert(sizeof(From) == 8 && sizeof(To) == 8,
+                "durations must be laid out as their count");
+  std::uint64_t bits = 0;
+  std::size_t j = 0;
+#if SDC_BATCH_HAVE_AVX512
+  const __m512i lo = _mm512_set1_epi64(min1);
+  const __m512i hi = _mm512_set1_epi64(max1);
+  const __m512i factor = _mm512_set1_epi64(num);
+  for (; j + 8 <= len; j += 8) {
+    const __m512i x = _mm512_loadu_si512(in + j);
+    const __mmask8 bad =
+      _mm512_cmpgt_epi64_mask(x, hi) | _mm512_cmplt_epi64_mask(x, lo);
+    const __m512i y =
+      _mm512_maskz_mullo_epi64(static_cast<__mmask8>(~bad), x, factor);
+    _mm512_storeu_si512(out + j, y);
+    bits |= static_cast<std::uint64_t>(bad) << j;
+  }
+#elif SDC_BATCH_HAVE_AVX2
+  const __m256i lo = _mm256_set1_epi64x(min1);
+  const __m256i hi = _mm256_set1_epi64x(max1);
+  const __m256i factor = _mm256_set1_epi64x(num);
+  for (; j + 4 <= len; j += 4) {
+    const __m256i x =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + j));
+    const __m256i bad =
+      _mm256_or_si256(_mm256_cmpgt_epi64(x, hi), _mm256_cmpgt_epi64(lo, x));
+    const __m256i y = mullo_epi64(_mm256_andnot_si256(bad, x), factor);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + j), y);
+    bits |= static_cast<std::uint64_t>(
+              _mm256_movemask_pd(_mm256_castsi256_pd(bad)))
+            << j;
+  }
+#endif
+  for (; j < len; ++j) {
+    const std::int64_t x = count_of(in[j]);
+    const bool bad = x > max1 || x < min1;
+    out[j] = To{ bad ? 0 : x * num };
+    bits |= static_cast<std::uint64_t>(bad) << j;
+  }
+  return bits;
+}
+
+/**
+ * the integral conversion of safe_duration_cast_dispatch, one element at a
+ * time, without branching.
+ */
+template<typename To, typename From>
+struct integral_batch_kernel
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  static_assert(Factor::num > 0, "num must be positive");
+  static_assert(Factor::den > 0, "den must be positive");
+
+  using FromRep = typename From::rep;
+  using ToRep = typename To::rep;
+  using IntermediateRep =
+    typename std::common_type<FromRep, ToRep, decltype(Factor::num)>::type;
+
+  static constexpr IntermediateRep max1()
+  {
+    return std::numeric_limits<IntermediateRep>::max() / Factor::num;
+  }
+  static constexpr IntermediateRep min1()
+  {
+    return std::numeric_limits<IntermediateRep>::min() / Factor::num;
+  }
+
+  using Range = integral_safe_range<From, To>;
+
+  // converts one count, returns true on failure
+  static bool convert(FromRep from, ToRep& to)
+  {
+    // inside the safe range, count fits and so does the result.
+    const IntermediateRep count = static_cast<IntermediateRep>(from);
+    const bool ok = from >= Range::min_count() && from <= Range::max_count() &&
+                    count <= max1() && count >= min1();
+    // work on zero for failed elements, so nothing can overflow.
+    IntermediateRep scaled = ok ? count : IntermediateRep{};
+    scaled *= Factor::num;
+    scaled /= Factor::den;
+    to = static_cast<ToRep>(scaled);
+    return !ok;
+  }
+
+  // the explicit simd kernel handles pure scaling of signed 64 bit counts
+  using use_simd = std::integral_constant<
+    bool,
+    Factor::den == 1 && std::is_signed<IntermediateRep>::value &&
+      std::is_signed<FromRep>::value && std::is_signed<ToRep>::value &&
+      sizeof(IntermediateRep) == 8 && sizeof(FromRep) == 8 &&
+      sizeof(ToRep) == 8>;
+
+  static std::uint64_t convert_block(const From* in,
+                                     To* out,
+                                     std::size_t len,
+                                     std::false_type /*use_simd*/)
+  {
+    unsigned char failed[batch_block_size] = {};
+    for (std::size_t j = 0; j < len; ++j) {
+      ToRep count;
+      failed[j] = convert(in[j].count(), count);
+      out[j] = To{ count };
+    }
+    return pack_flags(failed);
+  }
+
+  static std::uint64_t convert_block(const From* in,
+                                     To* out,
+                                     std::size_t len,
+                                     std::true_type /*use_simd*/)
+  {
+    return scale_block_int64(in,
+                             out,
+                             len,
+                             Factor::num,
+                             static_cast<std::int64_t>(min1()),
+                             static_cast<std::int64_t>(max1()));
+  }
+
+  static std::uint64_t convert_block(const From* in, To* out, std::size_t len)
+  {
+    return convert_block(in, out, len, use_simd{});
+  }
+};
+
+template<typename To, typename From>
+batch_result
+safe_duration_cast_n_dispatch(const From* in,
+                              To* out,
+                              std::size_t n,
+                              std::uint64_t* failmask,
+                              tags::FromIsInt,
+                              tags::ToIsInt)
+{
+  using Kernel = integral_batch_kernel<To, From>;
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += batch_block_size) {
+    const std::size_t len = std::min(batch_block_size, n - first);
+    const From* src = in + first;
+    From saved[batch_block_size];
+    if (Kernel::Factor::num != 1 &&
+        static_cast<const void*>(in) == static_cast<const void*>(out)) {
+      // the kernel overwrites the input, which the retry below needs.
+      std::copy(src, src + len, saved);
+      src = saved;
+    }
+    std::uint64_t bits = Kernel::convert_block(src, out + first, len);
+    if (Kernel::Factor::num != 1) {
+      // the kernel rejects elements where count*num overflows, but the
+      // result may still fit. give those the slower, exact treatment.
+      // elements outside the safe range fail anyway, so skip them.
+      using Range = typename Kernel::Range;
+      for (std::uint64_t todo = bits; todo != 0; todo &= todo - 1) {
+        const int j = countr_zero64(todo);
+        const auto count = src[j].count();
+        if (count < Range::min_count() || count > Range::max_count()) {
+          continue;
+        }
+        int ec = 0;
+        out[first + j] = safe_duration_cast_dispatch<To>(
+          src[j], ec, tags::FromIsInt{}, tags::ToIsInt{});
+        if (ec == 0) {
+          bits &= ~(std::uint64_t{ 1 } << j);
+        }
+      }
+    }
+    record_block(result, failmask, first, bits);
+  }
+  return result;
+}
+
+template<typename To, typename From>
+batch_result
+safe_duration_cast_n_dispatch(const From* in,
+                              To* out,
+                              std::size_t n,
+                              std::uint64_t* failmask,
+                              tags::FromIsFloat,
+                              tags::ToIsInt)
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using ToRep = typename To::rep;
+  // the scalar kernel has no branches, so this loop can be vectorized.
+  return for_each_block(n, failmask, [=](std::size_t i) {
+    bool failed = false;
+    out[i] =
+      To{ scale_floating_to_integral<Factor, ToRep>(in[i].count(), failed) };
+    return failed;
+  });
+}
+
+template<typename To, typename From, typename FromTag, typename ToTag>
+batch_result
+safe_duration_cast_n_dispatch(const From* in,
+                              To* out,
+                              std::size_t n,
+                              std::uint64_t* failmask,
+                              FromTag,
+                              ToTag)
+{
+  // no specialized kernel, go element by element.
+  return for_each_block(n, failmask, [=](std::size_t i) {
+    int ec = 0;
+    out[i] = safe_duration_cast_dispatch<To>(in[i], ec, FromTag{}, ToTag{});
+    return ec != 0;
+  });
+}
+
+// stores the inexact bits of the block starting at element first
+inline void
+record_inexact(std::uint64_t* inexactmask,
+               std::size_t first,
+               std::uint64_t bits)
+{
+  if (inexactmask) {
+    inexactmask[first / batch_block_size] = bits;
+  }
+}
+
+template<typename To, typename From>
+batch_result
+exact_duration_cast_n_dispatch(const From* in,
+                               To* out,
+                               std::size_t n,
+                               std::uint64_t* failmask,
+                               std::uint64_t* inexactmask,
+                               tags::FromIsInt,
+                               tags::ToIsInt)
+{
+  using Kernel = integral_batch_kernel<To, From>;
+  using Factor = typename Kernel::Factor;
+  using ToRep = typename To::rep;
+  if (Factor::den == 1) {
+    // nothing is truncated
+    if (inexactmask) {
+      std::fill(inexactmask, inexactmask + (n + batch_block_size - 1) /
+                                             batch_block_size,
+                std::uint64_t{ 0 });
+    }
+    return safe_duration_cast_n_dispatch<To>(
+      in, out, n, failmask, tags::FromIsInt{}, tags::ToIsInt{});
+  }
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += batch_block_size) {
+    const std::size_t len = std::min(batch_block_size, n - first);
+    unsigned char failed[batch_block_size] = {};
+    unsigned char truncated[batch_block_size] = {};
+    std::uint64_t bits = 0;
+    if (Factor::num == 1) {
+      // a pure division, which the kernel handles completely. the check
+      // goes in the same loop, so it overlaps with the conversion.
+      for (std::size_t j = 0; j < len; ++j) {
+        const auto count = in[first + j].count();
+        ToRep to;
+        failed[j] = Kernel::convert(count, to);
+        truncated[j] = !is_divisible<Factor::den>(count);
+        out[first + j] = To{ truncated[j] ? ToRep{} : to };
+      }
+      bits = pack_flags(failed);
+    } else {
+      // the kernel may need to retry elements from the input, so the check
+      // goes first, in case in and out are the same array.
+      for (std::size_t j = 0; j < len; ++j) {
+        truncated[j] = !is_divisible<Factor::den>(in[first + j].count());
+      }
+      safe_duration_cast_n_dispatch<To>(in + first,
+                                        out + first,
+                                        len,
+                                        &bits,
+                                        tags::FromIsInt{},
+                                        tags::ToIsInt{});
+    }
+    const std::uint64_t inexact = pack_flags(truncated) & ~bits;
+    if (Factor::num != 1) {
+      for (std::uint64_t todo = inexact; todo != 0; todo &= todo - 1) {
+        out[first + countr_zero64(todo)] = To{};
+      }
+    }
+    record_inexact(inexactmask, first, inexact);
+    record_block(result, failmask, first, bits | inexact);
+  }
+  return result;
+}
+
+template<typename To, typename From, typename FromTag, typename ToTag>
+batch_result
+exact_duration_cast_n_dispatch(const From* in,
+                               To* out,
+                               std::size_t n,
+                               std::uint64_t* failmask,
+                               std::uint64_t* inexactmask,
+                               FromTag,
+                               ToTag)
+{
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += batch_block_size) {
+    const std::size_t len = std::min(batch_block_size, n - first);
+    unsigned char failed[batch_block_size] = {};
+    unsigned char inexact[batch_block_size] = {};
+    for (std::size_t j = 0; j < len; ++j) {
+      int ec = 0;
+      out[first + j] = exact_duration_cast_dispatch<To>(
+        in[first + j], ec, FromTag{}, ToTag{});
+      failed[j] = ec != 0;
+      inexact[j] = ec == 2;
+    }
+    record_inexact(inexactmask, first, pack_flags(inexact));
+    record_block(result, failmask, first, pack_flags(failed));
+  }
+  return result;
+}
+
+template<typename Rounding, typename To, typename From>
+batch_result
+rounded_duration_cast_n_dispatch(const From* in,
+                                 To* out,
+                                 std::size_t n,
+                                 std::uint64_t* failmask,
+                                 tags::FromIsInt,
+                                 tags::ToIsInt)
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using ToRep = typename To::rep;
+  if (Factor::den == 1) {
+    // nothing is truncated, so there is nothing to round
+    return safe_duration_cast_n_dispatch<To>(
+      in, out, n, failmask, tags::FromIsInt{}, tags::ToIsInt{});
+  }
+  using Kernel = integral_batch_kernel<To, From>;
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += batch_block_size) {
+    const std::size_t len = std::min(batch_block_size, n - first);
+    unsigned char failed[batch_block_size] = {};
+    if (Factor::num == 1) {
+      // a pure division, which the kernel handles completely. the rounding
+      // goes in the same loop, so it needs no copy of the input.
+      for (std::size_t j = 0; j < len; ++j) {
+        const auto count = in[first + j].count();
+        ToRep t;
+        const bool truncation_failed = Kernel::convert(count, t);
+        bool rounding_failed = false;
+        t = round_integral_quotient<Rounding, Factor>(
+          count, t, rounding_failed);
+        failed[j] = truncation_failed || rounding_failed;
+        out[first + j] = To{ failed[j] ? ToRep{} : t };
+      }
+      record_block(result, failmask, first, pack_flags(failed));
+      continue;
+    }
+    const From* src = in + first;
+    From saved[batch_block_size];
+    if (static_cast<const void*>(in) == static_cast<const void*>(out)) {
+      // the rounding needs the input, which the conversion overwrites
+      std::copy(src, src + len, saved);
+      src = saved;
+    }
+    std::uint64_t bits = 0;
+    safe_duration_cast_n_dispatch<To>(
+      src, out + first, len, &bits, tags::FromIsInt{}, tags::ToIsInt{});
+    // the truncated quotients are adjusted from their remainders, without
+    // branching. elements which already failed stay zero.
+    for (std::size_t j = 0; j < len; ++j) {
+      const bool truncation_failed = (bits >> j) & 1U;
+      bool rounding_failed = false;
+      const ToRep count = round_integral_quotient<Rounding, Factor>(
+        src[j].count(), out[first + j].count(), rounding_failed);
+      out[first + j] =
+        To{ truncation_failed || rounding_failed ? ToRep{} : count };
+      failed[j] = rounding_failed && !truncation_failed;
+    }
+    record_block(result, failmask, first, bits | pack_flags(failed));
+  }
+  return result;
+}
+
+template<typename Rounding, typename To, typename From>
+batch_result
+rounded_duration_cast_n_dispatch(const From* in,
+                                 To* out,
+                                 std::size_t n,
+                                 std::uint64_t* failmask,
+                                 tags::FromIsFloat,
+                                 tags::ToIsInt)
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using ToRep = typename To::rep;
+  // the scalar kernel has no branches, so this loop can be vectorized.
+  return for_each_block(n, failmask, [=](std::size_t i) {
+    bool failed = false;
+    out[i] = To{ scale_floating_to_integral<Factor, ToRep, Rounding>(
+      in[i].count(), failed) };
+    return failed;
+  });
+}
+
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_BATCH_KERNEL_HPP_ */
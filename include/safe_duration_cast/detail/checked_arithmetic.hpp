@@ -0,0 +1,187 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_DETAIL_CHECKED_ARITHMETIC_HPP_
+#define INCLUDE_DETAIL_CHECKED_ARITHMETIC_HPP_
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+// gcc and clang check a multiplication for overflow with a single flag test
+// after it
+#if defined(__GNUC__) && !defined(__INTEL_COMPILER)
+#define SDC_HAVE_BUILTIN_OVERFLOW 1
+#else
+#define SDC_HAVE_BUILTIN_OVERFLOW 0
+#endif
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the integral versions set result to a+b, a-b or a*b and return true if
+// it overflowed. the result is unspecified then.
+//
+// addition and subtraction wrap around in the unsigned type and look at the
+// signs afterwards. that is what __builtin_add_overflow does too, but gcc
+// can not vectorize a loop around the builtin, while it can this.
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_add(T a, T b, T& result, std::true_type /*is_integer*/)
+{
+  using U = typename std::make_unsigned<T>::type;
+  result = static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+  // signed: a and b have the same sign, which the result does not have
+  return std::numeric_limits<T>::is_signed ? ((a ^ result) & (b ^ result)) < 0
+                                           : result < a;
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_sub(T a, T b, T& result, std::true_type /*is_integer*/)
+{
+  using U = typename std::make_unsigned<T>::type;
+  result = static_cast<T>(static_cast<U>(a) - static_cast<U>(b));
+  // signed: a and b have different signs, and the result has that of b
+  return std::numeric_limits<T>::is_signed ? ((a ^ b) & (a ^ result)) < 0
+                                           : a < b;
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_mul(T a, T b, T& result, std::true_type /*is_integer*/)
+{
+#if SDC_HAVE_BUILTIN_OVERFLOW
+  return __builtin_mul_overflow(a, b, &result);
+#else
+  using L = std::numeric_limits<T>;
+  if (a != 0 && b != 0) {
+    // compare the magnitudes through division, minding the signs
+    if (a > 0 ? (b > 0 ? a > L::max() / b : b < L::min() / a)
+              : (b > 0 ? a < L::min() / b : a < L::max() / b)) {
+      return true;
+    }
+  }
+  result = static_cast<T>(a * b);
+  return false;
+#endif
+}
+
+// a/b and a%b fail for a zero divisor, and a/b overflows for the lowest
+// value divided by -1. the division is done with a harmless divisor
+// instead of branching, so a loop around it can be vectorized.
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_div(T a, T b, T& result, std::true_type /*is_integer*/)
+{
+  using L = std::numeric_limits<T>;
+  const bool bad =
+    b == 0 || (L::is_signed && a == L::min() && b == static_cast<T>(-1));
+  result = static_cast<T>(a / (bad ? T{ 1 } : b));
+  return bad;
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_mod(T a, T b, T& result, std::true_type /*is_integer*/)
+{
+  using L = std::numeric_limits<T>;
+  // anything modulo -1 is zero, but the lowest value % -1 is undefined
+  const bool minus_one = L::is_signed && b == static_cast<T>(-1);
+  result = static_cast<T>(a % (b == 0 || minus_one ? T{ 1 } : b));
+  return b == 0;
+}
+
+// the floating point versions fail when finite inputs give a result which
+// is not, like overflowing to infinity or dividing by zero.
+
+template<typename T>
+bool
+overflowed(T a, T b, T result)
+{
+  return !std::isfinite(result) && std::isfinite(a) && std::isfinite(b);
+}
+
+template<typename T>
+bool
+checked_add(T a, T b, T& result, std::false_type /*is_integer*/)
+{
+  result = a + b;
+  return overflowed(a, b, result);
+}
+
+template<typename T>
+bool
+checked_sub(T a, T b, T& result, std::false_type /*is_integer*/)
+{
+  result = a - b;
+  return overflowed(a, b, result);
+}
+
+template<typename T>
+bool
+checked_mul(T a, T b, T& result, std::false_type /*is_integer*/)
+{
+  result = a * b;
+  return overflowed(a, b, result);
+}
+
+template<typename T>
+bool
+checked_div(T a, T b, T& result, std::false_type /*is_integer*/)
+{
+  result = a / b;
+  return overflowed(a, b, result);
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_add(T a, T b, T& result)
+{
+  using is_integer = std::integral_constant<bool, std::is_integral<T>::value>;
+  return checked_add(a, b, result, is_integer{});
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_sub(T a, T b, T& result)
+{
+  using is_integer = std::integral_constant<bool, std::is_integral<T>::value>;
+  return checked_sub(a, b, result, is_integer{});
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_mul(T a, T b, T& result)
+{
+  using is_integer = std::integral_constant<bool, std::is_integral<T>::value>;
+  return checked_mul(a, b, result, is_integer{});
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_div(T a, T b, T& result)
+{
+  using is_integer = std::integral_constant<bool, std::is_integral<T>::value>;
+  return checked_div(a, b, result, is_integer{});
+}
+
+template<typename T>
+SDC_RELAXED_CONSTEXPR bool
+checked_mod(T a, T b, T& result)
+{
+  static_assert(std::is_integral<T>::value, "modulo needs integral types");
+  return checked_mod(a, b, result, std::true_type{});
+}
+
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_CHECKED_ARITHMETIC_HPP_ */
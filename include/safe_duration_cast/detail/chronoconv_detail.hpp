@@ -5,6 +5,9 @@
  * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
  * at your option).
  */
+#ifndef INCLUDE_DETAIL_CHRONOCONV_DETAIL_HPP_
+#define INCLUDE_DETAIL_CHRONOCONV_DETAIL_HPP_
+
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -13,7 +16,10 @@
 #include <stdexcept>
 #include <type_traits>
 
+#include <safe_duration_cast/detail/divisibility.hpp>
+#include <safe_duration_cast/detail/exact_mul_div.hpp>
 #include <safe_duration_cast/detail/lossless_conversion.hpp>
+#include <safe_duration_cast/detail/rounding.hpp>
 #include <safe_duration_cast/detail/safe_float_conversion.hpp>
 #include <safe_duration_cast/detail/stdutils.hpp>
 
@@ -95,6 +101,23 @@ is_floating_duration(...)
   return false;
 }
 
+// selects the tags used for dispatching a conversion from From to To
+template<typename From, typename To>
+struct dispatch_tags
+{
+  using FromTag =
+    typename conditional3<is_integral_duration(From{}),
+                          tags::FromIsInt,
+                          is_floating_duration(From{}),
+                          tags::FromIsFloat,
+                          tags::NotArithmetic>::type;
+  using ToTag = typename conditional3<is_integral_duration(To{}),
+                                      tags::ToIsInt,
+                                      is_floating_duration(To{}),
+                                      tags::ToIsFloat,
+                                      tags::NotArithmetic>::type;
+};
+
 template<typename To, typename From>
 SDC_RELAXED_CONSTEXPR To
 safe_duration_cast_dispatch(From from, int& ec, tags::FromIsInt, tags::ToIsInt)
@@ -130,22 +153,26 @@ safe_duration_cast_dispatch(From from, int& ec, tags::FromIsInt, tags::ToIsInt)
     {
       constexpr auto max1 =
         std::numeric_limits<IntermediateRep>::max() / Factor::num;
-      if (count > max1) {
-        ec = 1;
-        return {};
-      }
       constexpr auto min1 =
         std::numeric_limits<IntermediateRep>::min() / Factor::num;
-      if (count < min1) {
-        ec = 1;
-        return {};
+      if (count > max1 || count < min1) {
+        // count*num overflows, but the result after dividing by den may
+        // still fit. take the slower path which divides first.
+        count = exact_mul_div<Factor::num, Factor::den>(count, ec);
+        if (ec) {
+          return {};
+        }
+      } else {
+        count *= Factor::num;
+        if
+          SDC_CONSTEXPR_IF(Factor::den != 1) { count /= Factor::den; }
       }
-      count *= Factor::num;
     }
-
-  // this can't go wrong, right? den>0 is checked earlier.
-  if
-    SDC_CONSTEXPR_IF(Factor::den != 1) { count /= Factor::den; }
+  else {
+    // this can't go wrong, right? den>0 is checked earlier.
+    if
+      SDC_CONSTEXPR_IF(Factor::den != 1) { count /= Factor::den; }
+  }
   // convert to the to type, safely
   using ToRep = typename To::rep;
   const ToRep tocount = lossless_integral_conversion<ToRep>(count, ec);
@@ -180,6 +207,41 @@ convert_and_check_cfenv(From from)
   return count;
 }
 
+// multiplies count with Factor::num/Factor::den, setting ec if the result
+// overflows.
+template<typename Factor, typename Rep>
+SDC_RELAXED_CONSTEXPR Rep
+scale_floating(Rep count, int& ec)
+{
+  static_assert(std::is_floating_point<Rep>::value, "");
+  static_assert(Factor::num > 0, "num must be positive");
+  static_assert(Factor::den > 0, "den must be positive");
+
+  // multiply with Factor::num without overflow or underflow
+  if
+    SDC_CONSTEXPR_IF(Factor::num != 1)
+    {
+      // quiet comparisons, so a NaN passes through without FE_INVALID
+      constexpr auto max1 = std::numeric_limits<Rep>::max() / Factor::num;
+      if (std::isgreater(count, max1)) {
+        ec = 1;
+        return {};
+      }
+      constexpr auto min1 = std::numeric_limits<Rep>::lowest() / Factor::num;
+      if (std::isless(count, min1)) {
+        ec = 1;
+        return {};
+      }
+      count *= Factor::num;
+      SDC_ASSERT_FLOATING_POINT_EXCEPTION;
+    }
+
+  // this can't go wrong, right? den>0 is checked earlier.
+  if
+    SDC_CONSTEXPR_IF(Factor::den != 1) { count /= Factor::den; }
+  return count;
+}
+
 template<typename To, typename From>
 SDC_RELAXED_CONSTEXPR To
 safe_duration_cast_dispatch(From from,
@@ -225,42 +287,452 @@ safe_duration_cast_dispatch(From from,
                               decltype(Factor::num)>::type;
 
   // check this in a template, to get type info in the error message
-  IntermediateRep count =
-    convert_and_check_cfenv<IntermediateRep>(from.count());
+  IntermediateRep count = scale_floating<Factor>(
+    convert_and_check_cfenv<IntermediateRep>(from.count()), ec);
+  if (ec) {
+    return {};
+  }
+
+  // convert to the to type, safely
+  using ToRep = typename To::rep;
+
+  const ToRep tocount = safe_float_conversion<ToRep>(count, ec);
+  if (ec) {
+    return {};
+  }
+  SDC_ASSERT_FLOATING_POINT_EXCEPTION;
+  return To{ tocount };
+}
+
+// true if the integer value can be converted to Float without rounding.
+// types narrower than the mantissa always can.
+template<typename Float, typename Int>
+constexpr bool
+is_exactly_representable(Int /*value*/, std::true_type /*narrow*/)
+{
+  return true;
+}
+
+template<typename Float, typename Int>
+SDC_RELAXED_CONSTEXPR bool
+is_exactly_representable(Int value, std::false_type /*narrow*/)
+{
+  using U = typename std::make_unsigned<Int>::type;
+  constexpr int FloatDigits = std::numeric_limits<Float>::digits;
+  // the magnitude, without overflowing for the most negative value
+  const U mag = value < 0 ? static_cast<U>(U{ 0 } - static_cast<U>(value))
+                          : static_cast<U>(value);
+  constexpr U mantissa_limit = U{ 1 } << FloatDigits;
+  if (mag <= mantissa_limit) {
+    // the fast path, for all values within +-2^digits
+    return true;
+  }
+  // the bits below the lowest set bit are zero and fit in the exponent, the
+  // rest (the odd part) must fit in the mantissa.
+  const U lowest_bit = static_cast<U>(mag & (U{ 0 } - mag));
+  return mag / lowest_bit < mantissa_limit;
+}
+
+template<typename Float, typename Int>
+SDC_RELAXED_CONSTEXPR bool
+is_exactly_representable(Int value)
+{
+  using narrow =
+    std::integral_constant<bool,
+                           std::numeric_limits<Int>::digits <=
+                             std::numeric_limits<Float>::digits>;
+  return is_exactly_representable<Float>(value, narrow{});
+}
+
+template<typename To, typename From>
+SDC_RELAXED_CONSTEXPR To
+safe_duration_cast_dispatch(From from, int& ec, tags::FromIsInt, tags::ToIsFloat)
+{
+  static_assert(is_integral_duration(From{}), "from must be integral");
+  static_assert(is_floating_duration(To{}), "to must be floating point");
+  ec = 0;
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using FromRep = typename From::rep;
+  using ToRep = typename To::rep;
+
+  // std::chrono::duration_cast computes in common_type<ToRep, FromRep,
+  // intmax_t>, which is ToRep. doing the same gives identical results.
+  static_assert(
+    std::is_same<typename std::common_type<ToRep, FromRep, std::intmax_t>::type,
+                 ToRep>::value,
+    "expected the intermediate type to be the floating point type");
 
-  // multiply with Factor::num without overflow or underflow
   if
-    SDC_CONSTEXPR_IF(Factor::num != 1)
+    SDC_CONSTEXPR_IF(std::numeric_limits<FromRep>::digits >=
+                     std::numeric_limits<ToRep>::max_exponent)
     {
-      constexpr auto max1 =
-        std::numeric_limits<IntermediateRep>::max() / Factor::num;
-      if (count > max1) {
+      // only for extended integer types, like unsigned __int128 to float:
+      // the conversion itself may overflow.
+      const auto limit = static_cast<FromRep>(std::numeric_limits<ToRep>::max());
+      if (from.count() > limit) {
         ec = 1;
         return {};
       }
-      constexpr auto min1 =
-        std::numeric_limits<IntermediateRep>::lowest() / Factor::num;
-      if (count < min1) {
-        ec = 1;
-        return {};
-      }
-      count *= Factor::num;
-      SDC_ASSERT_FLOATING_POINT_EXCEPTION;
     }
+  // within +-2^digits, this is exact. outside, it rounds to nearest.
+  const ToRep count =
+    scale_floating<Factor>(static_cast<ToRep>(from.count()), ec);
+  if (ec) {
+    return {};
+  }
+  return To{ count };
+}
 
-  // this can't go wrong, right? den>0 is checked earlier.
+// true if Factor::num and Factor::den are exact in Rep, so the scaling
+// steps can be checked one at a time.
+template<typename Factor, typename Rep>
+SDC_RELAXED_CONSTEXPR bool
+has_exact_factor()
+{
+  return is_exactly_representable<Rep>(Factor::num) &&
+         is_exactly_representable<Rep>(Factor::den);
+}
+
+/**
+ * checks that result, computed by scale_floating<Factor>(count), is exactly
+ * count*Factor::num/Factor::den. that is the case if result*den equals
+ * count*num. both products are computed exactly as the rounded product plus
+ * its rounding error, which fma gives. the rounded parts and the errors
+ * are then equal if and only if the exact products are.
+ *
+ * the products must not overflow, and neither count nor result may be so
+ * small that the rounding errors fall below the subnormal range. that is
+ * the case if they are integral, or see is_far_from_subnormal.
+ */
+template<typename Factor, typename Rep>
+bool
+is_exact_scaling(Rep count, Rep result)
+{
+  if (!has_exact_factor<Factor, Rep>()) {
+    // the factor itself was rounded. this is only the case for extreme
+    // ratios, like atto to seconds as float. be conservative.
+    return count == 0;
+  }
+  const Rep num = static_cast<Rep>(Factor::num);
+  const Rep den = static_cast<Rep>(Factor::den);
+  const Rep lhs = result * den;
+  const Rep rhs = count * num;
+  return lhs == rhs &&
+         std::fma(result, den, -lhs) == std::fma(count, num, -rhs);
+}
+
+// 2^n, computed at compile time
+template<typename Float>
+constexpr Float
+power_of_two(int n)
+{
+  return n == 0 ? Float{ 1 } : 2 * power_of_two<Float>(n - 1);
+}
+
+/**
+ * the open interval (lo, hi) of floating point values which are in range
+ * of Int after truncation. both bounds are exact in Float, so checking
+ * lo < x < hi is exact.
+ */
+template<typename Float, typename Int>
+struct truncation_bounds
+{
+  using F = std::numeric_limits<Float>;
+  using I = std::numeric_limits<Int>;
+  static_assert(F::radix == 2, "binary floating point is assumed");
+
+  // max()+1 is a power of two, which may be too large for the exponent
+  static constexpr Float hi()
+  {
+    return I::digits >= F::max_exponent ? F::infinity()
+                                        : power_of_two<Float>(I::digits);
+  }
+
+  // the value below min(). for unsigned that is -1. for signed, min() is a
+  // power of two and the value below is either min()-1, or the next float
+  // below min() if the spacing there is larger than one.
+  static constexpr Float lo()
+  {
+    return !I::is_signed
+             ? Float{ -1 }
+             : -(power_of_two<Float>(I::digits) +
+                 power_of_two<Float>(
+                   I::digits >= F::digits ? I::digits - F::digits + 1 : 0));
+  }
+};
+
+/**
+ * multiplies count with Factor::num/Factor::den and truncates it to Int,
+ * like std::chrono::duration_cast does, or rounds it with Rounding. failed
+ * is set for NaN, infinity and results out of range.
+ *
+ * the checks are quiet comparisons against exact bounds, combined without
+ * branching. a NaN does not raise FE_INVALID, and the truncation is only
+ * done on values which fit. this makes the function suitable for batch
+ * loops.
+ */
+template<typename Factor,
+         typename Int,
+         typename Rounding = rounding::toward_zero,
+         typename Float>
+Int
+scale_floating_to_integral(Float count, bool& failed)
+{
+  static_assert(std::is_floating_point<Float>::value, "");
+  static_assert(std::is_integral<Int>::value, "");
+  static_assert(Factor::num > 0, "num must be positive");
+  static_assert(Factor::den > 0, "den must be positive");
+  using Bounds = truncation_bounds<Float, Int>;
+
+  // same overflow check as scale_floating. it is false for NaN.
+  constexpr Float max1 = std::numeric_limits<Float>::max() / Factor::num;
+  constexpr Float min1 = std::numeric_limits<Float>::lowest() / Factor::num;
+  bool ok = std::islessequal(count, max1) & std::isgreaterequal(count, min1);
+
+  // work on zero for failed elements, so nothing can overflow
+  Float scaled = ok ? count : Float{};
   if
-    SDC_CONSTEXPR_IF(Factor::den != 1) { count /= Factor::den; }
+    SDC_CONSTEXPR_IF(Factor::num != 1) { scaled *= Factor::num; }
+  if
+    SDC_CONSTEXPR_IF(Factor::den != 1) { scaled /= Factor::den; }
+  // an integral value is within the bounds if and only if it fits
+  scaled = Rounding::apply(scaled);
 
-  // convert to the to type, safely
+  ok = ok & std::isless(Bounds::lo(), scaled) &
+       std::isless(scaled, Bounds::hi());
+  failed = !ok;
+  return static_cast<Int>(ok ? scaled : Float{});
+}
+
+template<typename To, typename From>
+SDC_RELAXED_CONSTEXPR To
+safe_duration_cast_dispatch(From from, int& ec, tags::FromIsFloat, tags::ToIsInt)
+{
+  static_assert(is_floating_duration(From{}), "from must be floating point");
+  static_assert(is_integral_duration(To{}), "to must be integral");
+  ec = 0;
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using FromRep = typename From::rep;
   using ToRep = typename To::rep;
 
-  const ToRep tocount = safe_float_conversion<ToRep>(count, ec);
-  if (ec) {
+  // std::chrono::duration_cast computes in common_type<ToRep, FromRep,
+  // intmax_t>, which is FromRep. doing the same gives identical results.
+  static_assert(
+    std::is_same<typename std::common_type<ToRep, FromRep, std::intmax_t>::type,
+                 FromRep>::value,
+    "expected the intermediate type to be the floating point type");
+
+  SDC_ASSERT_FLOATING_POINT_EXCEPTION;
+  bool failed = false;
+  const ToRep count =
+    scale_floating_to_integral<Factor, ToRep>(from.count(), failed);
+  if (failed) {
+    ec = 1;
     return {};
   }
   SDC_ASSERT_FLOATING_POINT_EXCEPTION;
-  return To{ tocount };
+  return To{ count };
+}
+
+// like safe_duration_cast_dispatch, but sets ec to 2 if the result is not
+// exactly equal to the input. a count which is itself rounded when converted
+// to the floating point type counts as inexact, even in the rare case the
+// rounding errors cancel out.
+template<typename To, typename From>
+To
+exact_duration_cast_dispatch(From from,
+                             int& ec,
+                             tags::FromIsInt,
+                             tags::ToIsFloat)
+{
+  const To to = safe_duration_cast_dispatch<To>(
+    from, ec, tags::FromIsInt{}, tags::ToIsFloat{});
+  if (ec) {
+    return {};
+  }
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using ToRep = typename To::rep;
+  if (!is_exactly_representable<ToRep>(from.count()) ||
+      !is_exact_scaling<Factor>(static_cast<ToRep>(from.count()), to.count())) {
+    ec = 2;
+    return {};
+  }
+  return to;
 }
+
+// like safe_duration_cast_dispatch, but sets ec to 2 if the result was
+// truncated. count*num/den is integral if and only if den divides count,
+// since num and den are coprime.
+template<typename To, typename From>
+To
+exact_duration_cast_dispatch(From from,
+                             int& ec,
+                             tags::FromIsInt,
+                             tags::ToIsInt)
+{
+  const To to = safe_duration_cast_dispatch<To>(
+    from, ec, tags::FromIsInt{}, tags::ToIsInt{});
+  if (ec) {
+    return {};
+  }
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  if (Factor::den != 1 && !is_divisible<Factor::den>(from.count())) {
+    ec = 2;
+    return {};
+  }
+  return to;
+}
+
+// like safe_duration_cast_dispatch, but sets ec to 2 if the scaled value
+// had a fractional part which was truncated away.
+template<typename To, typename From>
+To
+exact_duration_cast_dispatch(From from,
+                             int& ec,
+                             tags::FromIsFloat,
+                             tags::ToIsInt)
+{
+  const To to = safe_duration_cast_dispatch<To>(
+    from, ec, tags::FromIsFloat{}, tags::ToIsInt{});
+  if (ec) {
+    return {};
+  }
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using FromRep = typename From::rep;
+  // the truncated value came from a floating point value, so it is exact
+  // in FromRep.
+  if (!is_exact_scaling<Factor>(from.count(),
+                                static_cast<FromRep>(to.count()))) {
+    ec = 2;
+    return {};
+  }
+  return to;
+}
+
+/**
+ * true if x is zero, or so far from the subnormal range that the rounding
+ * error of x times an integer is a normal number, which fma gives exactly.
+ */
+template<typename Float>
+bool
+is_far_from_subnormal(Float x)
+{
+  using F = std::numeric_limits<Float>;
+  constexpr Float limit = F::min() * power_of_two<Float>(F::digits);
+  return x == 0 || !std::isless(std::fabs(x), limit);
+}
+
+// like safe_duration_cast_dispatch, but sets ec to 2 if the result is not
+// exactly equal to the input, because the scaling or the conversion to
+// To::rep rounded. NaN and infinity are passed through as exact. values
+// within 2^digits of the subnormal range are reported as inexact, unless
+// they are zero, since the exactness check can not be trusted there.
+template<typename To, typename From>
+To
+exact_duration_cast_dispatch(From from,
+                             int& ec,
+                             tags::FromIsFloat,
+                             tags::ToIsFloat)
+{
+  const To to = safe_duration_cast_dispatch<To>(
+    from, ec, tags::FromIsFloat{}, tags::ToIsFloat{});
+  if (ec || !std::isfinite(from.count())) {
+    return to;
+  }
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  // both representations convert exactly to the wider one
+  using Rep =
+    typename std::common_type<typename From::rep, typename To::rep>::type;
+  const Rep count = from.count();
+  const Rep result = to.count();
+  if (!is_far_from_subnormal(count) || !is_far_from_subnormal(result) ||
+      !is_exact_scaling<Factor>(count, result)) {
+    ec = 2;
+    return {};
+  }
+  return to;
+}
+
+/**
+ * adjusts t, which is count*Factor::num/Factor::den truncated towards zero,
+ * with Rounding. the remainder count*num-t*den is smaller than den, so it is
+ * computed exactly with wrapping unsigned arithmetic, even where count*num
+ * overflows. no division is needed on top of the one which gave t.
+ *
+ * failed is set if the adjustment takes the result out of range, for
+ * instance rounding up from max(). t is then returned unchanged.
+ */
+template<typename Rounding, typename Factor, typename ToRep, typename FromRep>
+ToRep
+round_integral_quotient(FromRep count, ToRep t, bool& failed)
+{
+  // signed also when an unsigned type is involved, the remainder is negative
+  // for negative counts.
+  using I = typename std::make_signed<
+    typename std::common_type<FromRep, ToRep, std::intmax_t>::type>::type;
+  using U = typename std::make_unsigned<I>::type;
+  if (Factor::den == 1) {
+    // nothing was truncated
+    failed = false;
+    return t;
+  }
+  const I remainder = static_cast<I>(
+    static_cast<U>(static_cast<I>(count)) * static_cast<U>(Factor::num) -
+    static_cast<U>(static_cast<I>(t)) * static_cast<U>(Factor::den));
+  const int adjustment = Rounding::adjustment(
+    static_cast<I>(t), remainder, static_cast<I>(Factor::den));
+  using L = std::numeric_limits<ToRep>;
+  failed =
+    (adjustment > 0 && t == L::max()) || (adjustment < 0 && t == L::min());
+  return static_cast<ToRep>(t + (failed ? 0 : adjustment));
+}
+
+// like safe_duration_cast_dispatch, but rounds with Rounding instead of
+// truncating towards zero.
+template<typename Rounding, typename To, typename From>
+To
+rounded_duration_cast_dispatch(From from,
+                               int& ec,
+                               tags::FromIsInt,
+                               tags::ToIsInt)
+{
+  // truncation gives the result with the smallest magnitude, so if it does
+  // not fit, neither does the rounded one.
+  const To t = safe_duration_cast_dispatch<To>(
+    from, ec, tags::FromIsInt{}, tags::ToIsInt{});
+  if (ec) {
+    return {};
+  }
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  bool failed = false;
+  const auto count =
+    round_integral_quotient<Rounding, Factor>(from.count(), t.count(), failed);
+  if (failed) {
+    ec = 1;
+    return {};
+  }
+  return To{ count };
+}
+
+template<typename Rounding, typename To, typename From>
+To
+rounded_duration_cast_dispatch(From from,
+                               int& ec,
+                               tags::FromIsFloat,
+                               tags::ToIsInt)
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using ToRep = typename To::rep;
+  bool failed = false;
+  const ToRep count =
+    scale_floating_to_integral<Factor, ToRep, Rounding>(from.count(), failed);
+  if (failed) {
+    ec = 1;
+    return {};
+  }
+  return To{ count };
+}
+
 } // detail
 } // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_CHRONOCONV_DETAIL_HPP_ */
@@ -0,0 +1,101 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Testing whether an integer is divisible by a constant, without dividing.
+ * For an odd divisor d, multiplication with its inverse modulo 2^64 maps the
+ * multiples of d onto [0, (2^64-1)/d], and everything else above it. Even
+ * divisors are handled by rotating out their factors of two. See Warren,
+ * "Hacker's Delight", section 10-17, and Granlund and Montgomery, "Division
+ * by invariant integers using multiplication", PLDI 1994.
+ */
+#ifndef INCLUDE_DETAIL_DIVISIBILITY_HPP_
+#define INCLUDE_DETAIL_DIVISIBILITY_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the inverse of the odd value d, modulo 2^64. x=d is correct in the lowest
+// three bits, and each newton step doubles that.
+constexpr std::uint64_t
+inverse_mod_2_64(std::uint64_t d, std::uint64_t x, int steps)
+{
+  return steps == 0 ? x : inverse_mod_2_64(d, x * (2 - d * x), steps - 1);
+}
+
+constexpr int
+trailing_zeros(std::uint64_t d)
+{
+  return (d & 1) ? 0 : 1 + trailing_zeros(d >> 1);
+}
+
+template<std::intmax_t Den>
+struct divisibility
+{
+  static_assert(Den > 0, "the divisor must be positive");
+  static constexpr int shift = trailing_zeros(Den);
+  static constexpr std::uint64_t inverse =
+    inverse_mod_2_64(static_cast<std::uint64_t>(Den) >> shift,
+                     static_cast<std::uint64_t>(Den) >> shift,
+                     5);
+  static constexpr std::uint64_t limit =
+    std::numeric_limits<std::uint64_t>::max() / static_cast<std::uint64_t>(Den);
+
+  // true if Den divides x
+  static constexpr bool test(std::uint64_t x)
+  {
+    return rotate_right(x * inverse) <= limit;
+  }
+
+private:
+  static constexpr std::uint64_t rotate_right(std::uint64_t x)
+  {
+    // the left shift is written so it is valid also when shift is zero
+    return (x >> shift) | (x << ((64 - shift) % 64));
+  }
+};
+
+/**
+ * true if value is divisible by Den. Integers of at most 64 bits are tested
+ * through their magnitude with the multiplicative inverse, wider ones with %.
+ */
+template<std::intmax_t Den, typename Int>
+SDC_RELAXED_CONSTEXPR bool
+is_divisible(Int value, std::true_type /*at most 64 bits*/)
+{
+  // the magnitude, without overflowing for the most negative value
+  const std::uint64_t mag =
+    value < 0 ? std::uint64_t{ 0 } - static_cast<std::uint64_t>(value)
+              : static_cast<std::uint64_t>(value);
+  return divisibility<Den>::test(mag);
+}
+
+template<std::intmax_t Den, typename Int>
+constexpr bool
+is_divisible(Int value, std::false_type /*at most 64 bits*/)
+{
+  return value % static_cast<Int>(Den) == 0;
+}
+
+template<std::intmax_t Den, typename Int>
+SDC_RELAXED_CONSTEXPR bool
+is_divisible(Int value)
+{
+  static_assert(std::numeric_limits<Int>::is_integer, "Int must be integral");
+  using narrow =
+    std::integral_constant<bool, std::numeric_limits<Int>::digits <= 64>;
+  return is_divisible<Den>(value, narrow{});
+}
+
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_DIVISIBILITY_HPP_ */
@@ -0,0 +1,105 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_DETAIL_EXACT_MUL_DIV_HPP_
+#define INCLUDE_DETAIL_EXACT_MUL_DIV_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+template<std::intmax_t Num, std::intmax_t Den, typename Int>
+SDC_RELAXED_CONSTEXPR Int
+exact_mul_div_impl(Int count, int& ec, std::true_type /*can split*/)
+{
+  using L = std::numeric_limits<Int>;
+  // count = q*Den + r, so count*Num/Den = q*Num + r*Num/Den, where both terms
+  // have the same sign as count. |r| < Den, so r*Num does not overflow.
+  const Int q = count / Den;
+  const Int r = count % Den;
+
+  constexpr Int max1 = L::max() / Num;
+  constexpr Int min1 = L::min() / Num;
+  if (q > max1 || q < min1) {
+    // |q*Num| is out of range, and adding the second term only makes it
+    // larger.
+    ec = 1;
+    return {};
+  }
+  const Int whole = q * Num;
+  const Int part = r * Num / Den;
+
+  constexpr Int zero{};
+  if (part > zero && whole > L::max() - part) {
+    ec = 1;
+    return {};
+  }
+  if (part < zero && whole < L::min() - part) {
+    ec = 1;
+    return {};
+  }
+  return whole + part;
+}
+
+template<std::intmax_t Num, std::intmax_t Den, typename Int>
+SDC_RELAXED_CONSTEXPR Int
+exact_mul_div_impl(Int count, int& ec, std::false_type /*can split*/)
+{
+  using L = std::numeric_limits<Int>;
+#if SDC_HAVE_INT128
+  if
+    SDC_CONSTEXPR_IF(sizeof(Int) < sizeof(int128_t))
+    {
+      // Num and Den are too large to split, but the product fits in 128 bits.
+      using Wide =
+        typename std::conditional<L::is_signed, int128_t, uint128_t>::type;
+      const Wide wide = static_cast<Wide>(count) * Num / Den;
+      if (wide > static_cast<Wide>(L::max()) ||
+          wide < static_cast<Wide>(L::min())) {
+        ec = 1;
+        return {};
+      }
+      return static_cast<Int>(wide);
+    }
+#endif
+  // no way to do this exactly, give up.
+  ec = 1;
+  return {};
+}
+
+/**
+ * computes count*Num/Den, truncated towards zero, without overflowing in
+ * the intermediate product. ec is set if the result does not fit in Int.
+ *
+ * This costs a division and a remainder more than the straightforward
+ * count*Num/Den, so use it when count*Num is known to overflow.
+ *
+ * Num and Den must be positive.
+ */
+template<std::intmax_t Num, std::intmax_t Den, typename Int>
+SDC_RELAXED_CONSTEXPR Int
+exact_mul_div(Int count, int& ec)
+{
+  static_assert(std::numeric_limits<Int>::is_integer, "Int must be integral");
+  static_assert(Num > 0, "num must be positive");
+  static_assert(Den > 0, "den must be positive");
+  ec = 0;
+  using can_split = std::integral_constant<
+    bool,
+    static_cast<std::uintmax_t>(Den - 1) <=
+      static_cast<std::uintmax_t>(std::numeric_limits<Int>::max() / Num)>;
+  return exact_mul_div_impl<Num, Den>(count, ec, can_split{});
+}
+
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_EXACT_MUL_DIV_HPP_ */
@@ -0,0 +1,263 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Division by an invariant integer using multiplication, see
+ * Granlund and Montgomery, "Division by invariant integers using
+ * multiplication", PLDI 1994.
+ *
+ * When the divisor is a compile time constant, the compiler already does this
+ * for the / operator. This is for divisors which are known only at runtime,
+ * but are used many times.
+ */
+#ifndef INCLUDE_DETAIL_RECIPROCAL_HPP_
+#define INCLUDE_DETAIL_RECIPROCAL_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+/**
+ * the upper 64 bits of the 128 bit product of a and b.
+ */
+SDC_RELAXED_CONSTEXPR inline std::uint64_t
+mulhi_u64(std::uint64_t a, std::uint64_t b)
+{
+#if SDC_HAVE_INT128
+  return static_cast<std::uint64_t>((static_cast<uint128_t>(a) * b) >> 64);
+#else
+  const std::uint64_t a_lo = a & 0xFFFFFFFFU;
+  const std::uint64_t a_hi = a >> 32;
+  const std::uint64_t b_lo = b & 0xFFFFFFFFU;
+  const std::uint64_t b_hi = b >> 32;
+  const std::uint64_t p0 = a_lo * b_lo;
+  const std::uint64_t p1 = a_lo * b_hi;
+  const std::uint64_t p2 = a_hi * b_lo;
+  const std::uint64_t p3 = a_hi * b_hi;
+  const std::uint64_t mid =
+    (p0 >> 32) + (p1 & 0xFFFFFFFFU) + (p2 & 0xFFFFFFFFU);
+  return p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+#endif
+}
+
+/**
+ * the upper half of the product of a and b, for unsigned types of at most
+ * 64 bits.
+ */
+template<typename U>
+SDC_RELAXED_CONSTEXPR U
+mulhi_unsigned(U a, U b)
+{
+  static_assert(!std::numeric_limits<U>::is_signed, "U must be unsigned");
+  constexpr int N = std::numeric_limits<U>::digits;
+  static_assert(N <= 64, "at most 64 bits are supported");
+  if
+    SDC_CONSTEXPR_IF(N == 64)
+    {
+      return static_cast<U>(mulhi_u64(a, b));
+    }
+  else {
+    // the product fits in 64 bits. the shift is written so it is valid
+    // also when this branch is not taken.
+    return static_cast<U>((std::uint64_t{ a } * b) >> (N % 64));
+  }
+}
+
+/**
+ * the upper half of the product of the signed values a and b, for signed
+ * types of at most 64 bits.
+ */
+template<typename S>
+SDC_RELAXED_CONSTEXPR S
+mulhi_signed(S a, S b)
+{
+  using U = typename std::make_unsigned<S>::type;
+  constexpr int N = std::numeric_limits<U>::digits;
+#if SDC_HAVE_INT128
+  if
+    SDC_CONSTEXPR_IF(N == 64)
+    {
+      // a single signed multiplication
+      return static_cast<S>((static_cast<int128_t>(a) * b) >> 64);
+    }
+#endif
+  if
+    SDC_CONSTEXPR_IF(N < 64)
+    {
+      // the product fits in 64 bits
+      return static_cast<S>((std::int64_t{ a } * b) >> (N % 64));
+    }
+  // the signed high part differs from the unsigned one by a correction for
+  // each negative operand.
+  U hi = mulhi_unsigned<U>(static_cast<U>(a), static_cast<U>(b));
+  if (a < 0) {
+    hi = static_cast<U>(hi - static_cast<U>(b));
+  }
+  if (b < 0) {
+    hi = static_cast<U>(hi - static_cast<U>(a));
+  }
+  return static_cast<S>(hi);
+}
+
+/**
+ * floor((hi*2^N+lo)/d) for an N bit unsigned type, where hi<d so the quotient
+ * fits in N bits. This is plain long division, one bit at a time. It is only
+ * used when setting up a reciprocal, so speed does not matter.
+ */
+template<typename U>
+SDC_RELAXED_CONSTEXPR U
+divide_wide(U hi, U lo, U d)
+{
+  constexpr int N = std::numeric_limits<U>::digits;
+  U rem = hi;
+  U quotient = 0;
+  for (int i = N - 1; i >= 0; --i) {
+    const bool carry = (rem >> (N - 1)) != 0;
+    rem = static_cast<U>((rem << 1) | ((lo >> i) & 1U));
+    quotient = static_cast<U>(quotient << 1);
+    if (carry || rem >= d) {
+      rem = static_cast<U>(rem - d);
+      quotient |= 1U;
+    }
+  }
+  return quotient;
+}
+
+// ceil(log2(d)) for d>0
+template<typename U>
+SDC_RELAXED_CONSTEXPR int
+ceil_log2(U d)
+{
+  int l = 0;
+  while (l < std::numeric_limits<U>::digits && (U{ 1 } << l) < d) {
+    ++l;
+  }
+  return l;
+}
+
+template<typename T, bool IsSigned = std::numeric_limits<T>::is_signed>
+class reciprocal_impl;
+
+// for unsigned types, any divisor d>0 is supported.
+template<typename T>
+class reciprocal_impl<T, false>
+{
+public:
+  SDC_RELAXED_CONSTEXPR explicit reciprocal_impl(T d)
+    : m_multiplier()
+    , m_shift1()
+    , m_shift2()
+  {
+    // with l=ceil(log2(d)), the multiplier is floor(2^N*(2^l-d)/d)+1
+    constexpr int N = std::numeric_limits<T>::digits;
+    const int l = ceil_log2(d);
+    const T two_l = l == N ? T{ 0 } : static_cast<T>(T{ 1 } << (l % N));
+    m_multiplier =
+      static_cast<T>(divide_wide<T>(static_cast<T>(two_l - d), 0, d) + 1U);
+    m_shift1 = l < 1 ? l : 1;
+    m_shift2 = l > 1 ? l - 1 : 0;
+  }
+
+  SDC_RELAXED_CONSTEXPR T divide(T n) const
+  {
+    const T t1 = mulhi_unsigned<T>(m_multiplier, n);
+    return static_cast<T>(
+      static_cast<T>(t1 + static_cast<T>(static_cast<T>(n - t1) >> m_shift1)) >>
+      m_shift2);
+  }
+
+private:
+  T m_multiplier;
+  int m_shift1;
+  int m_shift2;
+};
+
+// for signed types, the divisor must be positive.
+template<typename T>
+class reciprocal_impl<T, true>
+{
+  using U = typename std::make_unsigned<T>::type;
+
+public:
+  SDC_RELAXED_CONSTEXPR explicit reciprocal_impl(T d)
+    : m_multiplier()
+    , m_shift()
+  {
+    // with l=max(ceil(log2(d)),1), the multiplier is
+    // floor(2^(N+l-1)/d)+1-2^N, where N is the number of bits.
+    const U ud = static_cast<U>(d);
+    const int l = ceil_log2(ud) > 1 ? ceil_log2(ud) : 1;
+    if (ud == 1) {
+      // the quotient would need N+1 bits, but it is 2^N which vanishes
+      // modulo 2^N.
+      m_multiplier = 1;
+    } else {
+      const U q = divide_wide<U>(static_cast<U>(U{ 1 } << (l - 1)), 0, ud);
+      m_multiplier = static_cast<T>(static_cast<U>(q + 1U));
+    }
+    m_shift = l - 1;
+  }
+
+  SDC_RELAXED_CONSTEXPR T divide(T n) const
+  {
+    // wraparound arithmetic is done on the unsigned type. right shifting
+    // negative values is assumed to be arithmetic.
+    const T q0 = static_cast<T>(static_cast<U>(n) +
+                                static_cast<U>(mulhi_signed(m_multiplier, n)));
+    const U sign = n < 0 ? U{ 1 } : U{ 0 };
+    return static_cast<T>(static_cast<U>(static_cast<U>(q0 >> m_shift) + sign));
+  }
+
+private:
+  T m_multiplier;
+  int m_shift;
+};
+
+/**
+ * divides by a fixed divisor, using a multiplication and shifts instead of a
+ * division instruction. the result is truncated towards zero, like the /
+ * operator.
+ *
+ * The divisor must be positive. Integral types up to 64 bits, signed or
+ * unsigned, are supported.
+ */
+template<typename T>
+class reciprocal
+{
+  static_assert(std::numeric_limits<T>::is_integer, "T must be integral");
+  static_assert(std::numeric_limits<T>::digits <= 64,
+                "at most 64 bits are supported");
+
+public:
+  SDC_RELAXED_CONSTEXPR explicit reciprocal(T d)
+    : m_impl(d)
+    , m_divisor(d)
+  {}
+
+  // n/divisor()
+  SDC_RELAXED_CONSTEXPR T divide(T n) const { return m_impl.divide(n); }
+
+  // n%divisor()
+  SDC_RELAXED_CONSTEXPR T remainder(T n) const
+  {
+    return static_cast<T>(n - divide(n) * m_divisor);
+  }
+
+  constexpr T divisor() const { return m_divisor; }
+
+private:
+  reciprocal_impl<T> m_impl;
+  T m_divisor;
+};
+
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_RECIPROCAL_HPP_ */
@@ -0,0 +1,107 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Rounding modes for conversions to integral durations. Each mode knows how
+ * to round a floating point value to an integral one, and how to adjust a
+ * quotient truncated towards zero given the remainder of the division.
+ */
+#ifndef INCLUDE_DETAIL_ROUNDING_HPP_
+#define INCLUDE_DETAIL_ROUNDING_HPP_
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace safe_duration_cast {
+namespace detail {
+namespace rounding {
+
+// what duration_cast does
+struct toward_zero
+{
+  template<typename Float>
+  static Float apply(Float x)
+  {
+    // the conversion to integral truncates
+    return x;
+  }
+
+  template<typename Int>
+  static int adjustment(Int /*quotient*/, Int /*remainder*/, Int /*den*/)
+  {
+    return 0;
+  }
+};
+
+// like std::chrono::floor
+struct down
+{
+  template<typename Float>
+  static Float apply(Float x)
+  {
+    return std::floor(x);
+  }
+
+  template<typename Int>
+  static int adjustment(Int /*quotient*/, Int remainder, Int /*den*/)
+  {
+    return remainder < 0 ? -1 : 0;
+  }
+};
+
+// like std::chrono::ceil
+struct up
+{
+  template<typename Float>
+  static Float apply(Float x)
+  {
+    return std::ceil(x);
+  }
+
+  template<typename Int>
+  static int adjustment(Int /*quotient*/, Int remainder, Int /*den*/)
+  {
+    return remainder > 0 ? 1 : 0;
+  }
+};
+
+// like std::chrono::round, to nearest with ties to even
+struct to_nearest_even
+{
+  template<typename Float>
+  static Float apply(Float x)
+  {
+    // does not depend on the floating point rounding mode, unlike
+    // std::nearbyint. x-t is exact.
+    const Float t = std::trunc(x);
+    const Float frac = std::fabs(x - t);
+    const Float half = t * Float(0.5);
+    const bool odd = std::trunc(half) != half;
+    const bool away = frac > Float(0.5) || (frac == Float(0.5) && odd);
+    return away ? t + std::copysign(Float(1), x) : t;
+  }
+
+  // the quotient was truncated towards zero, and |remainder| < den has the
+  // sign of the dividend.
+  template<typename Int>
+  static int adjustment(Int quotient, Int remainder, Int den)
+  {
+    using U = typename std::make_unsigned<Int>::type;
+    const U mag = remainder < 0 ? static_cast<U>(U{ 0 } - U(remainder))
+                                : static_cast<U>(remainder);
+    // compares 2*mag with den, without overflowing
+    const U rest = static_cast<U>(den) - mag;
+    const bool odd = (static_cast<U>(quotient) & 1U) != 0;
+    const bool away = mag > rest || (mag == rest && odd);
+    return away ? (remainder < 0 ? -1 : 1) : 0;
+  }
+};
+
+} // namespace rounding
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_ROUNDING_HPP_ */
@@ -0,0 +1,228 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_DETAIL_SAFE_RANGE_HPP_
+#define INCLUDE_DETAIL_SAFE_RANGE_HPP_
+
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+#include <safe_duration_cast/detail/stdutils.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+// a quotient and remainder, x = quot * n + rem with rem < n
+template<typename U>
+struct quot_rem
+{
+  U quot;
+  U rem;
+};
+
+// the quotient and remainder of 2x, given those of x
+template<typename U>
+constexpr quot_rem<U>
+twice(quot_rem<U> x, U n)
+{
+  return x.rem >= n - x.rem ? quot_rem<U>{ 2 * x.quot + 1, x.rem - (n - x.rem) }
+                            : quot_rem<U>{ 2 * x.quot, 2 * x.rem };
+}
+
+// the quotient and remainder of x + a, given those of x. a must be less
+// than n.
+template<typename U>
+constexpr quot_rem<U>
+plus(quot_rem<U> x, U a, U n)
+{
+  return x.rem >= n - a ? quot_rem<U>{ x.quot + 1, x.rem - (n - a) }
+                        : quot_rem<U>{ x.quot, x.rem + a };
+}
+
+template<typename U>
+constexpr quot_rem<U>
+wide_mul_div_step(quot_rem<U> half, U a, bool odd, U n)
+{
+  return odd ? plus(twice(half, n), a, n) : twice(half, n);
+}
+
+// the quotient and remainder of a*b/n, without overflowing in the product.
+// a must be less than n, which makes the quotient less than b. recurses
+// once per bit of b.
+template<typename U>
+constexpr quot_rem<U>
+wide_mul_div(U a, U b, U n)
+{
+  return b == 0 ? quot_rem<U>{ 0, 0 }
+                : wide_mul_div_step(
+                    wide_mul_div(a, U(b / 2), n), a, b % 2 != 0, n);
+}
+
+template<typename U>
+constexpr U
+saturating_mul(U a, U b)
+{
+  return b != 0 && a > std::numeric_limits<U>::max() / b
+           ? std::numeric_limits<U>::max()
+           : a * b;
+}
+
+template<typename U>
+constexpr U
+saturating_add(U a, U b)
+{
+  return a > std::numeric_limits<U>::max() - b ? std::numeric_limits<U>::max()
+                                                : a + b;
+}
+
+template<typename U>
+constexpr U
+min_of(U a, U b)
+{
+  return a < b ? a : b;
+}
+
+/**
+ * the range of counts which safe_duration_cast_dispatch converts from an
+ * integral FromRep to an integral ToRep without error, when the factor
+ * between the periods is num/den (reduced, and both positive).
+ *
+ * the conversion is trunc(x*num/den), where the product is evaluated exactly
+ * if it can be. that is monotonic in x, so the range is an interval which
+ * contains zero. its ends are computed from the largest magnitude the result
+ * may have on either side. all arithmetic is done on magnitudes, in the
+ * unsigned type of IntermediateRep.
+ *
+ * num and den are arguments rather than template parameters, so the range
+ * can be computed at runtime as well.
+ */
+template<typename FromRep, typename ToRep, typename IntermediateRep>
+struct count_safe_range
+{
+  using U = typename std::make_unsigned<IntermediateRep>::type;
+  using I = std::numeric_limits<IntermediateRep>;
+
+  // the magnitude of the lowest value of a signed Int
+  template<typename Int>
+  static constexpr U lowest_magnitude()
+  {
+    using L = std::numeric_limits<Int>;
+    return L::is_signed
+             ? static_cast<U>(-(static_cast<IntermediateRep>(L::min()) + 1)) + 1
+             : U{ 0 };
+  }
+
+  // the exact path in exact_mul_div gives up if num and den are too large
+  // to split, and there is no wider type. then count*num must fit.
+  static constexpr bool gives_up(U num, U den)
+  {
+    return num != 1 && U(den - 1) > U(static_cast<U>(I::max()) / num) &&
+#if SDC_HAVE_INT128
+           sizeof(IntermediateRep) >= sizeof(int128_t)
+#else
+           true
+#endif
+      ;
+  }
+
+  // floor(((m+1)*den-1)/num), the largest x for which x*num/den truncates
+  // to at most m, or the max of U if that is larger. with m = q*num + r, it
+  // is q*den + floor(((r+1)*den-1)/num) where the second term is below den.
+  static constexpr U largest_input(U m, U num, U den)
+  {
+    return saturating_add(saturating_mul(U(m / num), den),
+                          remainder_term(U(m % num + 1), num, den));
+  }
+  static constexpr U remainder_term(U r1, U num, U den)
+  {
+    return r1 == num ? U(den - 1) : floor_minus_one(wide_mul_div(r1, den, num));
+  }
+  static constexpr U floor_minus_one(quot_rem<U> x)
+  {
+    return x.rem > 0 ? x.quot : U(x.quot - 1);
+  }
+
+  static constexpr U max_magnitude(U num, U den)
+  {
+    return min_of(
+      min_of(static_cast<U>(std::numeric_limits<FromRep>::max()),
+             largest_input(
+               static_cast<U>(std::numeric_limits<ToRep>::max()), num, den)),
+      gives_up(num, den) ? U(static_cast<U>(I::max()) / num)
+                         : std::numeric_limits<U>::max());
+  }
+
+  // negative counts need a signed intermediate, and may round to zero even
+  // if To is unsigned.
+  static constexpr U min_magnitude(U num, U den)
+  {
+    return !I::is_signed
+             ? U{ 0 }
+             : min_of(min_of(lowest_magnitude<FromRep>(),
+                             largest_input(
+                               lowest_magnitude<ToRep>(), num, den)),
+                      gives_up(num, den)
+                        ? U(lowest_magnitude<IntermediateRep>() / num)
+                        : std::numeric_limits<U>::max());
+  }
+
+  static constexpr FromRep max_count(U num, U den)
+  {
+    return static_cast<FromRep>(max_magnitude(num, den));
+  }
+  static constexpr FromRep min_count(U num, U den)
+  {
+    return to_negative_count(min_magnitude(num, den));
+  }
+  static constexpr FromRep to_negative_count(U magnitude)
+  {
+    return magnitude == 0
+             ? FromRep{}
+             : static_cast<FromRep>(
+                 -static_cast<IntermediateRep>(magnitude - 1) - 1);
+  }
+};
+
+/**
+ * the safe range of counts for converting the integral duration From to the
+ * integral duration To, see count_safe_range.
+ */
+template<typename From, typename To>
+struct integral_safe_range
+  : count_safe_range<
+      typename From::rep,
+      typename To::rep,
+      typename std::common_type<typename From::rep,
+                                typename To::rep,
+                                std::intmax_t>::type>
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  static_assert(Factor::num > 0, "num must be positive");
+  static_assert(Factor::den > 0, "den must be positive");
+
+  using FromRep = typename From::rep;
+  using ToRep = typename To::rep;
+  using IntermediateRep =
+    typename std::common_type<FromRep, ToRep, decltype(Factor::num)>::type;
+  using Base = count_safe_range<FromRep, ToRep, IntermediateRep>;
+  using U = typename Base::U;
+
+  static constexpr U num = static_cast<U>(Factor::num);
+  static constexpr U den = static_cast<U>(Factor::den);
+
+  static constexpr bool gives_up() { return Base::gives_up(num, den); }
+  static constexpr U max_magnitude() { return Base::max_magnitude(num, den); }
+  static constexpr U min_magnitude() { return Base::min_magnitude(num, den); }
+  static constexpr FromRep max_count() { return Base::max_count(num, den); }
+  static constexpr FromRep min_count() { return Base::min_count(num, den); }
+};
+
+} // namespace detail
+} // namespace safe_duration_cast
+#endif /* INCLUDE_DETAIL_SAFE_RANGE_HPP_ */
@@ -24,3 +24,17 @@
 #else
 #define SDC_RELAXED_CONSTEXPR
 #endif
+
+// gcc and clang have a 128 bit integer type on 64 bit targets.
+// __extension__ keeps -pedantic quiet about it.
+#if defined(__SIZEOF_INT128__)
+#define SDC_HAVE_INT128 1
+namespace safe_duration_cast {
+namespace detail {
+__extension__ typedef __int128 int128_t;
+__extension__ typedef unsigned __int128 uint128_t;
+} // namespace detail
+} // namespace safe_duration_cast
+#else
+#define SDC_HAVE_INT128 0
+#endif
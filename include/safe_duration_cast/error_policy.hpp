@@ -0,0 +1,182 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_ERROR_POLICY_HPP_
+#define INCLUDE_ERROR_POLICY_HPP_
+
+#include <chrono>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/saturate.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * Error policies decide what happens when a conversion fails. A policy has
+ * a member function
+ *
+ *   template<typename To, typename From> To on_error(From from, int ec);
+ *
+ * which is called with the input and the nonzero error code, and gives the
+ * result (or does not return). It also has
+ *
+ *   void on_success();
+ *
+ * which is called when the conversion succeeds. Since the policy is a
+ * template parameter, the calls are resolved at compile time and inlined.
+ */
+namespace error_policy {
+
+// inherit from this to be recognized as an error policy
+struct policy_tag
+{};
+
+// sets an error code, like the safe_duration_cast(from, ec) overload
+struct error_code : policy_tag
+{
+  explicit error_code(int& ec_)
+    : ec(ec_)
+  {}
+  template<typename To, typename From>
+  To on_error(From /*from*/, int code)
+  {
+    ec = code;
+    return {};
+  }
+  void on_success() { ec = 0; }
+
+  int& ec;
+};
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throws, like the safe_duration_cast(from) overload
+struct throw_exception : policy_tag
+{
+  template<typename To, typename From>
+  To on_error(From /*from*/, int /*code*/)
+  {
+    throw std::runtime_error("failed conversion");
+  }
+  void on_success() {}
+};
+#endif
+
+// clamps, like saturate_duration_cast
+struct saturate : policy_tag
+{
+  template<typename To, typename From>
+  To on_error(From from, int /*code*/)
+  {
+    using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+    return detail::saturation_limit<To>(from, FromTag{});
+  }
+  void on_success() {}
+};
+
+// terminates the program, for conversions which are not supposed to fail
+struct abort : policy_tag
+{
+  template<typename To, typename From>
+  To on_error(From /*from*/, int /*code*/)
+  {
+    std::abort();
+  }
+  void on_success() {}
+};
+
+// calls f(ec) and gives a zero result. use make_callback to create one.
+template<typename F>
+struct callback : policy_tag
+{
+  explicit callback(F f_)
+    : f(std::move(f_))
+  {}
+  template<typename To, typename From>
+  To on_error(From /*from*/, int code)
+  {
+    f(code);
+    return {};
+  }
+  void on_success() {}
+
+  F f;
+};
+
+template<typename F>
+callback<F>
+make_callback(F f)
+{
+  return callback<F>(std::move(f));
+}
+
+// ORs errors into an accumulator, which is left untouched on success. check
+// it once after a whole sequence of conversions.
+struct sticky : policy_tag
+{
+  explicit sticky(int& accumulator_)
+    : accumulator(accumulator_)
+  {}
+  template<typename To, typename From>
+  To on_error(From /*from*/, int code)
+  {
+    accumulator |= code;
+    return {};
+  }
+  void on_success() {}
+
+  int& accumulator;
+};
+
+} // namespace error_policy
+
+template<typename T>
+struct is_error_policy
+  : std::is_base_of<error_policy::policy_tag, typename std::decay<T>::type>
+{};
+
+/**
+ * converts like safe_duration_cast, handling errors as the given policy
+ * object says.
+ */
+template<typename To,
+         typename FromRep,
+         typename FromPeriod,
+         typename Policy,
+         typename std::enable_if<is_error_policy<Policy>::value, int>::type = 0>
+To
+safe_duration_cast(std::chrono::duration<FromRep, FromPeriod> from,
+                   Policy&& policy)
+{
+  int ec = 0;
+  const To to = safe_duration_cast<To>(from, ec);
+  if (ec) {
+    return policy.template on_error<To>(from, ec);
+  }
+  policy.on_success();
+  return to;
+}
+
+/**
+ * converts like safe_duration_cast, handling errors as the policy type
+ * says. only for policies without state, like error_policy::saturate.
+ */
+template<typename To,
+         typename Policy,
+         typename FromRep,
+         typename FromPeriod,
+         typename std::enable_if<is_error_policy<Policy>::value, int>::type = 0>
+To
+safe_duration_cast(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  return safe_duration_cast<To>(from, Policy{});
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_ERROR_POLICY_HPP_ */
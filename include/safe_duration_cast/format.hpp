@@ -0,0 +1,437 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_FORMAT_HPP_
+#define INCLUDE_FORMAT_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+#include <system_error>
+#include <type_traits>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/compare.hpp>
+#include <safe_duration_cast/detail/reciprocal.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * the outcome of formatting, like std::to_chars_result from C++17. ptr is
+ * one past the last character written. if the output did not fit, ptr is
+ * last and ec is std::errc::value_too_large, and the contents of the range
+ * are unspecified.
+ */
+struct to_chars_result
+{
+  char* ptr;
+  std::errc ec;
+};
+
+namespace detail {
+
+// "00" to "99", for writing two digits at a time
+inline const char*
+digit_pairs()
+{
+  static const char pairs[] = "00010203040506070809"
+                              "10111213141516171819"
+                              "20212223242526272829"
+                              "30313233343536373839"
+                              "40414243444546474849"
+                              "50515253545556575859"
+                              "60616263646566676869"
+                              "70717273747576777879"
+                              "80818283848586878889"
+                              "90919293949596979899";
+  return pairs;
+}
+
+// 10^n, for n in [0, 19]
+constexpr std::uint64_t
+pow10_u64(int n)
+{
+  return n == 0 ? 1 : 10 * pow10_u64(n - 1);
+}
+
+// n such that 10^n == den, or -1 if there is none
+constexpr int
+decimal_exponent(std::intmax_t den, int n = 0)
+{
+  return den == 1 ? n
+                  : (den % 10 != 0 ? -1 : decimal_exponent(den / 10, n + 1));
+}
+
+/**
+ * writes v in decimal, ending at end. returns where it starts. the digits
+ * are made two at a time, the divisions are by constants and compile to
+ * multiplications.
+ */
+inline char*
+write_digits_backwards(char* end, std::uint64_t v)
+{
+  const char* pairs = digit_pairs();
+  while (v >= 100) {
+    const std::size_t i = static_cast<std::size_t>(v % 100) * 2;
+    v /= 100;
+    *--end = pairs[i + 1];
+    *--end = pairs[i];
+  }
+  if (v >= 10) {
+    const std::size_t i = static_cast<std::size_t>(v) * 2;
+    *--end = pairs[i + 1];
+    *--end = pairs[i];
+  } else {
+    *--end = static_cast<char>('0' + v);
+  }
+  return end;
+}
+
+/**
+ * (hi*2^64 + lo) / d, leaving the quotient in hi and lo and returning the
+ * remainder. the common case with hi zero is one division by d, which is a
+ * multiplication when d is a constant. otherwise it is long division.
+ */
+inline std::uint64_t
+divmod_wide(std::uint64_t& hi, std::uint64_t& lo, std::uint64_t d)
+{
+  if (hi == 0) {
+    const std::uint64_t q = lo / d;
+    const std::uint64_t rem = lo - q * d;
+    lo = q;
+    return rem;
+  }
+  const std::uint64_t r = hi % d;
+  hi /= d;
+  const std::uint64_t q = divide_wide(r, lo, d);
+  // the remainder is less than d, so it is right modulo 2^64
+  const std::uint64_t rem = lo - q * d;
+  lo = q;
+  return rem;
+}
+
+/**
+ * writes into [first, last), remembering if anything did not fit. the
+ * largest number written is below 2^128, which has 39 digits.
+ */
+class char_writer
+{
+public:
+  char_writer(char* first, char* last)
+    : m_ptr(first)
+    , m_last(last)
+    , m_overflow(false)
+  {}
+
+  void put(char c)
+  {
+    if (m_ptr == m_last) {
+      m_overflow = true;
+      return;
+    }
+    *m_ptr++ = c;
+  }
+
+  void put(const char* str)
+  {
+    while (*str) {
+      put(*str++);
+    }
+  }
+
+  void put_range(const char* first, const char* last)
+  {
+    if (last - first > m_last - m_ptr) {
+      m_overflow = true;
+      return;
+    }
+    while (first != last) {
+      *m_ptr++ = *first++;
+    }
+  }
+
+  void put_digits(std::uint64_t v)
+  {
+    char buf[20];
+    put_range(write_digits_backwards(buf + sizeof(buf), v), buf + sizeof(buf));
+  }
+
+  // v with leading zeros to width digits, for v < 10^width
+  void put_padded(std::uint64_t v, int width)
+  {
+    char buf[20];
+    char* start = write_digits_backwards(buf + sizeof(buf), v);
+    while (buf + sizeof(buf) - start < width) {
+      *--start = '0';
+    }
+    put_range(start, buf + sizeof(buf));
+  }
+
+  // hi*2^64 + lo, in chunks of 19 digits
+  void put_wide(std::uint64_t hi, std::uint64_t lo)
+  {
+    constexpr std::uint64_t chunk = pow10_u64(19);
+    std::uint64_t chunks[2];
+    int n = 0;
+    while (hi != 0) {
+      chunks[n++] = divmod_wide(hi, lo, chunk);
+    }
+    put_digits(lo);
+    while (n > 0) {
+      put_padded(chunks[--n], 19);
+    }
+  }
+
+  // "." and the digits of frac/10^digits without trailing zeros, or
+  // nothing if frac is zero
+  void put_fraction(std::uint64_t frac, int digits)
+  {
+    if (frac == 0) {
+      return;
+    }
+    while (frac % 10 == 0) {
+      frac /= 10;
+      --digits;
+    }
+    put('.');
+    put_padded(frac, digits);
+  }
+
+  to_chars_result result() const
+  {
+    if (m_overflow) {
+      return to_chars_result{ m_last, std::errc::value_too_large };
+    }
+    return to_chars_result{ m_ptr, std::errc{} };
+  }
+
+private:
+  char* m_ptr;
+  char* m_last;
+  bool m_overflow;
+};
+
+// the unit suffix of Period, the same ones safe_parse_duration reads
+template<typename Period>
+void
+put_unit(char_writer& out)
+{
+  using P = std::ratio<Period::num, Period::den>;
+  if (std::is_same<P, std::nano>::value) {
+    out.put("ns");
+  } else if (std::is_same<P, std::micro>::value) {
+    out.put("us");
+  } else if (std::is_same<P, std::milli>::value) {
+    out.put("ms");
+  } else if (std::is_same<P, std::ratio<1>>::value) {
+    out.put('s');
+  } else if (std::is_same<P, std::ratio<60>>::value) {
+    out.put('m');
+  } else if (std::is_same<P, std::ratio<3600>>::value) {
+    out.put('h');
+  } else {
+    // like std::chrono formats other periods in C++20, [num/den]s
+    out.put('[');
+    out.put_digits(static_cast<std::uint64_t>(P::num));
+    if (P::den != 1) {
+      out.put('/');
+      out.put_digits(static_cast<std::uint64_t>(P::den));
+    }
+    out.put("]s");
+  }
+}
+
+/**
+ * the magnitude of a duration as whole seconds, hi*2^64 + lo, and the
+ * fraction of a second frac/10^digits.
+ */
+struct split_magnitude
+{
+  std::uint64_t hi;
+  std::uint64_t lo;
+  std::uint64_t frac;
+  int digits;
+};
+
+// for periods which are a whole number of seconds. the product may need
+// more than 64 bits.
+template<typename Period>
+split_magnitude
+split_count(std::uint64_t m, std::true_type /*whole seconds*/)
+{
+  constexpr std::uint64_t num = static_cast<std::uint64_t>(Period::num);
+  return split_magnitude{ mulhi_u64(m, num), m * num, 0, 0 };
+}
+
+// for periods which are 1/10^n seconds
+template<typename Period>
+split_magnitude
+split_count(std::uint64_t m, std::false_type /*whole seconds*/)
+{
+  constexpr int digits = decimal_exponent(Period::den);
+  constexpr std::uint64_t den = static_cast<std::uint64_t>(Period::den);
+  return split_magnitude{ 0, m / den, m % den, digits };
+}
+
+template<typename Rep, typename Period>
+split_magnitude
+split_at_seconds(std::chrono::duration<Rep, Period> d, bool& negative)
+{
+  static_assert(std::is_integral<Rep>::value && sizeof(Rep) <= 8,
+                "only integral representations of at most 64 bits are "
+                "supported");
+  static_assert(Period::den == 1 || (Period::num == 1 &&
+                                     decimal_exponent(Period::den) >= 0),
+                "the period must be whole seconds or 1/10^n seconds");
+  negative = is_negative(d.count());
+  const std::uint64_t m = magnitude<std::uint64_t>(d.count());
+  using whole = std::integral_constant<bool, Period::den == 1>;
+  return split_count<Period>(m, whole{});
+}
+
+// a nonzero part of a second, frac/10^digits, in the largest of ms, us and
+// ns which gives an integral part, like go's Duration.String
+inline void
+put_sub_second(char_writer& out, std::uint64_t frac, int digits)
+{
+  static const char* const units[] = { "ms", "us", "ns" };
+  for (int i = 0; i < 3; ++i) {
+    const int e = 3 * (i + 1);
+    if (e >= digits) {
+      out.put_digits(frac * pow10_u64(e - digits));
+      out.put(units[i]);
+      return;
+    }
+    const std::uint64_t p = pow10_u64(digits - e);
+    if (frac >= p || e == 9) {
+      out.put_digits(frac / p);
+      out.put_fraction(frac % p, digits - e);
+      out.put(units[i]);
+      return;
+    }
+  }
+}
+
+} // namespace detail
+
+/**
+ * writes the count of d and its unit, like "150ms", without allocating.
+ * the units are ns, us, ms, s, m and h, which safe_parse_duration reads
+ * back, and [num/den]s for other periods.
+ *
+ * integral representations of at most 64 bits are supported. the longest
+ * output is a sign, 20 digits and the unit.
+ */
+template<typename Rep, typename Period>
+to_chars_result
+to_chars(char* first, char* last, std::chrono::duration<Rep, Period> d)
+{
+  static_assert(std::is_integral<Rep>::value && sizeof(Rep) <= 8,
+                "only integral representations of at most 64 bits are "
+                "supported");
+  detail::char_writer out(first, last);
+  if (detail::is_negative(d.count())) {
+    out.put('-');
+  }
+  out.put_digits(detail::magnitude<std::uint64_t>(d.count()));
+  detail::put_unit<Period>(out);
+  return out.result();
+}
+
+/**
+ * writes d split into hours, minutes and seconds, like "1h02m03.004s".
+ * leading units which are zero are left out, "2m03.5s" and "3.004s", and
+ * so are trailing zeros of the fraction. a duration shorter than a second
+ * is written in ms, us or ns like "1.5ms", and zero as "0s".
+ *
+ * the period must be whole seconds, like minutes, or 1/10^n seconds, like
+ * milliseconds. the splits are divisions by constants, which the compiler
+ * turns into multiplications. the number of hours may need more than 64
+ * bits for coarse periods, which is handled exactly, so all values can be
+ * written.
+ */
+template<typename Rep, typename Period>
+to_chars_result
+to_chars_humanized(char* first,
+                   char* last,
+                   std::chrono::duration<Rep, Period> d)
+{
+  detail::char_writer out(first, last);
+  bool negative;
+  detail::split_magnitude s = detail::split_at_seconds(d, negative);
+  if (negative) {
+    out.put('-');
+  }
+  if (s.hi == 0 && s.lo == 0) {
+    if (s.frac == 0) {
+      out.put("0s");
+    } else {
+      detail::put_sub_second(out, s.frac, s.digits);
+    }
+    return out.result();
+  }
+  const std::uint64_t rem = detail::divmod_wide(s.hi, s.lo, 3600);
+  if (s.hi != 0 || s.lo != 0) {
+    out.put_wide(s.hi, s.lo);
+    out.put('h');
+    out.put_padded(rem / 60, 2);
+    out.put('m');
+    out.put_padded(rem % 60, 2);
+  } else if (rem >= 60) {
+    out.put_digits(rem / 60);
+    out.put('m');
+    out.put_padded(rem % 60, 2);
+  } else {
+    out.put_digits(rem);
+  }
+  out.put_fraction(s.frac, s.digits);
+  out.put('s');
+  return out.result();
+}
+
+/**
+ * writes d in seconds with precision digits after the decimal point, like
+ * "-1.500s" for precision 3. digits beyond the period are zero, and digits
+ * beyond precision are truncated, like duration_cast does. the sign is the
+ * one of d, so -1 ns with precision 3 is "-0.000s".
+ *
+ * the period must be whole seconds or 1/10^n seconds. ec is
+ * std::errc::invalid_argument if precision is negative.
+ */
+template<typename Rep, typename Period>
+to_chars_result
+to_chars_seconds(char* first,
+                 char* last,
+                 std::chrono::duration<Rep, Period> d,
+                 int precision)
+{
+  if (precision < 0) {
+    return to_chars_result{ first, std::errc::invalid_argument };
+  }
+  detail::char_writer out(first, last);
+  bool negative;
+  const detail::split_magnitude s = detail::split_at_seconds(d, negative);
+  if (negative) {
+    out.put('-');
+  }
+  out.put_wide(s.hi, s.lo);
+  if (precision > 0) {
+    out.put('.');
+    const int kept = precision < s.digits ? precision : s.digits;
+    if (kept > 0) {
+      out.put_padded(s.frac / detail::pow10_u64(s.digits - kept), kept);
+    }
+    for (int i = kept; i < precision; ++i) {
+      out.put('0');
+    }
+  }
+  out.put('s');
+  return out.result();
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_FORMAT_HPP_ */
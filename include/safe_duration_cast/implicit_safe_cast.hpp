@@ -0,0 +1,104 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_IMPLICIT_SAFE_CAST_HPP_
+#define INCLUDE_IMPLICIT_SAFE_CAST_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/safe_range.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the number of bits needed to represent x
+constexpr int
+bit_width(std::uintmax_t x)
+{
+  return x == 0 ? 0 : 1 + bit_width(x / 2);
+}
+
+template<typename From,
+         typename To,
+         typename FromTag = typename dispatch_tags<From, To>::FromTag,
+         typename ToTag = typename dispatch_tags<From, To>::ToTag>
+struct always_safe : std::false_type
+{};
+
+// integral to integral: the factor is a whole number, and every input is in
+// the safe range.
+template<typename From, typename To>
+struct always_safe<From, To, tags::FromIsInt, tags::ToIsInt>
+{
+  using Range = integral_safe_range<From, To>;
+  using L = std::numeric_limits<typename From::rep>;
+  static constexpr bool value = Range::Factor::den == 1 &&
+                                Range::min_count() == L::min() &&
+                                Range::max_count() == L::max();
+};
+
+// integral to floating point: the factor is a whole number, and the product
+// fits in the mantissa.
+template<typename From, typename To>
+struct always_safe<From, To, tags::FromIsInt, tags::ToIsFloat>
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  static constexpr bool value =
+    Factor::den == 1 &&
+    std::numeric_limits<typename From::rep>::digits +
+        bit_width(static_cast<std::uintmax_t>(Factor::num)) <=
+      std::numeric_limits<typename To::rep>::digits;
+};
+
+// floating point to floating point: the same unit, and To has at least the
+// precision and exponent range of From.
+template<typename From, typename To>
+struct always_safe<From, To, tags::FromIsFloat, tags::ToIsFloat>
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using F = std::numeric_limits<typename From::rep>;
+  using T = std::numeric_limits<typename To::rep>;
+  static constexpr bool value =
+    Factor::num == 1 && Factor::den == 1 && F::digits <= T::digits &&
+    F::max_exponent <= T::max_exponent && F::min_exponent >= T::min_exponent;
+};
+
+} // namespace detail
+
+/**
+ * true if converting any From to To is exact and can not overflow, so it
+ * needs no checks at runtime. conversions to integral from floating point
+ * are never always safe, since NaN can not be represented.
+ */
+template<typename From, typename To>
+struct is_always_safe_cast
+  : std::integral_constant<bool, detail::always_safe<From, To>::value>
+{};
+
+/**
+ * converts a duration, for conversions which can not fail or lose
+ * information. it does the same as std::chrono::duration_cast, without any
+ * checks, and fails to compile if the conversion is not always safe.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+constexpr To
+implicit_safe_cast(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  static_assert(is_always_safe_cast<std::chrono::duration<FromRep, FromPeriod>,
+                                    To>::value,
+                "this conversion may fail or lose precision, use "
+                "safe_duration_cast instead");
+  return std::chrono::duration_cast<To>(from);
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_IMPLICIT_SAFE_CAST_HPP_ */
@@ -0,0 +1,291 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_MULTI_HPP_
+#define INCLUDE_MULTI_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <tuple>
+#include <type_traits>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/lossless_conversion.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+/**
+ * To can be computed from Prev, which was converted from From, by dividing
+ * Prev::count() with an integer. This is exact, since truncating a/k is the
+ * same as truncating trunc(a)/k for integer k. The intermediate
+ * representation must be the same, so a failure in the direct conversion
+ * shows up as a failure in Prev, or as the result not fitting in To.
+ */
+template<typename From,
+         typename Prev,
+         typename To,
+         bool Integral = is_integral_duration(From{}) &&
+                         is_integral_duration(Prev{}) &&
+                         is_integral_duration(To{})>
+struct chains : std::false_type
+{};
+
+template<typename From, typename Prev, typename To>
+struct chains<From, Prev, To, true>
+  : std::integral_constant<
+      bool,
+      std::ratio_divide<typename To::period, typename Prev::period>::den ==
+          1 &&
+        std::is_same<
+          typename integral_batch_kernel<Prev, From>::IntermediateRep,
+          typename integral_batch_kernel<To, From>::IntermediateRep>::value>
+{};
+
+/**
+ * dividing the count of Prev, which converted without error, to give To.
+ */
+template<typename To, typename From, typename Prev>
+struct chain_step
+{
+  using Factor = std::ratio_divide<typename To::period, typename Prev::period>;
+  using IntermediateRep =
+    typename integral_batch_kernel<To, From>::IntermediateRep;
+  using ToRep = typename To::rep;
+
+  static To convert(Prev prev, int& ec)
+  {
+    const IntermediateRep count =
+      static_cast<IntermediateRep>(prev.count()) / Factor::num;
+    return To{ lossless_integral_conversion<ToRep>(count, ec) };
+  }
+
+  // converts len elements, without branching. returns the failure bits.
+  static std::uint64_t convert_block(const Prev* prev, To* out, std::size_t len)
+  {
+    unsigned char failed[batch_block_size] = {};
+    for (std::size_t j = 0; j < len; ++j) {
+      int ec = 0;
+      out[j] = convert(prev[j], ec);
+      failed[j] = ec != 0;
+    }
+    return pack_flags(failed);
+  }
+};
+
+template<typename To, typename From, typename Prev>
+To
+multi_step(From from, Prev prev, int prev_ec, int& ec, std::true_type)
+{
+  if (prev_ec == 0) {
+    return chain_step<To, From, Prev>::convert(prev, ec);
+  }
+  // the previous conversion failed, so there is nothing to chain from.
+  return safe_duration_cast<To>(from, ec);
+}
+
+template<typename To, typename From, typename Prev>
+To
+multi_step(From from, Prev /*prev*/, int /*prev_ec*/, int& ec, std::false_type)
+{
+  return safe_duration_cast<To>(from, ec);
+}
+
+/**
+ * fills element I and onwards of the tuple Out, chaining from element I-1
+ * which failed with prev_ec. The elements are written in place, since
+ * building the tuple with tuple_cat leaves stores of the temporaries behind.
+ */
+template<std::size_t I,
+         typename From,
+         typename Out,
+         bool Done = (I == std::tuple_size<Out>::value)>
+struct multi_cast
+{
+  static void apply(From from, Out& out, int prev_ec, int& ec)
+  {
+    using Prev = typename std::tuple_element<I - 1, Out>::type;
+    using To = typename std::tuple_element<I, Out>::type;
+    int to_ec = 0;
+    std::get<I>(out) = multi_step<To>(
+      from, std::get<I - 1>(out), prev_ec, to_ec, chains<From, Prev, To>{});
+    int rest_ec = 0;
+    multi_cast<I + 1, From, Out>::apply(from, out, to_ec, rest_ec);
+    ec = to_ec ? to_ec : rest_ec;
+  }
+};
+
+template<std::size_t I, typename From, typename Out>
+struct multi_cast<I, From, Out, true>
+{
+  static void apply(From, Out&, int, int& ec) { ec = 0; }
+};
+
+// converts len elements from in to out, given the previous target prev
+// and its failure bits. returns the failure bits.
+template<typename To, typename From, typename Prev>
+std::uint64_t
+multi_step_block(const From* in,
+                 const Prev* prev,
+                 std::uint64_t prev_bits,
+                 To* out,
+                 std::size_t len,
+                 std::true_type /*chains*/)
+{
+  std::uint64_t bits =
+    chain_step<To, From, Prev>::convert_block(prev, out, len);
+  // the failed elements of prev are zero, which chains to zero. redo them
+  // from the input.
+  for (std::uint64_t todo = prev_bits; todo != 0; todo &= todo - 1) {
+    const int j = countr_zero64(todo);
+    int ec = 0;
+    out[j] = safe_duration_cast<To>(in[j], ec);
+    if (ec) {
+      bits |= std::uint64_t{ 1 } << j;
+    }
+  }
+  return bits;
+}
+
+template<typename To, typename From, typename Prev>
+std::uint64_t
+multi_step_block(const From* in,
+                 const Prev* /*prev*/,
+                 std::uint64_t /*prev_bits*/,
+                 To* out,
+                 std::size_t len,
+                 std::false_type /*chains*/)
+{
+  std::uint64_t bits = 0;
+  safe_duration_cast_n(in, out, len, &bits);
+  return bits;
+}
+
+template<typename From, typename Prev, typename... Tos>
+struct multi_cast_block;
+
+template<typename From, typename Prev>
+struct multi_cast_block<From, Prev>
+{
+  static std::uint64_t apply(const From*,
+                             std::size_t,
+                             const Prev*,
+                             std::uint64_t)
+  {
+    return 0;
+  }
+};
+
+template<typename From, typename Prev, typename To, typename... Tos>
+struct multi_cast_block<From, Prev, To, Tos...>
+{
+  // returns the failure bits of all the targets, or:ed together.
+  static std::uint64_t apply(const From* in,
+                             std::size_t len,
+                             const Prev* prev,
+                             std::uint64_t prev_bits,
+                             To* out,
+                             Tos*... outs)
+  {
+    using Chains = chains<From, Prev, To>;
+    const std::uint64_t bits =
+      multi_step_block(in, prev, prev_bits, out, len, Chains{});
+    return bits | multi_cast_block<From, To, Tos...>::apply(
+                    in, len, out, bits, outs...);
+  }
+};
+
+} // namespace detail
+
+/**
+ * converts from to each of the durations To, Tos..., the same way
+ * safe_duration_cast does, and returns the results as a tuple.
+ *
+ * when a target is an integral multiple of the target before it, and the
+ * conversions are integral, it is computed by dividing the previous
+ * result instead of converting from again. list the targets from the finest
+ * to the coarsest unit, for instance microseconds, milliseconds and seconds,
+ * to get the most out of this.
+ *
+ * ec is set to the error of the first target which failed, or zero if all
+ * succeeded. targets which failed are zero, the others hold their result.
+ */
+template<typename To,
+         typename... Tos,
+         typename FromRep,
+         typename FromPeriod>
+std::tuple<To, Tos...>
+safe_duration_cast_multi(std::chrono::duration<FromRep, FromPeriod> from,
+                         int& ec)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  using Out = std::tuple<To, Tos...>;
+  Out ret;
+  int first_ec = 0;
+  std::get<0>(ret) = safe_duration_cast<To>(from, first_ec);
+  int rest_ec = 0;
+  detail::multi_cast<1, From, Out>::apply(from, ret, first_ec, rest_ec);
+  ec = first_ec ? first_ec : rest_ec;
+  return ret;
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing version
+template<typename To,
+         typename... Tos,
+         typename FromRep,
+         typename FromPeriod>
+std::tuple<To, Tos...>
+safe_duration_cast_multi(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  int ec = 0;
+  auto ret = safe_duration_cast_multi<To, Tos...>(from, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return ret;
+}
+#endif
+
+/**
+ * converts n durations from in to each of the arrays out, outs..., which
+ * may hold different types. The results are the same as for
+ * safe_duration_cast_n to each of them, and chaining is done as for
+ * safe_duration_cast_multi.
+ *
+ * an element fails if any of its conversions fail, and then gets its bit
+ * set in failmask, which may be null. the conversions which succeeded
+ * still hold their result. the arrays must not overlap.
+ */
+template<typename FromRep, typename FromPeriod, typename To, typename... Tos>
+batch_result
+safe_duration_cast_multi_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+                           std::size_t n,
+                           std::uint64_t* failmask,
+                           To* out,
+                           Tos*... outs)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += detail::batch_block_size) {
+    const std::size_t len = std::min(detail::batch_block_size, n - first);
+    std::uint64_t first_bits = 0;
+    safe_duration_cast_n(in + first, out + first, len, &first_bits);
+    const std::uint64_t bits =
+      first_bits | detail::multi_cast_block<From, To, Tos...>::apply(
+                     in + first, len, out + first, first_bits, outs + first...);
+    detail::record_block(result, failmask, first, bits);
+  }
+  return result;
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_MULTI_HPP_ */
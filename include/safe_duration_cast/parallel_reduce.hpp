@@ -0,0 +1,115 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_PARALLEL_REDUCE_HPP_
+#define INCLUDE_PARALLEL_REDUCE_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <safe_duration_cast/reduce.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+/**
+ * runs a reduction on several threads, each reducing a contiguous part of
+ * the elements. the parts are combined in order, so the result depends on
+ * the number of threads, but not on how they are scheduled.
+ */
+class parallel_reduction
+{
+public:
+  // zero means one thread per hardware thread
+  explicit parallel_reduction(unsigned threads)
+    : m_threads(threads != 0 ? threads : std::thread::hardware_concurrency())
+  {}
+
+  template<typename Partial, typename Fn>
+  Partial run(std::size_t n, Fn fn) const
+  {
+    // fewer elements than this per thread are not worth starting it for
+    constexpr std::size_t min_part = std::size_t{ 1 } << 16;
+    const std::size_t threads =
+      std::max<std::size_t>(1, std::min<std::size_t>(m_threads, n / min_part));
+    if (threads <= 1) {
+      return fn(std::size_t{ 0 }, n);
+    }
+    const std::size_t part = (n + threads - 1) / threads;
+    const std::size_t parts = (n + part - 1) / part;
+    std::vector<Partial> partials(parts);
+    std::vector<std::thread> workers;
+    workers.reserve(parts - 1);
+    for (std::size_t t = 1; t < parts; ++t) {
+      workers.emplace_back([&partials, &fn, t, part, n] {
+        const std::size_t first = t * part;
+        partials[t] = fn(first, std::min(part, n - first));
+      });
+    }
+    partials[0] = fn(std::size_t{ 0 }, part);
+    for (auto& w : workers) {
+      w.join();
+    }
+    for (std::size_t t = 1; t < parts; ++t) {
+      partials[0].add(partials[t]);
+    }
+    return partials[0];
+  }
+
+private:
+  unsigned m_threads;
+};
+
+} // namespace detail
+
+/**
+ * like safe_sum, but split over threads. threads is the largest number of
+ * threads to use, zero means one per hardware thread. arrays too small to
+ * gain from it are reduced on the calling thread.
+ *
+ * integral sums are exact, so they are the same as from safe_sum. floating
+ * point sums are compensated within each part, and may differ from those
+ * of safe_sum in the last bits.
+ */
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+safe_sum_parallel(const std::chrono::duration<Rep, Period>* in,
+                  std::size_t n,
+                  int& ec,
+                  unsigned threads = 0)
+{
+  return detail::safe_sum(in, n, ec, detail::parallel_reduction(threads));
+}
+
+// like safe_minmax, but split over threads, see safe_sum_parallel.
+template<typename Rep, typename Period>
+detail::minmax_t<Rep, Period>
+safe_minmax_parallel(const std::chrono::duration<Rep, Period>* in,
+                     std::size_t n,
+                     int& ec,
+                     unsigned threads = 0)
+{
+  return detail::safe_minmax(in, n, ec, detail::parallel_reduction(threads));
+}
+
+// like safe_mean, but split over threads, see safe_sum_parallel.
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+safe_mean_parallel(const std::chrono::duration<Rep, Period>* in,
+                   std::size_t n,
+                   int& ec,
+                   unsigned threads = 0)
+{
+  return detail::safe_mean(in, n, ec, detail::parallel_reduction(threads));
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_PARALLEL_REDUCE_HPP_ */
@@ -0,0 +1,474 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_PARSE_HPP_
+#define INCLUDE_PARSE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ratio>
+#include <string>
+#include <type_traits>
+
+#if __cplusplus >= 201703L
+#define SDC_HAVE_STRING_VIEW 1
+#include <string_view>
+#else
+#define SDC_HAVE_STRING_VIEW 0
+#endif
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/checked_arithmetic.hpp>
+#include <safe_duration_cast/detail/lossless_conversion.hpp>
+
+// eight digits at a time, which needs the first character in the lowest
+// byte of a little endian load
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) &&            \
+  __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SDC_PARSE_HAVE_SWAR 1
+#else
+#define SDC_PARSE_HAVE_SWAR 0
+#endif
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the units which may follow a number, those of go's time.ParseDuration
+enum class parse_unit : unsigned char
+{
+  nanoseconds,
+  microseconds,
+  milliseconds,
+  seconds,
+  minutes,
+  hours
+};
+
+constexpr bool
+is_digit(char c)
+{
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+#if SDC_PARSE_HAVE_SWAR
+// true if all eight bytes are ascii digits
+constexpr bool
+is_eight_digits(std::uint64_t chunk)
+{
+  return ((chunk & 0xF0F0F0F0F0F0F0F0) |
+          (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
+
+// the value of eight digits, the first of them in the lowest byte. pairs,
+// then quads, are combined with multiplications.
+inline std::uint32_t
+eight_digits_value(std::uint64_t chunk)
+{
+  chunk -= 0x3030303030303030;
+  chunk = chunk * 10 + (chunk >> 8);
+  chunk = ((chunk & 0x000000FF000000FF) * (100 + (1000000ULL << 32)) +
+           ((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32))) >>
+          32;
+  return static_cast<std::uint32_t>(chunk);
+}
+
+inline bool
+load_eight_digits(const char* p, std::uint64_t& chunk)
+{
+  std::memcpy(&chunk, p, sizeof(chunk));
+  return is_eight_digits(chunk);
+}
+#endif
+
+/**
+ * reads the digits at p into value, and returns the end of them. overflow
+ * is set if the number does not fit, value is then unspecified.
+ */
+inline const char*
+parse_digits(const char* p,
+             const char* last,
+             std::uintmax_t& value,
+             bool& overflow)
+{
+#if SDC_PARSE_HAVE_SWAR
+  std::uint64_t chunk;
+  while (last - p >= 8 && load_eight_digits(p, chunk)) {
+    overflow |= checked_mul(value, std::uintmax_t{ 100000000 }, value);
+    overflow |= checked_add(
+      value, static_cast<std::uintmax_t>(eight_digits_value(chunk)), value);
+    p += 8;
+  }
+#endif
+  for (; p != last && is_digit(*p); ++p) {
+    overflow |= checked_mul(value, std::uintmax_t{ 10 }, value);
+    overflow |= checked_add(
+      value, static_cast<std::uintmax_t>(*p - '0'), value);
+  }
+  return p;
+}
+
+// the end of the digits at p
+inline const char*
+skip_digits(const char* p, const char* last)
+{
+#if SDC_PARSE_HAVE_SWAR
+  std::uint64_t chunk;
+  while (last - p >= 8 && load_eight_digits(p, chunk)) {
+    p += 8;
+  }
+#endif
+  while (p != last && is_digit(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+/**
+ * floor(a * 0.d1d2...dk) for the digits in [first, last). it is done from
+ * the last digit, carrying like long multiplication, so it is exact for any
+ * number of digits. the carry is less than a, so a*10 must fit.
+ */
+inline std::uintmax_t
+scale_fraction(std::uintmax_t a, const char* first, const char* last)
+{
+  std::uintmax_t carry = 0;
+  while (last != first) {
+    --last;
+    carry = (static_cast<std::uintmax_t>(*last - '0') * a + carry) / 10;
+  }
+  return carry;
+}
+
+constexpr std::uintmax_t
+parse_gcd(std::uintmax_t a, std::uintmax_t b)
+{
+  return b == 0 ? a : parse_gcd(b, a % b);
+}
+
+/**
+ * the parts of the terms below a whole Period are added up in units of a
+ * grid, which divides both Period and the nanosecond. every unit is then a
+ * whole number of grid steps, so the parts add up exactly, and the sum is
+ * truncated once at the end instead of once per term. "30m30m" is one
+ * hour, not zero.
+ *
+ * with Period = num/den seconds, the grid is 1/lcm(10^9, den) seconds.
+ * size is the number of steps in a Period. the grid is not used if it
+ * would not fit, which only happens for periods of centuries or with odd
+ * denominators beyond 10^9. each term is then truncated by itself.
+ */
+template<typename Period>
+struct parse_grid
+{
+  using U = std::uintmax_t;
+  using L = std::numeric_limits<U>;
+  static constexpr U g = parse_gcd(1000000000, Period::den);
+  // steps per Period and per nanosecond
+  static constexpr U steps_per_num = 1000000000 / g;
+  static constexpr U steps_per_ns = Period::den / g;
+  // the remainders are below 2*size plus a unit, which must fit
+  static constexpr bool valid =
+    Period::num <= L::max() / 4 / steps_per_num &&
+    steps_per_ns <= L::max() / 4 / 1000000000 / 3600;
+  static constexpr U size = valid ? Period::num * steps_per_num : 1;
+};
+
+/**
+ * out = floor((whole + 0.fraction) * Factor), where fraction are the digits
+ * in [first, last). returns true if it does not fit, or if Factor is too
+ * large to do it exactly.
+ *
+ * with whole*num = q*den + r, the result is q + floor((r + f)/den) where f
+ * is the integral part of fraction*num. the fractional part of it can be
+ * dropped, since r + f is an integer.
+ *
+ * if Scale is not zero, q goes to out and (r + fraction*num)*Scale, the part
+ * below one in steps of 1/(den*Scale), goes to rem instead, truncated.
+ */
+template<typename Factor, std::uintmax_t Scale>
+bool
+scale_component(std::uintmax_t whole,
+                const char* first,
+                const char* last,
+                std::uintmax_t& out,
+                std::uintmax_t& rem)
+{
+  using L = std::numeric_limits<std::uintmax_t>;
+  constexpr std::uintmax_t A = Factor::num;
+  constexpr std::uintmax_t B = Factor::den;
+  // whole is split as w1*B + w0, so w0*A can not overflow
+  constexpr bool can_split = B - 1 <= L::max() / A;
+  constexpr bool can_scale_fraction = A <= L::max() / 10;
+  // the fraction in steps of the grid, if that fits, else in steps of 1/B
+  constexpr bool fraction_on_grid =
+    Scale != 0 && A <= L::max() / 10 / Scale;
+  const bool has_fraction = first != last;
+  rem = 0;
+  if (!can_split || (has_fraction && !can_scale_fraction)) {
+    return true;
+  }
+  const std::uintmax_t w0 = whole % B;
+  const std::uintmax_t t = w0 * A;
+  bool failed = checked_mul(whole / B, A, out);
+  failed |= checked_add(out, t / B, out);
+  const std::uintmax_t r = t % B;
+  if (Scale != 0) {
+    rem = r * Scale;
+    if (has_fraction) {
+      rem += fraction_on_grid
+               ? scale_fraction(A * Scale, first, last)
+               : scale_fraction(A, first, last) * Scale;
+    }
+  } else if (has_fraction) {
+    // r + f < B + A, which fits since (B - 1)*A does
+    failed |= checked_add(out, (r + scale_fraction(A, first, last)) / B, out);
+  }
+  return failed;
+}
+
+template<typename Unit, typename Period>
+bool
+scale_component(std::uintmax_t whole,
+                const char* first,
+                const char* last,
+                std::uintmax_t& out,
+                std::uintmax_t& rem)
+{
+  using Factor = std::ratio_divide<Unit, Period>;
+  using Grid = parse_grid<Period>;
+  static_assert(!Grid::valid || Grid::size % Factor::den == 0,
+                "the grid divides the unit");
+  return scale_component<Factor, Grid::valid ? Grid::size / Factor::den : 0>(
+    whole, first, last, out, rem);
+}
+
+// the same, for the unit known at runtime
+template<typename Period>
+bool
+scale_component(parse_unit unit,
+                std::uintmax_t whole,
+                const char* first,
+                const char* last,
+                std::uintmax_t& out,
+                std::uintmax_t& rem)
+{
+  switch (unit) {
+    case parse_unit::nanoseconds:
+      return scale_component<std::nano, Period>(whole, first, last, out, rem);
+    case parse_unit::microseconds:
+      return scale_component<std::micro, Period>(whole, first, last, out, rem);
+    case parse_unit::milliseconds:
+      return scale_component<std::milli, Period>(whole, first, last, out, rem);
+    case parse_unit::seconds:
+      return scale_component<std::ratio<1>, Period>(
+        whole, first, last, out, rem);
+    case parse_unit::minutes:
+      return scale_component<std::ratio<60>, Period>(
+        whole, first, last, out, rem);
+    case parse_unit::hours:
+      return scale_component<std::ratio<3600>, Period>(
+        whole, first, last, out, rem);
+  }
+  return true;
+}
+
+/**
+ * reads the unit at p. returns the end of it, or nullptr if there is none.
+ * micro may be written us, or with the micro sign or the greek mu in utf-8.
+ */
+inline const char*
+parse_unit_suffix(const char* p, const char* last, parse_unit& unit)
+{
+  const std::ptrdiff_t left = last - p;
+  if (left <= 0) {
+    return nullptr;
+  }
+  const bool then_s = left >= 2 && p[1] == 's';
+  switch (p[0]) {
+    case 'n':
+      unit = parse_unit::nanoseconds;
+      return then_s ? p + 2 : nullptr;
+    case 'u':
+      unit = parse_unit::microseconds;
+      return then_s ? p + 2 : nullptr;
+    case 'm':
+      unit = then_s ? parse_unit::milliseconds : parse_unit::minutes;
+      return p + (then_s ? 2 : 1);
+    case 's':
+      unit = parse_unit::seconds;
+      return p + 1;
+    case 'h':
+      unit = parse_unit::hours;
+      return p + 1;
+    case '\xC2': // U+00B5 micro sign
+    case '\xCE': // U+03BC greek small letter mu
+      unit = parse_unit::microseconds;
+      return left >= 3 && p[1] == (p[0] == '\xC2' ? '\xB5' : '\xBC') &&
+                 p[2] == 's'
+               ? p + 3
+               : nullptr;
+    default:
+      return nullptr;
+  }
+}
+
+/**
+ * parses [p, last) into the magnitude in units of Period. returns 0 on
+ * success, 1 if it does not fit and 3 if the syntax is wrong.
+ */
+template<typename Period>
+int
+parse_magnitude(const char* p,
+                const char* last,
+                std::uintmax_t& total,
+                bool& negative)
+{
+  negative = false;
+  total = 0;
+  if (p != last && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    ++p;
+  }
+  // zero is the only number which needs no unit
+  if (last - p == 1 && *p == '0') {
+    return 0;
+  }
+  if (p == last) {
+    return 3;
+  }
+  using Grid = parse_grid<Period>;
+  std::uintmax_t below = 0;
+  bool overflow = false;
+  while (p != last) {
+    std::uintmax_t whole = 0;
+    const char* end = parse_digits(p, last, whole, overflow);
+    const bool has_whole = end != p;
+    const char* first = end;
+    const char* frac_last = end;
+    if (end != last && *end == '.') {
+      first = end + 1;
+      frac_last = skip_digits(first, last);
+    }
+    parse_unit unit = parse_unit::seconds;
+    p = parse_unit_suffix(frac_last, last, unit);
+    if (p == nullptr || (!has_whole && first == frac_last)) {
+      return 3;
+    }
+    std::uintmax_t part = 0;
+    std::uintmax_t rem = 0;
+    overflow |=
+      scale_component<Period>(unit, whole, first, frac_last, part, rem);
+    overflow |= checked_add(total, part, total);
+    // below stays under Grid::size, so the sum fits
+    below += rem;
+    overflow |= checked_add(total, below / Grid::size, total);
+    below %= Grid::size;
+  }
+  return overflow ? 1 : 0;
+}
+
+template<typename To>
+To
+parse_duration(const char* first, const char* last, int& ec)
+{
+  static_assert(is_duration(To{}), "To is not a duration");
+  static_assert(is_integral_duration(To{}),
+                "only integral representations are supported");
+  using ToRep = typename To::rep;
+  std::uintmax_t total;
+  bool negative;
+  ec = parse_magnitude<typename To::period>(first, last, total, negative);
+  if (ec) {
+    return To::zero();
+  }
+  ToRep count;
+  if (negative) {
+    using L = std::numeric_limits<std::intmax_t>;
+    constexpr std::uintmax_t limit = std::uintmax_t{ L::max() } + 1;
+    if (total > limit) {
+      ec = 1;
+      return To::zero();
+    }
+    const std::intmax_t value =
+      total == limit ? L::min() : -static_cast<std::intmax_t>(total);
+    count = lossless_integral_conversion<ToRep>(value, ec);
+  } else {
+    count = lossless_integral_conversion<ToRep>(total, ec);
+  }
+  return ec ? To::zero() : To{ count };
+}
+
+} // namespace detail
+
+/**
+ * parses a duration like "150ms", "2h30m" or "-1.5s" into To, the way go's
+ * time.ParseDuration does: an optional sign, then one or more numbers, each
+ * with a unit. the units are ns, us (or µs), ms, s, m and h. a lone "0"
+ * needs no unit. nothing else, not even white space, is allowed.
+ *
+ * the digits are accumulated with overflow checks, eight at a time where
+ * the platform allows, and scaled to To with the ratio of the unit. decimal
+ * fractions are scaled exactly. the terms are added up, with their parts
+ * below a whole To kept to the nanosecond or finer, and the sum is
+ * truncated towards zero like duration_cast does, so "30m30m" is one hour.
+ * the sum is checked as well.
+ *
+ * ec is 1 if the result does not fit in To, and 3 if the string is not a
+ * duration. the result is zero then.
+ */
+template<typename To>
+To
+safe_parse_duration(const char* first, const char* last, int& ec)
+{
+  return detail::parse_duration<To>(first, last, ec);
+}
+
+// parses a null terminated string, see above
+template<typename To>
+To
+safe_parse_duration(const char* str, int& ec)
+{
+  return detail::parse_duration<To>(str, str + std::strlen(str), ec);
+}
+
+template<typename To>
+To
+safe_parse_duration(const std::string& str, int& ec)
+{
+  return detail::parse_duration<To>(str.data(), str.data() + str.size(), ec);
+}
+
+#if SDC_HAVE_STRING_VIEW
+template<typename To>
+To
+safe_parse_duration(std::string_view str, int& ec)
+{
+  return detail::parse_duration<To>(str.data(), str.data() + str.size(), ec);
+}
+#endif
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing version
+template<typename To>
+To
+safe_parse_duration(const std::string& str)
+{
+  int ec = 0;
+  const To to = safe_parse_duration<To>(str, ec);
+  if (ec) {
+    throw std::runtime_error(ec == 3 ? "invalid duration"
+                                     : "failed conversion");
+  }
+  return to;
+}
+#endif
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_PARSE_HPP_ */
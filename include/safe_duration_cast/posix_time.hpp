@@ -0,0 +1,418 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_POSIX_TIME_HPP_
+#define INCLUDE_POSIX_TIME_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <type_traits>
+
+#include <time.h>
+
+// struct timeval is posix, it is not in the C or C++ standard
+#if defined(__unix__) || defined(__APPLE__)
+#define SDC_HAVE_TIMEVAL 1
+#include <sys/time.h>
+#else
+#define SDC_HAVE_TIMEVAL 0
+#endif
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/checked_arithmetic.hpp>
+#include <safe_duration_cast/detail/lossless_conversion.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the fields of a timespec like struct: tv_sec, and tv_nsec
+struct timespec_fields
+{
+  using sub_period = std::nano;
+
+  template<typename T>
+  static auto sub(const T& t) -> decltype(t.tv_nsec)
+  {
+    return t.tv_nsec;
+  }
+
+  template<typename T>
+  static void set(T& t, std::intmax_t sec, std::intmax_t sub)
+  {
+    t.tv_sec = static_cast<decltype(t.tv_sec)>(sec);
+    t.tv_nsec = static_cast<decltype(t.tv_nsec)>(sub);
+  }
+};
+
+// the fields of a timeval like struct: tv_sec, and tv_usec
+struct timeval_fields
+{
+  using sub_period = std::micro;
+
+  template<typename T>
+  static auto sub(const T& t) -> decltype(t.tv_usec)
+  {
+    return t.tv_usec;
+  }
+
+  template<typename T>
+  static void set(T& t, std::intmax_t sec, std::intmax_t sub)
+  {
+    t.tv_sec = static_cast<decltype(t.tv_sec)>(sec);
+    t.tv_usec = static_cast<decltype(t.tv_usec)>(sub);
+  }
+};
+
+// true if value fits in the integral type T
+template<typename T>
+constexpr bool
+fits_in(std::intmax_t value)
+{
+  using L = std::numeric_limits<T>;
+  return value < 0 ? value >= static_cast<std::intmax_t>(L::min())
+                   : static_cast<std::uintmax_t>(value) <=
+                       static_cast<std::uintmax_t>(L::max());
+}
+
+/**
+ * splits count, in units of 1/Den seconds, into whole seconds rounded
+ * towards minus infinity and a remainder in [0, Den) from one division by
+ * the constant Den, which the compiler does with a multiplication. the
+ * remainder is then converted to SubPeriod, truncated towards zero like
+ * duration_cast, which may carry into the seconds.
+ */
+template<std::intmax_t Den, typename SubPeriod>
+void
+split_seconds(std::intmax_t count, std::intmax_t& sec, std::intmax_t& sub)
+{
+  static_assert(Den > 1, "the count must be in a fraction of seconds");
+  using SubFactor = std::ratio_divide<std::ratio<1, Den>, SubPeriod>;
+  constexpr std::intmax_t A = SubFactor::num;
+  constexpr std::intmax_t B = SubFactor::den;
+  static_assert(A <= std::numeric_limits<std::intmax_t>::max() / Den,
+                "the remainder must be possible to scale");
+  std::intmax_t q = count / Den;
+  std::intmax_t r = count % Den;
+  // without branches, the sign of random input is not predictable
+  const std::intmax_t borrow = r < 0;
+  q -= borrow;
+  r += borrow * Den;
+  const std::intmax_t scaled = r * A;
+  std::intmax_t s = scaled / B;
+  // a negative count which lost digits below SubPeriod rounds up
+  s += (B != 1 && count < 0 && scaled % B != 0) ? 1 : 0;
+  const std::intmax_t carry = B != 1 && s == SubPeriod::den;
+  sec = q + carry;
+  sub = s - carry * SubPeriod::den;
+}
+
+// converts a count of seconds, or of something coarser, to seconds.
+// returns true on failure.
+template<typename Fields, typename Rep, typename Period>
+bool
+to_posix_seconds(std::chrono::duration<Rep, Period> d,
+                 std::intmax_t& sec,
+                 std::intmax_t& sub,
+                 std::true_type /*whole seconds*/)
+{
+  int ec = 0;
+  sec = safe_duration_cast<std::chrono::duration<std::intmax_t>>(d, ec).count();
+  sub = 0;
+  return ec != 0;
+}
+
+template<typename Fields, typename Rep, typename Period>
+bool
+to_posix_seconds(std::chrono::duration<Rep, Period> d,
+                 std::intmax_t& sec,
+                 std::intmax_t& sub,
+                 std::false_type /*whole seconds*/)
+{
+  using Factor = std::ratio_divide<Period, std::ratio<1>>;
+  using Fraction =
+    std::chrono::duration<std::intmax_t, std::ratio<1, Factor::den>>;
+  // an exact multiplication, unless Period is already a fraction of a
+  // second. it is a range check then.
+  int ec = 0;
+  const std::intmax_t count = safe_duration_cast<Fraction>(d, ec).count();
+  split_seconds<Factor::den, typename Fields::sub_period>(count, sec, sub);
+  return ec != 0;
+}
+
+/**
+ * converts d to the seconds and the sub second part of T. returns true on
+ * failure, and t is then zero.
+ */
+template<typename Fields, typename T, typename Rep, typename Period>
+bool
+to_posix(std::chrono::duration<Rep, Period> d, T& t)
+{
+  static_assert(std::is_integral<Rep>::value,
+                "only integral representations are supported");
+  using Factor = std::ratio_divide<Period, std::ratio<1>>;
+  using whole_seconds = std::integral_constant<bool, Factor::den == 1>;
+  std::intmax_t sec;
+  std::intmax_t sub;
+  bool failed = to_posix_seconds<Fields>(d, sec, sub, whole_seconds{});
+  failed = failed || !fits_in<decltype(t.tv_sec)>(sec);
+  Fields::set(t, failed ? 0 : sec, failed ? 0 : sub);
+  return failed;
+}
+
+// from seconds and a sub second part, for To a fraction 1/k of a second
+template<typename To, typename SubPeriod>
+bool
+from_posix_to(std::intmax_t sec,
+              std::intmax_t sub,
+              std::intmax_t& count,
+              std::true_type /*fraction of a second*/)
+{
+  using Wide = std::chrono::duration<std::intmax_t, typename To::period>;
+  using SubFactor = std::ratio_divide<SubPeriod, typename To::period>;
+  constexpr std::intmax_t A = SubFactor::num;
+  constexpr std::intmax_t B = SubFactor::den;
+  static_assert(A <= std::numeric_limits<std::intmax_t>::max() /
+                       SubPeriod::den,
+                "the sub second part must be possible to scale");
+  // a negative time is sec+1 seconds minus unit-sub, so both terms have the
+  // sign of the result. neither can then overflow unless the result does,
+  // and truncating the negative part truncates the sum towards zero.
+  const bool borrow = sec < 0 && sub > 0;
+  int ec = 0;
+  const std::intmax_t whole =
+    safe_duration_cast<Wide>(
+      std::chrono::duration<std::intmax_t>{ sec + (borrow ? 1 : 0) }, ec)
+      .count();
+  const std::intmax_t below = borrow ? SubPeriod::den - sub : sub;
+  const std::intmax_t part = (borrow ? -1 : 1) * (below * A / B);
+  const bool failed = checked_add(whole, part, count);
+  return ec != 0 || failed;
+}
+
+// for To a whole number of seconds
+template<typename To, typename SubPeriod>
+bool
+from_posix_to(std::intmax_t sec,
+              std::intmax_t sub,
+              std::intmax_t& count,
+              std::false_type /*fraction of a second*/)
+{
+  using Wide = std::chrono::duration<std::intmax_t, typename To::period>;
+  // a negative sec plus a positive sub second part truncates like sec+1,
+  // which can not overflow.
+  const std::intmax_t toward_zero = sec + (sec < 0 && sub > 0 ? 1 : 0);
+  int ec = 0;
+  count = safe_duration_cast<Wide>(
+            std::chrono::duration<std::intmax_t>{ toward_zero }, ec)
+            .count();
+  return ec != 0;
+}
+
+/**
+ * converts t to To, truncating towards zero. returns true on failure, which
+ * includes a sub second part outside [0, one second). to is then zero.
+ */
+template<typename Fields, typename To, typename T>
+bool
+from_posix(const T& t, To& to)
+{
+  static_assert(is_duration(To{}), "To is not a duration");
+  static_assert(is_integral_duration(To{}),
+                "only integral representations are supported");
+  using Period = typename To::period;
+  using SubPeriod = typename Fields::sub_period;
+  static_assert(Period::num == 1 || Period::den == 1,
+                "To must be a fraction 1/k or a multiple of a second");
+  using fraction = std::integral_constant<bool, Period::num == 1>;
+  const std::intmax_t sec = static_cast<std::intmax_t>(t.tv_sec);
+  const std::intmax_t sub = static_cast<std::intmax_t>(Fields::sub(t));
+  const bool bad_sub = sub < 0 || sub >= SubPeriod::den;
+  std::intmax_t count = 0;
+  bool failed =
+    from_posix_to<To, SubPeriod>(sec, bad_sub ? 0 : sub, count, fraction{});
+  failed = failed || bad_sub || !fits_in<typename To::rep>(count);
+  to = To{ static_cast<typename To::rep>(failed ? 0 : count) };
+  return failed;
+}
+
+} // namespace detail
+
+/**
+ * converts d to a timespec, with tv_nsec in [0, 999999999] and tv_sec
+ * rounded down, like posix wants it. parts below a nanosecond are truncated
+ * towards zero, like duration_cast does. ec is set if the seconds do not fit
+ * in tv_sec, or if d does not fit in intmax_t units of the fraction of a
+ * second it is in.
+ *
+ * the seconds and nanoseconds come from one division by a constant, which
+ * the compiler does with a multiplication. T may be any struct with tv_sec
+ * and tv_nsec, for instance __kernel_timespec for io_uring.
+ */
+template<typename T = ::timespec, typename Rep, typename Period>
+T
+safe_to_timespec(std::chrono::duration<Rep, Period> d, int& ec)
+{
+  T t{};
+  ec = detail::to_posix<detail::timespec_fields>(d, t) ? 1 : 0;
+  return t;
+}
+
+/**
+ * converts t to To, truncating towards zero. ec is set if tv_nsec is not in
+ * [0, 999999999], or if the result does not fit in To.
+ *
+ * To must be a fraction 1/k of a second, like nanoseconds and milliseconds,
+ * or a multiple of one, like minutes.
+ */
+template<typename To, typename T>
+To
+safe_from_timespec(const T& t, int& ec)
+{
+  To to;
+  ec = detail::from_posix<detail::timespec_fields>(t, to) ? 1 : 0;
+  return to;
+}
+
+#if SDC_HAVE_TIMEVAL
+// like safe_to_timespec, but for timeval, with microseconds in tv_usec
+template<typename T = ::timeval, typename Rep, typename Period>
+T
+safe_to_timeval(std::chrono::duration<Rep, Period> d, int& ec)
+{
+  T t{};
+  ec = detail::to_posix<detail::timeval_fields>(d, t) ? 1 : 0;
+  return t;
+}
+
+// like safe_from_timespec, but for timeval, with microseconds in tv_usec
+template<typename To, typename T>
+To
+safe_from_timeval(const T& t, int& ec)
+{
+  To to;
+  ec = detail::from_posix<detail::timeval_fields>(t, to) ? 1 : 0;
+  return to;
+}
+#endif
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing versions
+template<typename T = ::timespec, typename Rep, typename Period>
+T
+safe_to_timespec(std::chrono::duration<Rep, Period> d)
+{
+  int ec = 0;
+  const T t = safe_to_timespec<T>(d, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return t;
+}
+
+template<typename To, typename T>
+To
+safe_from_timespec(const T& t)
+{
+  int ec = 0;
+  const To to = safe_from_timespec<To>(t, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return to;
+}
+
+#if SDC_HAVE_TIMEVAL
+template<typename T = ::timeval, typename Rep, typename Period>
+T
+safe_to_timeval(std::chrono::duration<Rep, Period> d)
+{
+  int ec = 0;
+  const T t = safe_to_timeval<T>(d, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return t;
+}
+
+template<typename To, typename T>
+To
+safe_from_timeval(const T& t)
+{
+  int ec = 0;
+  const To to = safe_from_timeval<To>(t, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return to;
+}
+#endif
+#endif
+
+/**
+ * converts n durations to timespecs like safe_to_timespec, for instance
+ * timeouts for io_uring. failures are reported like for
+ * safe_duration_cast_n, and are set to zero in out.
+ */
+template<typename T, typename Rep, typename Period>
+batch_result
+safe_to_timespec_n(const std::chrono::duration<Rep, Period>* in,
+                   T* out,
+                   std::size_t n,
+                   std::uint64_t* failmask = nullptr)
+{
+  return detail::for_each_block(n, failmask, [=](std::size_t i) {
+    return detail::to_posix<detail::timespec_fields>(in[i], out[i]);
+  });
+}
+
+// converts n timespecs like safe_from_timespec, see safe_to_timespec_n.
+template<typename To, typename T>
+batch_result
+safe_from_timespec_n(const T* in,
+                     To* out,
+                     std::size_t n,
+                     std::uint64_t* failmask = nullptr)
+{
+  return detail::for_each_block(n, failmask, [=](std::size_t i) {
+    return detail::from_posix<detail::timespec_fields>(in[i], out[i]);
+  });
+}
+
+#if SDC_HAVE_TIMEVAL
+// converts n durations to timevals, see safe_to_timespec_n.
+template<typename T, typename Rep, typename Period>
+batch_result
+safe_to_timeval_n(const std::chrono::duration<Rep, Period>* in,
+                  T* out,
+                  std::size_t n,
+                  std::uint64_t* failmask = nullptr)
+{
+  return detail::for_each_block(n, failmask, [=](std::size_t i) {
+    return detail::to_posix<detail::timeval_fields>(in[i], out[i]);
+  });
+}
+
+// converts n timevals like safe_from_timeval, see safe_to_timespec_n.
+template<typename To, typename T>
+batch_result
+safe_from_timeval_n(const T* in,
+                    To* out,
+                    std::size_t n,
+                    std::uint64_t* failmask = nullptr)
+{
+  return detail::for_each_block(n, failmask, [=](std::size_t i) {
+    return detail::from_posix<detail::timeval_fields>(in[i], out[i]);
+  });
+}
+#endif
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_POSIX_TIME_HPP_ */
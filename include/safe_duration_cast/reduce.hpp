@@ -0,0 +1,556 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_REDUCE_HPP_
+#define INCLUDE_REDUCE_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/lossless_conversion.hpp>
+#include <safe_duration_cast/detail/reciprocal.hpp>
+#include <safe_duration_cast/detail/safe_float_conversion.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * Reductions over arrays of durations, which report overflow instead of
+ * giving the wrong result.
+ *
+ * integral counts are summed exactly in 128 bits, and narrowed with a check
+ * at the end. floating point counts are summed with compensation (Neumaier)
+ * in at least double, so the error does not grow with the number of
+ * elements.
+ */
+namespace detail {
+
+/**
+ * a 128 bit two's complement integer, as two words. this is used instead of
+ * a native 128 bit type, which not all compilers have.
+ */
+struct wide_sum
+{
+  std::uint64_t lo;
+  std::uint64_t hi;
+
+  void add(std::uint64_t add_lo, std::uint64_t add_hi)
+  {
+    const std::uint64_t sum = lo + add_lo;
+    hi += add_hi + (sum < lo ? 1U : 0U);
+    lo = sum;
+  }
+
+  void add(const wide_sum& other) { add(other.lo, other.hi); }
+
+  // true if the value fits in int64_t, which it then is as lo
+  bool fits_int64() const
+  {
+    const std::uint64_t sign_extension =
+      (lo >> 63) != 0 ? ~std::uint64_t{ 0 } : std::uint64_t{ 0 };
+    return hi == sign_extension;
+  }
+
+  bool negative() const { return (hi >> 63) != 0; }
+};
+
+// maps a count to an unsigned value which keeps the order. signed counts
+// are offset by 2^63, by flipping the sign bit.
+template<typename Rep>
+std::uint64_t
+biased(Rep count, std::true_type /*is_signed*/)
+{
+  return static_cast<std::uint64_t>(static_cast<std::int64_t>(count)) ^
+         (std::uint64_t{ 1 } << 63);
+}
+
+template<typename Rep>
+std::uint64_t
+biased(Rep count, std::false_type /*is_signed*/)
+{
+  return static_cast<std::uint64_t>(count);
+}
+
+/**
+ * the exact sum of n integral counts.
+ *
+ * the counts are made unsigned and split into their upper and lower 32
+ * bits, which are summed separately in 64 bits. neither sum can overflow
+ * within a chunk, and the loop has only additions, shifts and masks in it,
+ * so it is vectorized. each chunk is added to the 128 bit total, and the
+ * offset of the signed counts is taken away at the end.
+ */
+template<typename Rep, typename Period>
+wide_sum
+integral_sum(const std::chrono::duration<Rep, Period>* in, std::size_t n)
+{
+  static_assert(std::numeric_limits<Rep>::digits <= 64,
+                "at most 64 bit representations are supported");
+  using is_signed = std::integral_constant<bool, std::is_signed<Rep>::value>;
+  // less than 2^32, so the lower halves can not overflow
+  constexpr std::size_t chunk = std::size_t{ 1 } << 20;
+  wide_sum total{ 0, 0 };
+  for (std::size_t first = 0; first < n; first += chunk) {
+    const std::size_t len = std::min(chunk, n - first);
+    std::uint64_t upper = 0;
+    std::uint64_t lower = 0;
+    for (std::size_t j = 0; j < len; ++j) {
+      const std::uint64_t u = biased(in[first + j].count(), is_signed{});
+      upper += u >> 32;
+      lower += u & 0xFFFFFFFFU;
+    }
+    total.add(upper << 32, upper >> 32);
+    total.add(lower, 0);
+  }
+  if (is_signed::value) {
+    // subtract n*2^63
+    const std::uint64_t n64 = n;
+    wide_sum offset{ n64 << 63, n64 >> 1 };
+    total.add(~offset.lo, ~offset.hi);
+    total.add(1, 0);
+  }
+  return total;
+}
+
+// narrows the sum to Rep, setting ec if it does not fit
+template<typename Rep>
+Rep
+narrow_sum(const wide_sum& sum, int& ec)
+{
+  if (sum.fits_int64()) {
+    return lossless_integral_conversion<Rep>(
+      static_cast<std::int64_t>(sum.lo), ec);
+  }
+  if (sum.hi == 0) {
+    return lossless_integral_conversion<Rep>(sum.lo, ec);
+  }
+  ec = 1;
+  return {};
+}
+
+// sum/n, truncated towards zero like the / operator. n must be positive.
+template<typename Rep>
+Rep
+wide_mean(const wide_sum& sum, std::uint64_t n, int& ec)
+{
+  wide_sum magnitude = sum;
+  const bool negative = sum.negative();
+  if (negative) {
+    magnitude = wide_sum{ 0, 0 };
+    magnitude.add(~sum.lo, ~sum.hi);
+    magnitude.add(1, 0);
+  }
+  // every count is less than 2^64 in magnitude, so the upper word is less
+  // than n, and the quotient fits in 64 bits.
+  const std::uint64_t q = divide_wide<std::uint64_t>(magnitude.hi,
+                                                      magnitude.lo,
+                                                      n);
+  if (negative) {
+    // the mean is at least the smallest count, so it fits in int64_t
+    return lossless_integral_conversion<Rep>(
+      static_cast<std::int64_t>(std::uint64_t{ 0 } - q), ec);
+  }
+  return lossless_integral_conversion<Rep>(q, ec);
+}
+
+/**
+ * compensated summation as in Neumaier, "Rundungsfehleranalyse einiger
+ * Verfahren zur Summation endlicher Summen", 1974. comp collects the
+ * rounding errors of sum.
+ */
+template<typename Float>
+struct compensated_sum
+{
+  Float sum;
+  Float comp;
+
+  void add(Float x)
+  {
+    const Float t = sum + x;
+    comp += std::fabs(sum) >= std::fabs(x) ? (sum - t) + x : (x - t) + sum;
+    sum = t;
+  }
+
+  void add(const compensated_sum& other)
+  {
+    add(other.sum);
+    comp += other.comp;
+  }
+
+  Float value() const { return sum + comp; }
+};
+
+// the type floating point counts are summed in. the compensation itself
+// accumulates rounding errors, which for float is too much.
+template<typename Rep>
+using floating_accumulator_t = typename std::common_type<Rep, double>::type;
+
+/**
+ * the compensated sum of n floating point counts, each multiplied with
+ * scale. independent sums are kept for a few lanes, which breaks the
+ * dependency between consecutive additions and lets the compiler vectorize
+ * the loop.
+ */
+template<typename Rep, typename Period>
+compensated_sum<floating_accumulator_t<Rep>>
+floating_sum(const std::chrono::duration<Rep, Period>* in,
+             std::size_t n,
+             Rep scale)
+{
+  using Acc = floating_accumulator_t<Rep>;
+  constexpr std::size_t lanes = 8;
+  compensated_sum<Acc> lane[lanes];
+  for (auto& s : lane) {
+    s = compensated_sum<Acc>{ 0, 0 };
+  }
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes) {
+    for (std::size_t k = 0; k < lanes; ++k) {
+      lane[k].add(in[i + k].count() * scale);
+    }
+  }
+  for (; i < n; ++i) {
+    lane[i % lanes].add(in[i].count() * scale);
+  }
+  for (std::size_t k = 1; k < lanes; ++k) {
+    lane[0].add(lane[k]);
+  }
+  return lane[0];
+}
+
+template<typename Rep, typename Period>
+bool
+all_finite(const std::chrono::duration<Rep, Period>* in, std::size_t n)
+{
+  return std::all_of(in, in + n, [](std::chrono::duration<Rep, Period> d) {
+    return std::isfinite(d.count());
+  });
+}
+
+// the value of a floating point sum, or of it divided by divisor, in Rep.
+// if the sum is not finite, the compensation is not meaningful, and if the
+// counts were finite, the sum overflowed.
+template<typename Rep, typename Period, typename Acc>
+Rep
+floating_sum_value(const compensated_sum<Acc>& sum,
+                   const std::chrono::duration<Rep, Period>* in,
+                   std::size_t n,
+                   Acc divisor,
+                   int& ec)
+{
+  const Acc value = sum.value();
+  if (std::isfinite(value)) {
+    return safe_float_conversion<Rep>(value / divisor, ec);
+  }
+  if (all_finite(in, n)) {
+    ec = 1;
+    return {};
+  }
+  // infinity or NaN in the input passes through
+  return static_cast<Rep>(sum.sum);
+}
+
+// the smallest and the largest duration
+template<typename Rep, typename Period>
+using minmax_t = std::pair<std::chrono::duration<Rep, Period>,
+                           std::chrono::duration<Rep, Period>>;
+
+// the smallest and largest count, and whether there was a NaN
+template<typename Rep>
+struct minmax_partial
+{
+  Rep lo;
+  Rep hi;
+  bool nan;
+
+  void add(const minmax_partial& other)
+  {
+    lo = other.lo < lo ? other.lo : lo;
+    hi = other.hi > hi ? other.hi : hi;
+    nan = nan || other.nan;
+  }
+};
+
+// n must be positive. the loop has no branches, so it is vectorized.
+template<typename Rep, typename Period>
+minmax_partial<Rep>
+minmax_of(const std::chrono::duration<Rep, Period>* in, std::size_t n)
+{
+  Rep lo = in[0].count();
+  Rep hi = lo;
+  // lo and hi stay unchanged for NaN, which is noted separately
+  bool nan = !(lo == lo);
+  for (std::size_t i = 1; i < n; ++i) {
+    const Rep x = in[i].count();
+    lo = x < lo ? x : lo;
+    hi = x > hi ? x : hi;
+    nan = nan | !(x == x);
+  }
+  return minmax_partial<Rep>{ lo, hi, nan };
+}
+
+template<typename Rep, typename Period>
+minmax_t<Rep, Period>
+minmax_value(const minmax_partial<Rep>& m)
+{
+  using D = std::chrono::duration<Rep, Period>;
+  if (m.nan) {
+    const Rep nan = std::numeric_limits<Rep>::quiet_NaN();
+    return { D{ nan }, D{ nan } };
+  }
+  return { D{ m.lo }, D{ m.hi } };
+}
+
+/**
+ * runs a reduction over all elements on the calling thread. fn(first, len)
+ * reduces the elements [first, first+len) to a Partial.
+ */
+struct sequential_reduction
+{
+  template<typename Partial, typename Fn>
+  Partial run(std::size_t n, Fn fn) const
+  {
+    return fn(std::size_t{ 0 }, n);
+  }
+};
+
+template<typename Rep, typename Period, typename Exec>
+std::chrono::duration<Rep, Period>
+safe_sum(const std::chrono::duration<Rep, Period>* in,
+         std::size_t n,
+         int& ec,
+         const Exec& exec,
+         std::true_type /*is_integral*/)
+{
+  const wide_sum sum = exec.template run<wide_sum>(
+    n, [in](std::size_t first, std::size_t len) {
+      return integral_sum(in + first, len);
+    });
+  return std::chrono::duration<Rep, Period>{ narrow_sum<Rep>(sum, ec) };
+}
+
+template<typename Rep, typename Period, typename Exec>
+compensated_sum<floating_accumulator_t<Rep>>
+floating_sum(const std::chrono::duration<Rep, Period>* in,
+             std::size_t n,
+             Rep scale,
+             const Exec& exec)
+{
+  return exec.template run<compensated_sum<floating_accumulator_t<Rep>>>(
+    n, [in, scale](std::size_t first, std::size_t len) {
+      return floating_sum(in + first, len, scale);
+    });
+}
+
+template<typename Rep, typename Period, typename Exec>
+std::chrono::duration<Rep, Period>
+safe_sum(const std::chrono::duration<Rep, Period>* in,
+         std::size_t n,
+         int& ec,
+         const Exec& exec,
+         std::false_type /*is_integral*/)
+{
+  using Acc = floating_accumulator_t<Rep>;
+  return std::chrono::duration<Rep, Period>{ floating_sum_value(
+    floating_sum(in, n, Rep{ 1 }, exec), in, n, Acc{ 1 }, ec) };
+}
+
+// n must be positive
+template<typename Rep, typename Period, typename Exec>
+minmax_t<Rep, Period>
+safe_minmax(const std::chrono::duration<Rep, Period>* in,
+            std::size_t n,
+            const Exec& exec)
+{
+  return minmax_value<Rep, Period>(exec.template run<minmax_partial<Rep>>(
+    n, [in](std::size_t first, std::size_t len) {
+      return minmax_of(in + first, len);
+    }));
+}
+
+// n must be positive
+template<typename Rep, typename Period, typename Exec>
+std::chrono::duration<Rep, Period>
+safe_mean(const std::chrono::duration<Rep, Period>* in,
+          std::size_t n,
+          int& ec,
+          const Exec& exec,
+          std::true_type /*is_integral*/)
+{
+  const wide_sum sum = exec.template run<wide_sum>(
+    n, [in](std::size_t first, std::size_t len) {
+      return integral_sum(in + first, len);
+    });
+  return std::chrono::duration<Rep, Period>{ wide_mean<Rep>(sum, n, ec) };
+}
+
+template<typename Rep, typename Period, typename Exec>
+std::chrono::duration<Rep, Period>
+safe_mean(const std::chrono::duration<Rep, Period>* in,
+          std::size_t n,
+          int& ec,
+          const Exec& exec,
+          std::false_type /*is_integral*/)
+{
+  using D = std::chrono::duration<Rep, Period>;
+  using Acc = floating_accumulator_t<Rep>;
+  const Acc divisor = static_cast<Acc>(n);
+  const Rep mean = floating_sum_value(
+    floating_sum(in, n, Rep{ 1 }, exec), in, n, divisor, ec);
+  if (ec == 0) {
+    return D{ mean };
+  }
+  // the sum overflowed, but the mean does not. sum again with the counts
+  // scaled down by a power of two, so that n of them fit.
+  ec = 0;
+  int exponent = 0;
+  std::frexp(static_cast<double>(n), &exponent);
+  const Acc scaled =
+    floating_sum(in, n, std::ldexp(Rep{ 1 }, -exponent), exec).value();
+  return D{ static_cast<Rep>(std::ldexp(scaled / divisor, exponent)) };
+}
+
+template<typename Rep, typename Period, typename Exec>
+std::chrono::duration<Rep, Period>
+safe_sum(const std::chrono::duration<Rep, Period>* in,
+         std::size_t n,
+         int& ec,
+         const Exec& exec)
+{
+  static_assert(std::is_arithmetic<Rep>::value,
+                "only arithmetic representations are supported");
+  ec = 0;
+  return safe_sum(in, n, ec, exec, std::is_integral<Rep>{});
+}
+
+template<typename Rep, typename Period, typename Exec>
+minmax_t<Rep, Period>
+safe_minmax(const std::chrono::duration<Rep, Period>* in,
+            std::size_t n,
+            int& ec,
+            const Exec& exec)
+{
+  static_assert(std::is_arithmetic<Rep>::value,
+                "only arithmetic representations are supported");
+  ec = 0;
+  if (n == 0) {
+    ec = 1;
+    return {};
+  }
+  return safe_minmax(in, n, exec);
+}
+
+template<typename Rep, typename Period, typename Exec>
+std::chrono::duration<Rep, Period>
+safe_mean(const std::chrono::duration<Rep, Period>* in,
+          std::size_t n,
+          int& ec,
+          const Exec& exec)
+{
+  static_assert(std::is_arithmetic<Rep>::value,
+                "only arithmetic representations are supported");
+  ec = 0;
+  if (n == 0) {
+    ec = 1;
+    return {};
+  }
+  return safe_mean(in, n, ec, exec, std::is_integral<Rep>{});
+}
+
+} // namespace detail
+
+/**
+ * the sum of the n durations in. ec is set if the sum does not fit in the
+ * duration, for floating point if finite durations sum to infinity. NaN and
+ * infinity pass through.
+ *
+ * integral durations of at most 64 bits are summed exactly, in a split
+ * accumulator the compiler vectorizes, and narrowed with
+ * lossless_integral_conversion. floating point durations are summed with
+ * compensation.
+ */
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+safe_sum(const std::chrono::duration<Rep, Period>* in, std::size_t n, int& ec)
+{
+  return detail::safe_sum(in, n, ec, detail::sequential_reduction{});
+}
+
+/**
+ * the smallest and the largest of the n durations in. ec is set if n is
+ * zero. for floating point, both are NaN if any duration is.
+ */
+template<typename Rep, typename Period>
+detail::minmax_t<Rep, Period>
+safe_minmax(const std::chrono::duration<Rep, Period>* in,
+            std::size_t n,
+            int& ec)
+{
+  return detail::safe_minmax(in, n, ec, detail::sequential_reduction{});
+}
+
+/**
+ * the mean of the n durations in. ec is set if n is zero.
+ *
+ * the mean always fits, also where the sum does not. for integral durations
+ * it is computed from the exact sum and truncated towards zero. for floating
+ * point, a sum which overflows is redone with the durations scaled down.
+ */
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+safe_mean(const std::chrono::duration<Rep, Period>* in, std::size_t n, int& ec)
+{
+  return detail::safe_mean(in, n, ec, detail::sequential_reduction{});
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing versions
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+safe_sum(const std::chrono::duration<Rep, Period>* in, std::size_t n)
+{
+  int ec = 0;
+  const auto ret = safe_sum(in, n, ec);
+  if (ec) {
+    throw std::runtime_error("failed reduction");
+  }
+  return ret;
+}
+
+template<typename Rep, typename Period>
+detail::minmax_t<Rep, Period>
+safe_minmax(const std::chrono::duration<Rep, Period>* in, std::size_t n)
+{
+  int ec = 0;
+  const auto ret = safe_minmax(in, n, ec);
+  if (ec) {
+    throw std::runtime_error("failed reduction");
+  }
+  return ret;
+}
+
+template<typename Rep, typename Period>
+std::chrono::duration<Rep, Period>
+safe_mean(const std::chrono::duration<Rep, Period>* in, std::size_t n)
+{
+  int ec = 0;
+  const auto ret = safe_mean(in, n, ec);
+  if (ec) {
+    throw std::runtime_error("failed reduction");
+  }
+  return ret;
+}
+#endif
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_REDUCE_HPP_ */
@@ -0,0 +1,97 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_RESULT_HPP_
+#define INCLUDE_RESULT_HPP_
+
+#include <chrono>
+
+#include <safe_duration_cast/chronoconv.hpp>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+
+#if defined(__cpp_lib_expected) && __cpp_lib_expected >= 202202L
+#define SDC_HAVE_STD_EXPECTED 1
+#include <expected>
+#else
+#define SDC_HAVE_STD_EXPECTED 0
+#endif
+
+namespace safe_duration_cast {
+
+/**
+ * the reason a conversion failed. the values are the same as the error
+ * codes set through int& ec.
+ */
+enum class cast_error : unsigned char
+{
+  none = 0,
+  out_of_range = 1,
+  inexact = 2,
+  // from safe_parse_duration, for a string which is not a duration
+  invalid_format = 3
+};
+
+/**
+ * the outcome of a conversion: the value, and whether it is valid. the value
+ * is zero if the conversion failed.
+ *
+ * this is trivially copyable and small, so it is returned in registers
+ * instead of writing through a pointer which may alias other data.
+ */
+template<typename To>
+struct cast_result
+{
+  To value;
+  cast_error error;
+
+  constexpr bool ok() const { return error == cast_error::none; }
+  constexpr explicit operator bool() const { return ok(); }
+
+#if SDC_HAVE_STD_EXPECTED
+  constexpr std::expected<To, cast_error> to_expected() const
+  {
+    if (ok()) {
+      return value;
+    }
+    return std::unexpected(error);
+  }
+#endif
+};
+
+/**
+ * converts like safe_duration_cast, but returns the outcome instead of
+ * setting an error code.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+SDC_RELAXED_CONSTEXPR cast_result<To>
+try_duration_cast(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  // a local error code never escapes, so the stores to it are optimized away
+  int ec = 0;
+  const To to = safe_duration_cast<To>(from, ec);
+  return cast_result<To>{ to, static_cast<cast_error>(ec) };
+}
+
+#if SDC_HAVE_STD_EXPECTED
+/**
+ * converts like safe_duration_cast, giving the result as std::expected.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+constexpr std::expected<To, cast_error>
+expected_duration_cast(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  return try_duration_cast<To>(from).to_expected();
+}
+#endif
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_RESULT_HPP_ */
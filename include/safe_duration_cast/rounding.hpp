@@ -0,0 +1,181 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_ROUNDING_HPP_
+#define INCLUDE_ROUNDING_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/rounding.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+template<typename Rounding, typename To, typename FromRep, typename FromPeriod>
+To
+rounded_duration_cast(std::chrono::duration<FromRep, FromPeriod> from, int& ec)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  ec = 0;
+  static_assert(is_duration(To{}), "To is not a duration");
+  static_assert(is_integral_duration(To{}),
+                "rounding is only supported to integral durations");
+  static_assert(is_integral_duration(From{}) || is_floating_duration(From{}),
+                "From must be integral or floating point");
+
+  using FromTag = typename dispatch_tags<From, To>::FromTag;
+  using ToTag = typename dispatch_tags<From, To>::ToTag;
+  return rounded_duration_cast_dispatch<Rounding, To>(
+    from, ec, FromTag{}, ToTag{});
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+template<typename Rounding, typename To, typename FromRep, typename FromPeriod>
+To
+rounded_duration_cast(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  int ec = 0;
+  auto ret = rounded_duration_cast<Rounding, To>(from, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return ret;
+}
+#endif
+
+template<typename Rounding, typename To, typename FromRep, typename FromPeriod>
+batch_result
+rounded_duration_cast_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+                        To* out,
+                        std::size_t n,
+                        std::uint64_t* failmask)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  static_assert(is_duration(To{}), "To is not a duration");
+  static_assert(is_integral_duration(To{}),
+                "rounding is only supported to integral durations");
+  static_assert(is_integral_duration(From{}) || is_floating_duration(From{}),
+                "From must be integral or floating point");
+
+  using FromTag = typename dispatch_tags<From, To>::FromTag;
+  using ToTag = typename dispatch_tags<From, To>::ToTag;
+  return rounded_duration_cast_n_dispatch<Rounding, To>(
+    in, out, n, failmask, FromTag{}, ToTag{});
+}
+
+} // namespace detail
+
+/**
+ * converts from to the largest To which is less than or equal to from, like
+ * std::chrono::floor. To must be integral. ec is set if the result is out
+ * of range, also if only the rounding takes it there, and for NaN and
+ * infinity.
+ *
+ * for integral conversions, the truncated quotient is adjusted from the
+ * remainder, which is computed from the quotient without another division.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+To
+safe_floor(std::chrono::duration<FromRep, FromPeriod> from, int& ec)
+{
+  return detail::rounded_duration_cast<detail::rounding::down, To>(from, ec);
+}
+
+/**
+ * converts from to the smallest To which is greater than or equal to from,
+ * like std::chrono::ceil. errors are reported as for safe_floor.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+To
+safe_ceil(std::chrono::duration<FromRep, FromPeriod> from, int& ec)
+{
+  return detail::rounded_duration_cast<detail::rounding::up, To>(from, ec);
+}
+
+/**
+ * converts from to the nearest To, with ties to even, like
+ * std::chrono::round. errors are reported as for safe_floor.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+To
+safe_round(std::chrono::duration<FromRep, FromPeriod> from, int& ec)
+{
+  return detail::rounded_duration_cast<detail::rounding::to_nearest_even, To>(
+    from, ec);
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing versions
+template<typename To, typename FromRep, typename FromPeriod>
+To
+safe_floor(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  return detail::rounded_duration_cast<detail::rounding::down, To>(from);
+}
+
+template<typename To, typename FromRep, typename FromPeriod>
+To
+safe_ceil(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  return detail::rounded_duration_cast<detail::rounding::up, To>(from);
+}
+
+template<typename To, typename FromRep, typename FromPeriod>
+To
+safe_round(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  return detail::rounded_duration_cast<detail::rounding::to_nearest_even, To>(
+    from);
+}
+#endif
+
+/**
+ * converts n durations like safe_floor, with the failures reported like for
+ * safe_duration_cast_n. in and out may be the same array, but must not
+ * otherwise overlap.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+batch_result
+safe_floor_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+             To* out,
+             std::size_t n,
+             std::uint64_t* failmask = nullptr)
+{
+  return detail::rounded_duration_cast_n<detail::rounding::down>(
+    in, out, n, failmask);
+}
+
+// converts n durations like safe_ceil, see safe_floor_n.
+template<typename To, typename FromRep, typename FromPeriod>
+batch_result
+safe_ceil_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+            To* out,
+            std::size_t n,
+            std::uint64_t* failmask = nullptr)
+{
+  return detail::rounded_duration_cast_n<detail::rounding::up>(
+    in, out, n, failmask);
+}
+
+// converts n durations like safe_round, see safe_floor_n.
+template<typename To, typename FromRep, typename FromPeriod>
+batch_result
+safe_round_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+             To* out,
+             std::size_t n,
+             std::uint64_t* failmask = nullptr)
+{
+  return detail::rounded_duration_cast_n<detail::rounding::to_nearest_even>(
+    in, out, n, failmask);
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_ROUNDING_HPP_ */
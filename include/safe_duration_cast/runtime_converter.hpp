@@ -0,0 +1,377 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_RUNTIME_CONVERTER_HPP_
+#define INCLUDE_RUNTIME_CONVERTER_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/detail/reciprocal.hpp>
+#include <safe_duration_cast/detail/safe_range.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * converts integral counts from one unit to another, where the ratio
+ * between the units is known only at runtime, for instance when it is read
+ * from a file header. the result and the errors are the same as for
+ * safe_duration_cast between durations with those units.
+ *
+ * the converter is set up once, which reduces the ratio, computes the safe
+ * range of input counts and a reciprocal of the denominator, and selects
+ * one of these kernels:
+ *  - identity, if the units are the same
+ *  - multiply, if the denominator is one
+ *  - divide, if the numerator is one
+ *  - multiply_divide otherwise.
+ * converting a count is then a range check and the kernel, so the cost is
+ * close to that of safe_duration_cast where the compiler knows the ratio.
+ */
+template<typename FromRep, typename ToRep>
+class runtime_duration_converter
+{
+  static_assert(std::is_integral<FromRep>::value &&
+                  std::is_integral<ToRep>::value,
+                "only integral representations are supported");
+
+public:
+  using IntermediateRep =
+    typename std::common_type<FromRep, ToRep, std::intmax_t>::type;
+  static_assert(std::numeric_limits<IntermediateRep>::digits <= 64,
+                "at most 64 bit representations are supported");
+
+  enum class kernel : unsigned char
+  {
+    identity,
+    multiply,
+    divide,
+    multiply_divide
+  };
+
+  /**
+   * a converter for counts with a unit that is num/den of the target unit,
+   * so that a count x converts to x*num/den. num and den must be positive,
+   * otherwise ec is set and every conversion fails.
+   */
+  runtime_duration_converter(std::intmax_t num, std::intmax_t den, int& ec)
+    : runtime_duration_converter()
+  {
+    ec = 0;
+    if (num <= 0 || den <= 0) {
+      ec = 1;
+      return;
+    }
+    setup(static_cast<U>(num), static_cast<U>(den));
+  }
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+  // throwing version
+  runtime_duration_converter(std::intmax_t num, std::intmax_t den)
+    : runtime_duration_converter()
+  {
+    if (num <= 0 || den <= 0) {
+      throw std::runtime_error("invalid ratio");
+    }
+    setup(static_cast<U>(num), static_cast<U>(den));
+  }
+#endif
+
+  // the reduced ratio
+  std::intmax_t num() const { return static_cast<std::intmax_t>(m_num); }
+  std::intmax_t den() const { return static_cast<std::intmax_t>(m_den); }
+
+  kernel selected_kernel() const { return m_kernel; }
+
+  // the counts in [min_count(),max_count()] are the ones which convert
+  // without error. the range is empty if the ratio was invalid.
+  FromRep min_count() const { return m_min_count; }
+  FromRep max_count() const { return m_max_count; }
+
+  // converts one count. on failure, ec is set and zero is returned.
+  ToRep convert(FromRep from, int& ec) const
+  {
+    ec = 0;
+    if (from < m_min_count || from > m_max_count) {
+      ec = 1;
+      return {};
+    }
+    const IntermediateRep count = static_cast<IntermediateRep>(from);
+    if (from < m_fast_min_count || from > m_fast_max_count) {
+      return static_cast<ToRep>(scale_exact(count));
+    }
+    switch (m_kernel) {
+      case kernel::identity:
+        break;
+      case kernel::multiply:
+        return static_cast<ToRep>(count * m_num);
+      case kernel::divide:
+        return static_cast<ToRep>(m_reciprocal.divide(count));
+      case kernel::multiply_divide:
+        return static_cast<ToRep>(m_reciprocal.divide(count * m_num));
+    }
+    return static_cast<ToRep>(count);
+  }
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+  // throwing version
+  ToRep convert(FromRep from) const
+  {
+    int ec = 0;
+    const ToRep ret = convert(from, ec);
+    if (ec) {
+      throw std::runtime_error("failed conversion");
+    }
+    return ret;
+  }
+#endif
+
+  /**
+   * converts n counts from in to out, with failmask and the returned summary
+   * working as for safe_duration_cast_n. in and out may be the same array.
+   * the kernel is selected once, and the loop for it has no branches.
+   */
+  batch_result convert_n(const FromRep* in,
+                         ToRep* out,
+                         std::size_t n,
+                         std::uint64_t* failmask = nullptr) const
+  {
+    const IntermediateRep num = m_num;
+    const detail::reciprocal<IntermediateRep> recip = m_reciprocal;
+    using Count = IntermediateRep;
+    switch (m_kernel) {
+      case kernel::identity:
+        break;
+      case kernel::multiply:
+        return convert_n_with(
+          in,
+          out,
+          n,
+          failmask,
+          [this](const FromRep* b, ToRep* o, std::size_t len) {
+            return multiply_block(b, o, len, use_simd{});
+          });
+      case kernel::divide:
+        return convert_n_with(
+          in,
+          out,
+          n,
+          failmask,
+          [this, recip](const FromRep* b, ToRep* o, std::size_t len) {
+            return scale_block(
+              b, o, len, [recip](Count x) { return recip.divide(x); });
+          });
+      case kernel::multiply_divide:
+        return convert_n_with(
+          in,
+          out,
+          n,
+          failmask,
+          [this, num, recip](const FromRep* b, ToRep* o, std::size_t len) {
+            return scale_block(b, o, len, [num, recip](Count x) {
+              return recip.divide(x * num);
+            });
+          });
+    }
+    return convert_n_with(
+      in,
+      out,
+      n,
+      failmask,
+      [this](const FromRep* b, ToRep* o, std::size_t len) {
+        return scale_block(b, o, len, [](Count x) { return x; });
+      });
+  }
+
+private:
+  using U = typename std::make_unsigned<IntermediateRep>::type;
+  using Range = detail::count_safe_range<FromRep, ToRep, IntermediateRep>;
+
+  // converts nothing, until setup is called
+  runtime_duration_converter()
+    : m_num(1)
+    , m_den(1)
+    , m_kernel(kernel::identity)
+    , m_reciprocal(1)
+    , m_min_count(1)
+    , m_max_count(0)
+    , m_fast_min_count(1)
+    , m_fast_max_count(0)
+    , m_can_split(true)
+  {}
+
+  static U gcd(U a, U b)
+  {
+    while (b != 0) {
+      const U r = a % b;
+      a = b;
+      b = r;
+    }
+    return a;
+  }
+
+  void setup(U num, U den)
+  {
+    const U g = gcd(num, den);
+    num /= g;
+    den /= g;
+    m_num = static_cast<IntermediateRep>(num);
+    m_den = static_cast<IntermediateRep>(den);
+    if (num == 1) {
+      m_kernel = den == 1 ? kernel::identity : kernel::divide;
+    } else {
+      m_kernel = den == 1 ? kernel::multiply : kernel::multiply_divide;
+    }
+    m_reciprocal = detail::reciprocal<IntermediateRep>(m_den);
+
+    const U max_magnitude = Range::max_magnitude(num, den);
+    const U min_magnitude = Range::min_magnitude(num, den);
+    m_max_count = static_cast<FromRep>(max_magnitude);
+    m_min_count = Range::to_negative_count(min_magnitude);
+
+    // where count*num does not overflow
+    const U max1 =
+      static_cast<U>(std::numeric_limits<IntermediateRep>::max()) / num;
+    const U min1 = Range::template lowest_magnitude<IntermediateRep>() / num;
+    m_fast_max_count =
+      static_cast<FromRep>(detail::min_of(max_magnitude, max1));
+    m_fast_min_count =
+      Range::to_negative_count(detail::min_of(min_magnitude, min1));
+    m_can_split = U(den - 1) <= max1;
+  }
+
+  // count*num/den for a count in the safe range where count*num overflows.
+  // it is split as in exact_mul_div, or computed in 128 bits.
+  IntermediateRep scale_exact(IntermediateRep count) const
+  {
+    if (m_can_split) {
+      const IntermediateRep q = m_reciprocal.divide(count);
+      const IntermediateRep r = static_cast<IntermediateRep>(count - q * m_den);
+      return static_cast<IntermediateRep>(q * m_num +
+                                          m_reciprocal.divide(r * m_num));
+    }
+#if SDC_HAVE_INT128
+    using Wide =
+      typename std::conditional<std::is_signed<IntermediateRep>::value,
+                                detail::int128_t,
+                                detail::uint128_t>::type;
+    return static_cast<IntermediateRep>(static_cast<Wide>(count) * m_num /
+                                        m_den);
+#else
+    // not reached, the safe range keeps count*num from overflowing then
+    return {};
+#endif
+  }
+
+  // converts len counts with scale, without branching. returns the
+  // elements outside of the fast range as failed.
+  template<typename Scale>
+  std::uint64_t scale_block(const FromRep* in,
+                            ToRep* out,
+                            std::size_t len,
+                            Scale scale) const
+  {
+    const FromRep lo = m_fast_min_count;
+    const FromRep hi = m_fast_max_count;
+    unsigned char failed[detail::batch_block_size] = {};
+    for (std::size_t j = 0; j < len; ++j) {
+      const FromRep from = in[j];
+      const bool ok = from >= lo && from <= hi;
+      // work on zero for failed elements, so nothing can overflow.
+      const IntermediateRep count =
+        ok ? static_cast<IntermediateRep>(from) : IntermediateRep{};
+      out[j] = static_cast<ToRep>(scale(count));
+      failed[j] = !ok;
+    }
+    return detail::pack_flags(failed);
+  }
+
+  // the explicit simd kernel handles multiplying signed 64 bit counts
+  using use_simd = std::integral_constant<
+    bool,
+    std::is_signed<FromRep>::value && std::is_signed<ToRep>::value &&
+      sizeof(FromRep) == 8 && sizeof(ToRep) == 8>;
+
+  std::uint64_t multiply_block(const FromRep* in,
+                               ToRep* out,
+                               std::size_t len,
+                               std::true_type /*use_simd*/) const
+  {
+    return detail::scale_block_int64(in,
+                                     out,
+                                     len,
+                                     static_cast<std::int64_t>(m_num),
+                                     m_fast_min_count,
+                                     m_fast_max_count);
+  }
+
+  std::uint64_t multiply_block(const FromRep* in,
+                               ToRep* out,
+                               std::size_t len,
+                               std::false_type /*use_simd*/) const
+  {
+    const IntermediateRep num = m_num;
+    return scale_block(
+      in, out, len, [num](IntermediateRep x) { return x * num; });
+  }
+
+  // converts with block, a block at a time. block(in, out, len) returns the
+  // failure bits, where elements which are in the safe range but where
+  // count*num overflows are retried with the exact path.
+  template<typename Block>
+  batch_result convert_n_with(const FromRep* in,
+                              ToRep* out,
+                              std::size_t n,
+                              std::uint64_t* failmask,
+                              Block block) const
+  {
+    batch_result result{ 0, n };
+    // in place, the block is converted to a buffer first, so the inputs are
+    // still there for the retries.
+    const bool in_place =
+      static_cast<const void*>(in) == static_cast<const void*>(out);
+    ToRep buffer[detail::batch_block_size];
+    for (std::size_t first = 0; first < n; first += detail::batch_block_size) {
+      const std::size_t len = std::min(detail::batch_block_size, n - first);
+      ToRep* scaled = in_place ? buffer : out + first;
+      std::uint64_t bits = block(in + first, scaled, len);
+      for (std::uint64_t todo = bits; todo != 0; todo &= todo - 1) {
+        const int j = detail::countr_zero64(todo);
+        const FromRep from = in[first + j];
+        if (from < m_min_count || from > m_max_count) {
+          continue;
+        }
+        scaled[j] =
+          static_cast<ToRep>(scale_exact(static_cast<IntermediateRep>(from)));
+        bits &= ~(std::uint64_t{ 1 } << j);
+      }
+      if (in_place) {
+        std::copy(buffer, buffer + len, out + first);
+      }
+      detail::record_block(result, failmask, first, bits);
+    }
+    return result;
+  }
+
+  IntermediateRep m_num;
+  IntermediateRep m_den;
+  kernel m_kernel;
+  detail::reciprocal<IntermediateRep> m_reciprocal;
+  FromRep m_min_count;
+  FromRep m_max_count;
+  // the part of the safe range where count*num does not overflow
+  FromRep m_fast_min_count;
+  FromRep m_fast_max_count;
+  bool m_can_split;
+};
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_RUNTIME_CONVERTER_HPP_ */
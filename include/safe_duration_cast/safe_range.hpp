@@ -0,0 +1,50 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_SAFE_RANGE_HPP_
+#define INCLUDE_SAFE_RANGE_HPP_
+
+#include <chrono>
+
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/safe_range.hpp>
+
+namespace safe_duration_cast {
+
+/**
+ * the inputs which safe_duration_cast converts from From to To without
+ * error: exactly those from with min() <= from <= max(). both are known at
+ * compile time, so a whole array can be validated by comparing its smallest
+ * and largest element against them, or not at all when the values are known
+ * to be in range.
+ *
+ * only for integral From and To.
+ */
+template<typename From, typename To>
+struct safe_range
+{
+  static_assert(detail::is_integral_duration(From{}),
+                "From must be an integral duration");
+  static_assert(detail::is_integral_duration(To{}),
+                "To must be an integral duration");
+
+  static constexpr From min()
+  {
+    return From{ detail::integral_safe_range<From, To>::min_count() };
+  }
+  static constexpr From max()
+  {
+    return From{ detail::integral_safe_range<From, To>::max_count() };
+  }
+  static constexpr bool contains(From from)
+  {
+    return from >= min() && from <= max();
+  }
+};
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_SAFE_RANGE_HPP_ */
@@ -0,0 +1,112 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_SATURATE_HPP_
+#define INCLUDE_SATURATE_HPP_
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+// the value a conversion of from saturates to, if it fails. the ratio
+// between the periods is positive, so the sign of the input decides.
+template<typename To, typename From>
+constexpr To
+saturation_limit(From from, tags::FromIsInt)
+{
+  return from.count() < 0 ? To::min() : To::max();
+}
+
+template<typename To, typename From>
+To
+saturation_limit(From from, tags::FromIsFloat)
+{
+  // NaN only fails when converting to integral. it gives zero, since there
+  // is no sensible sign to saturate towards. the comparison is quiet.
+  return std::isunordered(from.count(), from.count())
+           ? To::zero()
+           : (std::signbit(from.count()) ? To::min() : To::max());
+}
+
+} // namespace detail
+
+/**
+ * converts like safe_duration_cast, but instead of reporting an error, the
+ * result is clamped to To::min() or To::max(), depending on the sign of the
+ * input.
+ *
+ * input             | integral output | floating point output
+ * ------------------|-----------------|----------------------
+ * in range          | converted       | converted
+ * too large         | To::max()       | To::max()
+ * too small         | To::min()       | To::min()
+ * +Inf              | To::max()       | +Inf
+ * -Inf              | To::min()       | -Inf
+ * NaN               | zero            | NaN
+ *
+ * note that To::min() is the lowest value, not the smallest positive.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+SDC_RELAXED_CONSTEXPR To
+saturate_duration_cast(std::chrono::duration<FromRep, FromPeriod> from)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+  int ec = 0;
+  const To to = safe_duration_cast<To>(from, ec);
+  // both are computed, so the choice can be made without branching
+  const To limit = detail::saturation_limit<To>(from, FromTag{});
+  return ec ? limit : to;
+}
+
+/**
+ * converts n durations from in to out, the same way saturate_duration_cast
+ * does. the elements which were clamped get their bit set in failmask, which
+ * works the same as for safe_duration_cast_n. the returned summary counts the
+ * clamped elements. in and out may be the same array, but must not otherwise
+ * overlap.
+ */
+template<typename To, typename FromRep, typename FromPeriod>
+batch_result
+saturate_duration_cast_n(const std::chrono::duration<FromRep, FromPeriod>* in,
+                         To* out,
+                         std::size_t n,
+                         std::uint64_t* failmask = nullptr)
+{
+  using From = std::chrono::duration<FromRep, FromPeriod>;
+  using FromTag = typename detail::dispatch_tags<From, To>::FromTag;
+  batch_result result{ 0, n };
+  for (std::size_t first = 0; first < n; first += detail::batch_block_size) {
+    const std::size_t len = std::min(detail::batch_block_size, n - first);
+    // the limits are taken before converting, which zeroes the failed
+    // elements and so overwrites the input if in and out are the same.
+    To limits[detail::batch_block_size];
+    for (std::size_t j = 0; j < len; ++j) {
+      limits[j] = detail::saturation_limit<To>(in[first + j], FromTag{});
+    }
+    std::uint64_t bits = 0;
+    safe_duration_cast_n(in + first, out + first, len, &bits);
+    // a select for every element, which can be vectorized. looping over
+    // the set bits only would need a branch per failure.
+    for (std::size_t j = 0; j < len; ++j) {
+      const bool failed = (bits >> j) & 1U;
+      out[first + j] = failed ? limits[j] : out[first + j];
+    }
+    detail::record_block(result, failmask, first, bits);
+  }
+  return result;
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_SATURATE_HPP_ */
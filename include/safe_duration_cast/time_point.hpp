@@ -0,0 +1,218 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#ifndef INCLUDE_TIME_POINT_HPP_
+#define INCLUDE_TIME_POINT_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/checked_arithmetic.hpp>
+
+namespace safe_duration_cast {
+namespace detail {
+
+template<typename TP>
+struct is_time_point : std::false_type
+{};
+template<typename Clock, typename Duration>
+struct is_time_point<std::chrono::time_point<Clock, Duration>>
+  : std::true_type
+{};
+
+/**
+ * the time since the epoch of tp, plus offset, in the common duration type
+ * of the two. ec is set if either does not fit in it, or the sum overflows.
+ */
+template<typename Common, typename FromDuration, typename OffsetDuration>
+SDC_RELAXED_CONSTEXPR Common
+shifted_since_epoch(FromDuration since_epoch, OffsetDuration offset, int& ec)
+{
+  const Common a = safe_duration_cast<Common>(since_epoch, ec);
+  if (ec) {
+    return {};
+  }
+  const Common b = safe_duration_cast<Common>(offset, ec);
+  if (ec) {
+    return {};
+  }
+  typename Common::rep sum{};
+  if (checked_add(a.count(), b.count(), sum)) {
+    ec = 1;
+    return {};
+  }
+  return Common{ sum };
+}
+
+} // namespace detail
+
+/**
+ * converts a time point to another precision of the same clock, like
+ * std::chrono::time_point_cast, but reports an error instead of overflowing.
+ * the rules for the conversion are the ones of safe_duration_cast.
+ */
+template<typename ToTP, typename Clock, typename FromDuration>
+SDC_RELAXED_CONSTEXPR ToTP
+safe_time_point_cast(std::chrono::time_point<Clock, FromDuration> tp, int& ec)
+{
+  static_assert(detail::is_time_point<ToTP>::value, "ToTP is not a time_point");
+  static_assert(std::is_same<typename ToTP::clock, Clock>::value,
+                "the clocks differ, use the overload with an epoch offset");
+  using ToDuration = typename ToTP::duration;
+  return ToTP{ safe_duration_cast<ToDuration>(tp.time_since_epoch(), ec) };
+}
+
+/**
+ * converts a time point to another clock and precision. epoch_offset is the
+ * epoch of the source clock, as a time since the epoch of the target clock.
+ * the result is tp.time_since_epoch() + epoch_offset converted to
+ * ToTP::duration, where the sum is checked in the common duration type of
+ * the two, so the result is truncated once instead of twice.
+ *
+ * ec is set if the sum does not fit in the common type, or if the result
+ * does not fit in ToTP.
+ */
+template<typename ToTP,
+         typename Clock,
+         typename FromDuration,
+         typename OffsetRep,
+         typename OffsetPeriod>
+SDC_RELAXED_CONSTEXPR ToTP
+safe_time_point_cast(
+  std::chrono::time_point<Clock, FromDuration> tp,
+  std::chrono::duration<OffsetRep, OffsetPeriod> epoch_offset,
+  int& ec)
+{
+  static_assert(detail::is_time_point<ToTP>::value, "ToTP is not a time_point");
+  using Offset = std::chrono::duration<OffsetRep, OffsetPeriod>;
+  using Common = typename std::common_type<FromDuration, Offset>::type;
+  using ToDuration = typename ToTP::duration;
+  const Common shifted = detail::shifted_since_epoch<Common>(
+    tp.time_since_epoch(), epoch_offset, ec);
+  if (ec) {
+    return {};
+  }
+  return ToTP{ safe_duration_cast<ToDuration>(shifted, ec) };
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+// throwing version
+template<typename ToTP, typename Clock, typename FromDuration>
+SDC_RELAXED_CONSTEXPR ToTP
+safe_time_point_cast(std::chrono::time_point<Clock, FromDuration> tp)
+{
+  int ec = 0;
+  auto ret = safe_time_point_cast<ToTP>(tp, ec);
+  if (ec) {
+    throw std::runtime_error("failed conversion");
+  }
+  return ret;
+}
+#endif
+
+/**
+ * converts n time points from in to out, the same way safe_time_point_cast
+ * does. failmask and the returned summary work as for safe_duration_cast_n,
+ * which does the conversion a block at a time.
+ */
+template<typename ToTP, typename Clock, typename FromDuration>
+batch_result
+safe_time_point_cast_n(const std::chrono::time_point<Clock, FromDuration>* in,
+                       ToTP* out,
+                       std::size_t n,
+                       std::uint64_t* failmask = nullptr)
+{
+  static_assert(std::is_same<typename ToTP::clock, Clock>::value,
+                "the clocks differ, use the overload with an epoch offset");
+  using ToDuration = typename ToTP::duration;
+  batch_result result{ 0, n };
+  FromDuration from[detail::batch_block_size];
+  ToDuration to[detail::batch_block_size];
+  for (std::size_t first = 0; first < n; first += detail::batch_block_size) {
+    const std::size_t len = std::min(detail::batch_block_size, n - first);
+    for (std::size_t j = 0; j < len; ++j) {
+      from[j] = in[first + j].time_since_epoch();
+    }
+    std::uint64_t bits = 0;
+    safe_duration_cast_n(from, to, len, &bits);
+    for (std::size_t j = 0; j < len; ++j) {
+      out[first + j] = ToTP{ to[j] };
+    }
+    detail::record_block(result, failmask, first, bits);
+  }
+  return result;
+}
+
+/**
+ * converts n time points from in to out with an epoch offset, the same way
+ * safe_time_point_cast does.
+ */
+template<typename ToTP,
+         typename Clock,
+         typename FromDuration,
+         typename OffsetRep,
+         typename OffsetPeriod>
+batch_result
+safe_time_point_cast_n(
+  const std::chrono::time_point<Clock, FromDuration>* in,
+  ToTP* out,
+  std::size_t n,
+  std::chrono::duration<OffsetRep, OffsetPeriod> epoch_offset,
+  std::uint64_t* failmask = nullptr)
+{
+  using Offset = std::chrono::duration<OffsetRep, OffsetPeriod>;
+  using Common = typename std::common_type<FromDuration, Offset>::type;
+  using ToDuration = typename ToTP::duration;
+  batch_result result{ 0, n };
+
+  // the offset is the same for all elements
+  int ec = 0;
+  const Common offset = safe_duration_cast<Common>(epoch_offset, ec);
+  if (ec) {
+    return detail::for_each_block(n, failmask, [=](std::size_t i) {
+      out[i] = ToTP{};
+      return true;
+    });
+  }
+
+  FromDuration from[detail::batch_block_size];
+  Common shifted[detail::batch_block_size];
+  ToDuration to[detail::batch_block_size];
+  for (std::size_t first = 0; first < n; first += detail::batch_block_size) {
+    const std::size_t len = std::min(detail::batch_block_size, n - first);
+    unsigned char failed[detail::batch_block_size] = {};
+    for (std::size_t j = 0; j < len; ++j) {
+      from[j] = in[first + j].time_since_epoch();
+    }
+    std::uint64_t bits = 0;
+    safe_duration_cast_n(from, shifted, len, &bits);
+    for (std::size_t j = 0; j < len; ++j) {
+      typename Common::rep sum{};
+      failed[j] = detail::checked_add(shifted[j].count(), offset.count(), sum);
+      // failed elements are converted as zero, and masked below
+      shifted[j] = Common{ failed[j] ? typename Common::rep{} : sum };
+    }
+    bits |= detail::pack_flags(failed);
+    std::uint64_t cast_bits = 0;
+    safe_duration_cast_n(shifted, to, len, &cast_bits);
+    bits |= cast_bits;
+    for (std::size_t j = 0; j < len; ++j) {
+      const bool bad = (bits >> j) & 1U;
+      out[first + j] = ToTP{ bad ? ToDuration{} : to[j] };
+    }
+    detail::record_block(result, failmask, first, bits);
+  }
+  return result;
+}
+
+} // namespace safe_duration_cast
+#endif /* INCLUDE_TIME_POINT_HPP_ */
@@ -0,0 +1,100 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares converting an array of durations with converting the same values
+ * stored as any_duration, one at a time through the dispatch table and in
+ * batches grouped by tag.
+ */
+
+#include "safe_duration_cast/any_duration.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using From = std::chrono::microseconds;
+using To = std::chrono::milliseconds;
+
+enum class Method
+{
+  typed,
+  any_scalar,
+  any_batch
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::typed:
+      return "safe_duration_cast_n(duration)";
+    case Method::any_scalar:
+      return "safe_duration_cast(any_duration)";
+    case Method::any_batch:
+      return "safe_duration_cast_n(any_duration)";
+  }
+  return "";
+}
+
+template<Method method>
+void
+doit(const std::vector<From>& typed,
+     const std::vector<safe_duration_cast::any_duration>& any,
+     std::vector<To>& out)
+{
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    switch (method) {
+      case Method::typed:
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      typed.data(), out.data(), typed.size())
+                      .failures;
+        break;
+      case Method::any_scalar:
+        for (std::size_t i = 0; i < any.size(); ++i) {
+          int ec = 0;
+          out[i] = safe_duration_cast::safe_duration_cast<To>(any[i], ec);
+          failures += ec != 0;
+        }
+        break;
+      case Method::any_batch:
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      any.data(), out.data(), any.size())
+                      .failures;
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(typed.size()) /
+                 elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main()
+{
+  std::vector<From> typed(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : typed) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = From{ static_cast<std::int64_t>(x) / 1024 };
+  }
+  const std::vector<safe_duration_cast::any_duration> any(typed.begin(),
+                                                          typed.end());
+  std::vector<To> out(typed.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::typed>(typed, any, out);
+    doit<Method::any_scalar>(typed, any, out);
+    doit<Method::any_batch>(typed, any, out);
+  }
+}
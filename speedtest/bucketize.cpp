@@ -0,0 +1,107 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares safe_bucketize with a loop doing the same checks, but dividing
+ * by the runtime bucket width with the / operator.
+ */
+
+#include "safe_duration_cast/bucketize.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+using Dur = std::chrono::milliseconds;
+
+enum class Method
+{
+  division,
+  bucketize
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::division:
+      return "division";
+    case Method::bucketize:
+      return "safe_bucketize";
+  }
+  return "";
+}
+
+// the straightforward way, with a division per element
+std::size_t
+divide(const std::vector<Dur>& in, Dur width, Dur origin, std::int64_t* out)
+{
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    std::int64_t offset;
+    if (__builtin_sub_overflow(in[i].count(), origin.count(), &offset)) {
+      out[i] = 0;
+      ++failures;
+      continue;
+    }
+    std::int64_t q = offset / width.count();
+    if (q * width.count() != offset && offset < 0) {
+      --q;
+    }
+    out[i] = q;
+  }
+  return failures;
+}
+
+template<Method method>
+void
+doit(const std::vector<Dur>& in, Dur width, std::vector<std::int64_t>& out)
+{
+  constexpr int repetitions = 200;
+  const Dur origin{ 1234 };
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    switch (method) {
+      case Method::division:
+        failures += divide(in, width, origin, out.data());
+        break;
+      case Method::bucketize:
+        failures += safe_duration_cast::safe_bucketize(
+                      in.data(), in.size(), width, origin, out.data())
+                      .failures;
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main(int argc, char* argv[])
+{
+  // the width is read at runtime, so the compiler can not divide by a
+  // constant
+  const Dur width{ argc > 1 ? std::stoll(argv[1]) : 300000 };
+  std::vector<Dur> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = Dur{ static_cast<std::int64_t>(x) / 4 };
+  }
+  std::vector<std::int64_t> out(in.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::division>(in, width, out);
+    doit<Method::bucketize>(in, width, out);
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares ways of dividing by the denominators of the standard ratios:
+ * a division instruction (the divisor is only known at runtime), the /
+ * operator with a divisor known at compile time, and a reciprocal set up at
+ * runtime.
+ */
+
+#include "safe_duration_cast/detail/reciprocal.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+enum class Method
+{
+  runtime_divisor,
+  constant_divisor,
+  reciprocal
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::runtime_divisor:
+      return "division instruction";
+    case Method::constant_divisor:
+      return "compile time divisor";
+    case Method::reciprocal:
+      return "runtime reciprocal";
+  }
+  return "";
+}
+
+// prevents the compiler from knowing the divisor
+volatile std::intmax_t g_opaque_one = 1;
+
+template<Method method, typename T, std::intmax_t Den>
+void
+doit()
+{
+  const T divisor = static_cast<T>(Den * g_opaque_one);
+  const safe_duration_cast::detail::reciprocal<T> recip(divisor);
+
+  constexpr std::uint64_t iterations = 200000000ULL;
+  const auto t0 = std::chrono::steady_clock::now();
+  T dummy = 0;
+  // spread the inputs over the range, so they are not all small
+  std::uint64_t x = 0;
+  for (std::uint64_t i = 0; i < iterations; ++i) {
+    x += 0x9E3779B97F4A7C15ULL;
+    const T n = static_cast<T>(x >> 1);
+    switch (method) {
+      case Method::runtime_divisor:
+        dummy = static_cast<T>(dummy ^ (n / divisor));
+        break;
+      case Method::constant_divisor:
+        dummy = static_cast<T>(dummy ^ (n / static_cast<T>(Den)));
+        break;
+      case Method::reciprocal:
+        dummy = static_cast<T>(dummy ^ recip.divide(n));
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t" << iterations / elapsed_seconds
+            << " operations per second, dummy=" << static_cast<long long>(dummy)
+            << "\n";
+}
+
+template<typename T, std::intmax_t Den>
+void
+compareMethods(const char* description)
+{
+  std::cout << description << ":\n";
+  for (int repetition = 0; repetition < 2; ++repetition) {
+    doit<Method::runtime_divisor, T, Den>();
+    doit<Method::constant_divisor, T, Den>();
+    doit<Method::reciprocal, T, Den>();
+  }
+}
+
+int
+main()
+{
+  compareMethods<std::int64_t, std::milli::den>("int64 divided by 1000");
+  compareMethods<std::int64_t, std::micro::den>("int64 divided by 10^6");
+  compareMethods<std::int64_t, std::nano::den>("int64 divided by 10^9");
+  compareMethods<std::uint64_t, std::milli::den>("uint64 divided by 1000");
+  compareMethods<std::uint64_t, std::nano::den>("uint64 divided by 10^9");
+}
@@ -0,0 +1,108 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares the truncating safe_duration_cast with exact_duration_cast, which
+ * also checks that nothing was truncated, one at a time and in batches.
+ */
+
+#include "safe_duration_cast/batch.hpp"
+#include "safe_duration_cast/chronoconv.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using From = std::chrono::microseconds;
+using To = std::chrono::milliseconds;
+
+enum class Method
+{
+  truncating,
+  exact,
+  truncating_n,
+  exact_n
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::truncating:
+      return "safe_duration_cast";
+    case Method::exact:
+      return "exact_duration_cast";
+    case Method::truncating_n:
+      return "safe_duration_cast_n";
+    case Method::exact_n:
+      return "exact_duration_cast_n";
+  }
+  return "";
+}
+
+template<Method method>
+void
+doit(const std::vector<From>& in, std::vector<To>& out)
+{
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    switch (method) {
+      case Method::truncating:
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          int ec = 0;
+          out[i] = safe_duration_cast::safe_duration_cast<To>(in[i], ec);
+          failures += ec != 0;
+        }
+        break;
+      case Method::exact:
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          int ec = 0;
+          out[i] = safe_duration_cast::exact_duration_cast<To>(in[i], ec);
+          failures += ec != 0;
+        }
+        break;
+      case Method::truncating_n:
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      in.data(), out.data(), in.size())
+                      .failures;
+        break;
+      case Method::exact_n:
+        failures += safe_duration_cast::exact_duration_cast_n(
+                      in.data(), out.data(), in.size())
+                      .failures;
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main()
+{
+  // whole milliseconds, with an inexact value now and then
+  std::vector<From> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    const std::int64_t ms = static_cast<std::int64_t>(x) / (1 << 20);
+    e = From{ ms * 1000 + ((x >> 8) % 64 == 0 ? 1 : 0) };
+  }
+  std::vector<To> out(in.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::truncating>(in, out);
+    doit<Method::exact>(in, out);
+    doit<Method::truncating_n>(in, out);
+    doit<Method::exact_n>(in, out);
+  }
+}
@@ -0,0 +1,129 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares to_chars for durations with writing the count and the unit
+ * through an ostream, snprintf and, where available, std::format.
+ */
+
+#include "safe_duration_cast/format.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<version>)
+#include <version>
+#endif
+#endif
+#if defined(__cpp_lib_format) && __cpp_lib_format >= 201907L
+#define HAVE_STD_FORMAT 1
+#include <format>
+#else
+#define HAVE_STD_FORMAT 0
+#endif
+
+using Dur = std::chrono::nanoseconds;
+
+enum class Method
+{
+  ostream,
+  snprintf,
+  format,
+  to_chars,
+  humanized
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::ostream:
+      return "ostream";
+    case Method::snprintf:
+      return "snprintf";
+    case Method::format:
+      return "std::format";
+    case Method::to_chars:
+      return "to_chars";
+    case Method::humanized:
+      return "to_chars_humanized";
+  }
+  return "";
+}
+
+template<Method method>
+void
+doit(const std::vector<Dur>& in)
+{
+  constexpr int repetitions = 20;
+  std::ostringstream oss;
+  char buf[64];
+  std::size_t written = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < repetitions; ++r) {
+    for (const auto d : in) {
+      switch (method) {
+        case Method::ostream:
+          oss.str(std::string());
+          oss << d.count() << "ns";
+          written += static_cast<std::size_t>(oss.tellp());
+          break;
+        case Method::snprintf:
+          written += static_cast<std::size_t>(std::snprintf(
+            buf, sizeof(buf), "%lldns", static_cast<long long>(d.count())));
+          break;
+        case Method::format:
+#if HAVE_STD_FORMAT
+          written += static_cast<std::size_t>(
+            std::format_to_n(buf, sizeof(buf), "{}ns", d.count()).size);
+#endif
+          break;
+        case Method::to_chars:
+          written += static_cast<std::size_t>(
+            safe_duration_cast::to_chars(buf, buf + sizeof(buf), d).ptr - buf);
+          break;
+        case Method::humanized:
+          written += static_cast<std::size_t>(
+            safe_duration_cast::to_chars_humanized(buf, buf + sizeof(buf), d)
+              .ptr -
+            buf);
+          break;
+      }
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, characters=" << written << "\n";
+}
+
+int
+main()
+{
+  // latencies of various magnitudes
+  std::vector<Dur> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = Dur{ static_cast<std::int64_t>(x >> (x >> 58)) >> 8 };
+  }
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::ostream>(in);
+    doit<Method::snprintf>(in);
+#if HAVE_STD_FORMAT
+    doit<Method::format>(in);
+#endif
+    doit<Method::to_chars>(in);
+    doit<Method::humanized>(in);
+  }
+}
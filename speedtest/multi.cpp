@@ -0,0 +1,127 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares converting nanoseconds to microseconds, milliseconds and seconds
+ * with one safe_duration_cast per target, with safe_duration_cast_multi
+ * which chains the targets.
+ */
+
+#include "safe_duration_cast/multi.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+using From = std::chrono::nanoseconds;
+using A = std::chrono::microseconds;
+using B = std::chrono::milliseconds;
+using C = std::chrono::seconds;
+
+enum class Method
+{
+  separate,
+  multi,
+  separate_n,
+  multi_n
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::separate:
+      return "safe_duration_cast x3";
+    case Method::multi:
+      return "safe_duration_cast_multi";
+    case Method::separate_n:
+      return "safe_duration_cast_n x3";
+    case Method::multi_n:
+      return "safe_duration_cast_multi_n";
+  }
+  return "";
+}
+
+template<Method method>
+void
+doit(const std::vector<From>& in,
+     std::vector<A>& a,
+     std::vector<B>& b,
+     std::vector<C>& c)
+{
+  using safe_duration_cast::safe_duration_cast;
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    switch (method) {
+      case Method::separate:
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          int ec_a = 0;
+          int ec_b = 0;
+          int ec_c = 0;
+          a[i] = safe_duration_cast<A>(in[i], ec_a);
+          b[i] = safe_duration_cast<B>(in[i], ec_b);
+          c[i] = safe_duration_cast<C>(in[i], ec_c);
+          failures += (ec_a | ec_b | ec_c) != 0;
+        }
+        break;
+      case Method::multi:
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          int ec = 0;
+          std::tie(a[i], b[i], c[i]) =
+            safe_duration_cast::safe_duration_cast_multi<A, B, C>(in[i], ec);
+          failures += ec != 0;
+        }
+        break;
+      case Method::separate_n:
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      in.data(), a.data(), in.size())
+                      .failures;
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      in.data(), b.data(), in.size())
+                      .failures;
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      in.data(), c.data(), in.size())
+                      .failures;
+        break;
+      case Method::multi_n:
+        failures +=
+          safe_duration_cast::safe_duration_cast_multi_n(
+            in.data(), in.size(), nullptr, a.data(), b.data(), c.data())
+            .failures;
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main()
+{
+  std::vector<From> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = From{ static_cast<std::int64_t>(x) / 1024 };
+  }
+  std::vector<A> a(in.size());
+  std::vector<B> b(in.size());
+  std::vector<C> c(in.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::separate>(in, a, b, c);
+    doit<Method::multi>(in, a, b, c);
+    doit<Method::separate_n>(in, a, b, c);
+    doit<Method::multi_n>(in, a, b, c);
+  }
+}
@@ -0,0 +1,135 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares safe_parse_duration with the usual way of parsing a duration:
+ * strtoll for the number, a comparison of the unit suffix and then
+ * safe_duration_cast to the target type.
+ */
+
+#include "safe_duration_cast/parse.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Dur = std::chrono::nanoseconds;
+
+enum class Method
+{
+  strtoll,
+  parse
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::strtoll:
+      return "strtoll and cast";
+    case Method::parse:
+      return "safe_parse_duration";
+  }
+  return "";
+}
+
+// the baseline, which only handles a single integral term
+Dur
+parseStrtoll(const std::string& str, int& ec)
+{
+  using namespace std::chrono;
+  char* end = nullptr;
+  errno = 0;
+  const long long count = std::strtoll(str.c_str(), &end, 10);
+  if (errno != 0 || end == str.c_str()) {
+    ec = 3;
+    return Dur{};
+  }
+  if (std::strcmp(end, "ns") == 0) {
+    return safe_duration_cast::safe_duration_cast<Dur>(nanoseconds{ count },
+                                                       ec);
+  }
+  if (std::strcmp(end, "us") == 0) {
+    return safe_duration_cast::safe_duration_cast<Dur>(microseconds{ count },
+                                                       ec);
+  }
+  if (std::strcmp(end, "ms") == 0) {
+    return safe_duration_cast::safe_duration_cast<Dur>(milliseconds{ count },
+                                                       ec);
+  }
+  if (std::strcmp(end, "s") == 0) {
+    return safe_duration_cast::safe_duration_cast<Dur>(seconds{ count }, ec);
+  }
+  if (std::strcmp(end, "m") == 0) {
+    return safe_duration_cast::safe_duration_cast<Dur>(minutes{ count }, ec);
+  }
+  if (std::strcmp(end, "h") == 0) {
+    return safe_duration_cast::safe_duration_cast<Dur>(hours{ count }, ec);
+  }
+  ec = 3;
+  return Dur{};
+}
+
+template<Method method>
+void
+doit(const std::vector<std::string>& in)
+{
+  constexpr int repetitions = 100;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  std::uint64_t sum = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    for (const auto& str : in) {
+      int ec = 0;
+      Dur d;
+      switch (method) {
+        case Method::strtoll:
+          d = parseStrtoll(str, ec);
+          break;
+        case Method::parse:
+          d = safe_duration_cast::safe_parse_duration<Dur>(str, ec);
+          break;
+      }
+      failures += ec != 0;
+      sum += static_cast<std::uint64_t>(d.count());
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures
+            << " sum=" << sum << "\n";
+}
+
+int
+main()
+{
+  // config and log like values, some with many digits, in units where
+  // they fit in nanoseconds
+  const char* const units[] = { "ns", "us", "ms", "s" };
+  std::vector<std::string> in;
+  std::uint64_t x = 0;
+  for (int i = 0; i < (1 << 14); ++i) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    const int digits = 1 + static_cast<int>((x >> 20) % 12);
+    std::uint64_t count = x >> 32;
+    for (int d = 10; d > digits; --d) {
+      count /= 10;
+    }
+    in.push_back(std::to_string(count) + units[(x >> 8) % 4]);
+  }
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::strtoll>(in);
+    doit<Method::parse>(in);
+  }
+}
@@ -0,0 +1,92 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares safe_to_timespec_n with the usual hand written conversion of
+ * nanoseconds to a timespec, which divides twice and does not check
+ * anything.
+ */
+
+#include "safe_duration_cast/posix_time.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using Dur = std::chrono::nanoseconds;
+
+enum class Method
+{
+  by_hand,
+  timespec_n
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::by_hand:
+      return "by hand";
+    case Method::timespec_n:
+      return "safe_to_timespec_n";
+  }
+  return "";
+}
+
+// the way it is usually done, wrong for negative durations
+void
+byHand(const std::vector<Dur>& in, ::timespec* out)
+{
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    out[i].tv_sec = static_cast<time_t>(in[i].count() / 1000000000);
+    out[i].tv_nsec = static_cast<long>(in[i].count() % 1000000000);
+  }
+}
+
+template<Method method>
+void
+doit(const std::vector<Dur>& in, std::vector<::timespec>& out)
+{
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    switch (method) {
+      case Method::by_hand:
+        byHand(in, out.data());
+        break;
+      case Method::timespec_n:
+        failures +=
+          safe_duration_cast::safe_to_timespec_n(in.data(), out.data(),
+                                                 in.size())
+            .failures;
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main()
+{
+  std::vector<Dur> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = Dur{ static_cast<std::int64_t>(x) / 4 };
+  }
+  std::vector<::timespec> out(in.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::by_hand>(in, out);
+    doit<Method::timespec_n>(in, out);
+  }
+}
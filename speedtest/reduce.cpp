@@ -0,0 +1,92 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares summing durations with std::accumulate, which does not detect
+ * overflow, with safe_sum and safe_sum_parallel, which do.
+ */
+
+#include "safe_duration_cast/parallel_reduce.hpp"
+#include "safe_duration_cast/reduce.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+using Dur = std::chrono::nanoseconds;
+
+enum class Method
+{
+  accumulate,
+  safe_sum,
+  safe_sum_parallel
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::accumulate:
+      return "std::accumulate";
+    case Method::safe_sum:
+      return "safe_sum";
+    case Method::safe_sum_parallel:
+      return "safe_sum_parallel";
+  }
+  return "";
+}
+
+template<Method method>
+void
+doit(const std::vector<Dur>& in)
+{
+  constexpr int repetitions = 20;
+  const auto t0 = std::chrono::steady_clock::now();
+  Dur total{};
+  int failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    int ec = 0;
+    switch (method) {
+      case Method::accumulate:
+        total += std::accumulate(in.begin(), in.end(), Dur{});
+        break;
+      case Method::safe_sum:
+        total += safe_duration_cast::safe_sum(in.data(), in.size(), ec);
+        break;
+      case Method::safe_sum_parallel:
+        total +=
+          safe_duration_cast::safe_sum_parallel(in.data(), in.size(), ec);
+        break;
+    }
+    failures += ec != 0;
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " elements per second, failures=" << failures
+            << " total=" << total.count() << "\n";
+}
+
+int
+main()
+{
+  // latencies up to a second
+  std::vector<Dur> in(1U << 24);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = Dur{ static_cast<std::int64_t>(x >> 34) };
+  }
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::accumulate>(in);
+    doit<Method::safe_sum>(in);
+    doit<Method::safe_sum_parallel>(in);
+  }
+}
@@ -0,0 +1,113 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares reporting errors through an int& out parameter with returning a
+ * cast_result. The output has an int rep, so the compiler must assume that
+ * writing an element may change the error code (and the other way around),
+ * and store the error code on every iteration.
+ */
+
+#include "safe_duration_cast/result.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// keeps the error code a reference, as when called from elsewhere
+#if defined(__GNUC__)
+#define NOINLINE __attribute__((noinline))
+#else
+#define NOINLINE
+#endif
+
+using From = std::chrono::duration<std::int64_t>;
+using To = std::chrono::duration<int, std::milli>;
+
+enum class Method
+{
+  error_code,
+  result
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::error_code:
+      return "safe_duration_cast(from, ec)";
+    case Method::result:
+      return "try_duration_cast(from)";
+  }
+  return "";
+}
+
+// converts all, counting the failures through the error code
+NOINLINE std::size_t
+convertWithErrorCode(const From* in, To* out, std::size_t n, int& ec)
+{
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    out[i] = safe_duration_cast::safe_duration_cast<To>(in[i], ec);
+    failures += ec != 0;
+  }
+  return failures;
+}
+
+// converts all, counting the failures through the returned result
+NOINLINE std::size_t
+convertWithResult(const From* in, To* out, std::size_t n)
+{
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto r = safe_duration_cast::try_duration_cast<To>(in[i]);
+    out[i] = r.value;
+    failures += !r.ok();
+  }
+  return failures;
+}
+
+template<Method method>
+void
+doit(const std::vector<From>& in, std::vector<To>& out)
+{
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    if (method == Method::error_code) {
+      int ec = 0;
+      failures += convertWithErrorCode(in.data(), out.data(), in.size(), ec);
+    } else {
+      failures += convertWithResult(in.data(), out.data(), in.size());
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main()
+{
+  // mostly in range, with a failure now and then
+  std::vector<From> in(1U << 20);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    // about +-2.2e6 seconds, of which a few percent do not fit
+    e = From{ (static_cast<std::int64_t>(x >> 42) - (1 << 21)) * 21 / 20 };
+  }
+  std::vector<To> out(in.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::error_code>(in, out);
+    doit<Method::result>(in, out);
+  }
+}
@@ -0,0 +1,108 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares the truncating safe_duration_cast with safe_floor, which is what
+ * putting event times into buckets needs, one at a time and in batches.
+ */
+
+#include "safe_duration_cast/batch.hpp"
+#include "safe_duration_cast/chronoconv.hpp"
+#include "safe_duration_cast/rounding.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+using From = std::chrono::nanoseconds;
+using To = std::chrono::milliseconds;
+
+enum class Method
+{
+  truncating,
+  floor,
+  truncating_n,
+  floor_n
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::truncating:
+      return "safe_duration_cast";
+    case Method::floor:
+      return "safe_floor";
+    case Method::truncating_n:
+      return "safe_duration_cast_n";
+    case Method::floor_n:
+      return "safe_floor_n";
+  }
+  return "";
+}
+
+template<Method method>
+void
+doit(const std::vector<From>& in, std::vector<To>& out)
+{
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    switch (method) {
+      case Method::truncating:
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          int ec = 0;
+          out[i] = safe_duration_cast::safe_duration_cast<To>(in[i], ec);
+          failures += ec != 0;
+        }
+        break;
+      case Method::floor:
+        for (std::size_t i = 0; i < in.size(); ++i) {
+          int ec = 0;
+          out[i] = safe_duration_cast::safe_floor<To>(in[i], ec);
+          failures += ec != 0;
+        }
+        break;
+      case Method::truncating_n:
+        failures += safe_duration_cast::safe_duration_cast_n(
+                      in.data(), out.data(), in.size())
+                      .failures;
+        break;
+      case Method::floor_n:
+        failures +=
+          safe_duration_cast::safe_floor_n(in.data(), out.data(), in.size())
+            .failures;
+        break;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+int
+main()
+{
+  // event times on both sides of zero
+  std::vector<From> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = From{ static_cast<std::int64_t>(x) / 4 };
+  }
+  std::vector<To> out(in.size());
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::truncating>(in, out);
+    doit<Method::floor>(in, out);
+    doit<Method::truncating_n>(in, out);
+    doit<Method::floor_n>(in, out);
+  }
+}
@@ -0,0 +1,107 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Compares converting arrays with the ratio known at compile time, through
+ * safe_duration_cast_n, with a runtime_duration_converter set up from the
+ * same ratio at runtime.
+ */
+
+#include "safe_duration_cast/batch.hpp"
+#include "safe_duration_cast/runtime_converter.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <ratio>
+#include <vector>
+
+enum class Method
+{
+  compile_time,
+  runtime
+};
+
+const char*
+methodName(Method method)
+{
+  switch (method) {
+    case Method::compile_time:
+      return "safe_duration_cast_n";
+    case Method::runtime:
+      return "runtime_duration_converter";
+  }
+  return "";
+}
+
+template<Method method, typename From, typename To>
+void
+doit(const std::vector<From>& in, std::vector<To>& out)
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using Converter = safe_duration_cast::
+    runtime_duration_converter<typename From::rep, typename To::rep>;
+  // the ratio is passed through a volatile, as if it was read from a file
+  volatile std::intmax_t num = Factor::num;
+  volatile std::intmax_t den = Factor::den;
+  const Converter converter(num, den);
+
+  constexpr int repetitions = 200;
+  const auto t0 = std::chrono::steady_clock::now();
+  std::size_t failures = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    if (method == Method::compile_time) {
+      failures += safe_duration_cast::safe_duration_cast_n(
+                    in.data(), out.data(), in.size())
+                    .failures;
+    } else {
+      static_assert(sizeof(From) == sizeof(typename From::rep), "");
+      static_assert(sizeof(To) == sizeof(typename To::rep), "");
+      failures += converter
+                    .convert_n(reinterpret_cast<const typename From::rep*>(
+                                 in.data()),
+                               reinterpret_cast<typename To::rep*>(out.data()),
+                               in.size())
+                    .failures;
+    }
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+  std::cout << methodName(method) << " " << Factor::num << "/" << Factor::den
+            << " speed:\t"
+            << repetitions * static_cast<double>(in.size()) / elapsed_seconds
+            << " operations per second, failures=" << failures << "\n";
+}
+
+template<typename From, typename To>
+void
+compare()
+{
+  // mostly in range, with a failure now and then
+  std::vector<From> in(1U << 16);
+  std::uint64_t x = 0;
+  for (auto& e : in) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    e = From{ static_cast<typename From::rep>(static_cast<std::int64_t>(x) /
+                                              (1 << 20)) };
+  }
+  std::vector<To> out(in.size());
+  for (int repetition = 0; repetition < 2; ++repetition) {
+    doit<Method::compile_time>(in, out);
+    doit<Method::runtime>(in, out);
+  }
+}
+
+int
+main()
+{
+  using std::chrono::duration;
+  compare<std::chrono::milliseconds, std::chrono::microseconds>();
+  compare<std::chrono::nanoseconds, std::chrono::milliseconds>();
+  compare<duration<std::int64_t, std::ratio<1, 90000>>,
+          duration<std::int64_t, std::ratio<1, 44100>>>();
+}
@@ -6,130 +6,110 @@
  * at your option).
  */
 
+#include "safe_duration_cast/batch.hpp"
 #include "safe_duration_cast/chronoconv.hpp"
+#include "safe_duration_cast/safe_range.hpp"
 
 #include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <type_traits>
 
-/**
- * finds the largest input that can be converted from FromDuration to ToDuration
- * without danger.
- */
-template<class FromDuration, class ToDuration>
-constexpr FromDuration
-findLargestNonproblematicInput()
+enum class Method
 {
-  auto worksfine = [](const typename FromDuration::rep value) /*constexpr*/ {
-    int ec = 0;
-    const auto from = FromDuration{ value };
-    /*const auto result =*/safe_duration_cast::safe_duration_cast<ToDuration>(
-      from, ec);
-    return ec == 0;
-  };
-  typename FromDuration::rep min = 0;
-  typename FromDuration::rep max =
-    std::numeric_limits<typename FromDuration::rep>::max();
-
-  // assert(worksfine(min));
-  if (worksfine(max)) {
-    return FromDuration{ max };
-  }
-  while ((max - min) > 1) {
-    auto candidate = min + (max - min) / 2;
-    // std::cout<<"min="<<min<<" max="<<max<<" trying "<<candidate<<'\n';
-    if (worksfine(candidate)) {
-      min = candidate;
-    } else {
-      max = candidate;
-    }
-  }
-  return FromDuration{ min };
-}
+  stdchrono,
+  safe,
+  safe_batch
+};
 
-template<class FromDuration, class ToDuration>
-constexpr FromDuration
-findLowestNonproblematicInput()
+const char*
+methodName(Method method)
 {
-  auto worksfine = [](const typename FromDuration::rep value) /*constexpr*/ {
-    int ec = 0;
-    const auto from = FromDuration{ value };
-    /*const auto result =*/safe_duration_cast::safe_duration_cast<ToDuration>(
-      from, ec);
-    return ec == 0;
-  };
-  typename FromDuration::rep min =
-    std::numeric_limits<typename FromDuration::rep>::lowest();
-  typename FromDuration::rep max =
-    0; // std::numeric_limits<typename FromDuration::rep>::max();
-
-  // assert(worksfine(max));
-  if (worksfine(min)) {
-    return FromDuration{ min };
+  switch (method) {
+    case Method::stdchrono:
+      return "std::chrono::duration_cast";
+    case Method::safe:
+      return "safe_duration_cast";
+    case Method::safe_batch:
+      return "safe_duration_cast_n";
   }
-  while ((max - min) > 1) {
-    auto candidate = min + (max - min) / 2;
-    // std::cout<<"min="<<min<<" max="<<max<<" trying "<<candidate<<'\n';
-    if (worksfine(candidate)) {
-      max = candidate;
-    } else {
-      min = candidate;
-    }
-  }
-  return FromDuration{ max };
+  return "";
 }
 
-template<bool usestdchrono>
+template<Method method, class From, class To>
 int
 doit(int /*argc*/, char* argv[])
 {
+  using Rep = typename From::rep;
 
-  using From = std::chrono::duration<std::uint64_t>;
-  using To = std::chrono::duration<std::uint64_t, std::ratio<3, 5>>;
-
-  constexpr auto minsafe = findLowestNonproblematicInput<From, To>();
-  constexpr auto maxsafe = findLargestNonproblematicInput<From, To>();
-  /*
-  std::cout << "safe input range is " << minsafe.count() << " to "
-            << maxsafe.count() << '\n';
-*/
+  // the largest input that can be converted without danger
+  constexpr auto maxsafe = safe_duration_cast::safe_range<From, To>::max();
 
   const auto t0 = std::chrono::steady_clock::now();
 
   std::uint64_t dummycount = 0;
-  const std::uint64_t iterations =
-    std::min(std::uint64_t{ 2000000000ULL }, maxsafe.count());
-  for (std::uint64_t i = 0; i < iterations; ++i) {
-    const std::uint64_t input = i;
-    int ec;
-    const auto from = From{ input };
-    if (!usestdchrono) {
-      const auto result = safe_duration_cast::safe_duration_cast<To>(from, ec);
-      dummycount += result.count();
-    } else {
-      const auto result = std::chrono::duration_cast<To>(from);
-      dummycount += result.count();
+  const std::uint64_t iterations = std::min(
+    std::uint64_t{ 2000000000ULL }, static_cast<std::uint64_t>(maxsafe.count()));
+  if (method == Method::safe_batch) {
+    // convert the same sequence of inputs, a chunk at a time.
+    constexpr std::size_t chunksize = 1024;
+    From in[chunksize];
+    To out[chunksize];
+    for (std::uint64_t i = 0; i < iterations; i += chunksize) {
+      const std::size_t n = static_cast<std::size_t>(
+        std::min(std::uint64_t{ chunksize }, iterations - i));
+      for (std::size_t j = 0; j < n; ++j) {
+        in[j] = From{ static_cast<Rep>(i + j) };
+      }
+      safe_duration_cast::safe_duration_cast_n(in, out, n);
+      for (std::size_t j = 0; j < n; ++j) {
+        dummycount += static_cast<std::uint64_t>(out[j].count());
+      }
+    }
+  } else {
+    for (std::uint64_t i = 0; i < iterations; ++i) {
+      const Rep input = static_cast<Rep>(i);
+      int ec;
+      const auto from = From{ input };
+      if (method == Method::safe) {
+        const auto result =
+          safe_duration_cast::safe_duration_cast<To>(from, ec);
+        dummycount += static_cast<std::uint64_t>(result.count());
+      } else {
+        const auto result = std::chrono::duration_cast<To>(from);
+        dummycount += static_cast<std::uint64_t>(result.count());
+      }
     }
   }
   const auto t1 = std::chrono::steady_clock::now();
   const auto elapsed_seconds =
     std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
-  std::cout << (usestdchrono ? "std::chrono::duration_cast"
-                             : "safe_duration_cast")
-            << " speed:\t" << iterations / elapsed_seconds
+  std::cout << methodName(method) << " speed:\t" << iterations / elapsed_seconds
             << " operations per second, dummy=" << dummycount << "\n";
   return 0;
 }
 
+template<class From, class To>
+void
+compareMethods(int argc, char* argv[])
+{
+  for (int repetition = 0; repetition < 3; ++repetition) {
+    doit<Method::safe, From, To>(argc, argv);
+    doit<Method::stdchrono, From, To>(argc, argv);
+    doit<Method::safe_batch, From, To>(argc, argv);
+  }
+}
+
 int
 main(int argc, char* argv[])
 {
-  doit<false>(argc, argv);
-  doit<true>(argc, argv);
-  doit<false>(argc, argv);
-  doit<true>(argc, argv);
-  doit<false>(argc, argv);
-  doit<true>(argc, argv);
+  std::cout << "uint64 seconds to the 3/5 period:\n";
+  compareMethods<std::chrono::duration<std::uint64_t>,
+                 std::chrono::duration<std::uint64_t, std::ratio<3, 5>>>(argc,
+                                                                         argv);
+  std::cout << "int64 seconds to milliseconds:\n";
+  compareMethods<std::chrono::duration<std::int64_t>,
+                 std::chrono::duration<std::int64_t, std::milli>>(argc, argv);
 }
@@ -0,0 +1,171 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <ratio>
+#include <safe_duration_cast/any_duration.hpp>
+#include <vector>
+
+using safe_duration_cast::any_duration;
+using safe_duration_cast::duration_rep;
+using safe_duration_cast::duration_unit;
+
+namespace {
+using Days = std::chrono::duration<std::int32_t, std::ratio<86400>>;
+using FloatSeconds = std::chrono::duration<double>;
+using Millis32 = std::chrono::duration<std::int32_t, std::milli>;
+
+// an element of the given kind, made from x
+any_duration
+make(int kind, std::int64_t x)
+{
+  switch (kind % 6) {
+    case 0:
+      return std::chrono::nanoseconds{ x };
+    case 1:
+      return std::chrono::microseconds{ x };
+    case 2:
+      return Millis32{ static_cast<std::int32_t>(x) };
+    case 3:
+      return std::chrono::duration<double, std::ratio<60>>{ x * 1e-3 };
+    case 4:
+      return Days{ static_cast<std::int32_t>(x >> 40) };
+    default:
+      return std::chrono::duration<std::int64_t, std::ratio<3600>>{ x >> 30 };
+  }
+}
+
+// converts make(kind, x) the way safe_duration_cast converts the duration
+template<typename To>
+To
+reference(int kind, std::int64_t x, int& ec)
+{
+  using safe_duration_cast::safe_duration_cast;
+  switch (kind % 6) {
+    case 0:
+      return safe_duration_cast<To>(std::chrono::nanoseconds{ x }, ec);
+    case 1:
+      return safe_duration_cast<To>(std::chrono::microseconds{ x }, ec);
+    case 2:
+      return safe_duration_cast<To>(Millis32{ static_cast<std::int32_t>(x) },
+                                    ec);
+    case 3:
+      return safe_duration_cast<To>(
+        std::chrono::duration<double, std::ratio<60>>{ x * 1e-3 }, ec);
+    case 4:
+      return safe_duration_cast<To>(Days{ static_cast<std::int32_t>(x >> 40) },
+                                    ec);
+    default:
+      return safe_duration_cast<To>(
+        std::chrono::duration<std::int64_t, std::ratio<3600>>{ x >> 30 }, ec);
+  }
+}
+
+template<typename To>
+void
+verifyBatch(const std::vector<int>& kinds, const std::vector<std::int64_t>& xs)
+{
+  std::vector<any_duration> in;
+  for (std::size_t i = 0; i < kinds.size(); ++i) {
+    in.push_back(make(kinds[i], xs[i]));
+  }
+  std::vector<To> out(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  const auto summary = safe_duration_cast::safe_duration_cast_n(
+    in.data(), out.data(), in.size(), failmask.data());
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int expected_ec = 0;
+    const To expected = reference<To>(kinds[i], xs[i], expected_ec);
+    int ec = 0;
+    const To scalar = safe_duration_cast::safe_duration_cast<To>(in[i], ec);
+    REQUIRE(ec == expected_ec);
+    REQUIRE(scalar == expected);
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == (expected_ec != 0));
+    REQUIRE(out[i] == expected);
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+}
+} // namespace
+
+TEST_CASE("any_duration holds the unit and representation")
+{
+  REQUIRE(sizeof(any_duration) == 16);
+  const any_duration d{ Days{ 3 } };
+  REQUIRE(d.unit() == duration_unit::days);
+  REQUIRE(d.rep() == duration_rep::int32);
+  const any_duration f{ FloatSeconds{ 1.5 } };
+  REQUIRE(f.unit() == duration_unit::seconds);
+  REQUIRE(f.rep() == duration_rep::float64);
+  const any_duration z;
+  REQUIRE(z.unit() == duration_unit::seconds);
+  REQUIRE(z.rep() == duration_rep::int64);
+  // a period which is not reduced is still recognized
+  const any_duration m{ std::chrono::duration<std::int64_t,
+                                              std::ratio<60000, 1000>>{ 2 } };
+  REQUIRE(m.unit() == duration_unit::minutes);
+}
+
+TEST_CASE("safe_duration_cast of any_duration")
+{
+  using safe_duration_cast::safe_duration_cast;
+  int ec = 0;
+  const any_duration two_days{ Days{ 2 } };
+  REQUIRE(safe_duration_cast<std::chrono::hours>(two_days, ec) ==
+          std::chrono::hours{ 48 });
+  REQUIRE(ec == 0);
+  REQUIRE(safe_duration_cast<std::chrono::milliseconds>(
+            any_duration{ FloatSeconds{ 1.5 } }, ec) ==
+          std::chrono::milliseconds{ 1500 });
+  REQUIRE(ec == 0);
+  safe_duration_cast<Millis32>(any_duration{ Days{ 100 } }, ec);
+  REQUIRE(ec == 1);
+  safe_duration_cast<std::chrono::seconds>(
+    any_duration{ FloatSeconds{ std::numeric_limits<double>::quiet_NaN() } },
+    ec);
+  REQUIRE(ec != 0);
+  const any_duration many_days{ Days{ 200000 } };
+  REQUIRE_THROWS(safe_duration_cast<std::chrono::nanoseconds>(many_days));
+}
+
+TEST_CASE("safe_duration_cast_n of any_duration")
+{
+  std::mt19937_64 rng(2019);
+  const std::size_t n = 1000;
+  std::vector<std::int64_t> xs(n);
+  for (auto& x : xs) {
+    x = static_cast<std::int64_t>(rng());
+  }
+
+  // all of the same kind, in runs, and mixed
+  for (int pattern = 0; pattern < 3; ++pattern) {
+    std::vector<int> kinds(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      switch (pattern) {
+        case 0:
+          kinds[i] = 1;
+          break;
+        case 1:
+          kinds[i] = static_cast<int>(i / 100);
+          break;
+        default:
+          kinds[i] = static_cast<int>(rng() % 6);
+      }
+    }
+    verifyBatch<std::chrono::milliseconds>(kinds, xs);
+    verifyBatch<Millis32>(kinds, xs);
+    verifyBatch<FloatSeconds>(kinds, xs);
+  }
+}
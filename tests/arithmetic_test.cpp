@@ -0,0 +1,129 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/arithmetic.hpp>
+#include <stdexcept>
+#include <type_traits>
+
+namespace sdc = safe_duration_cast;
+
+namespace {
+using Seconds = std::chrono::duration<std::int64_t>;
+using Millis = std::chrono::duration<std::int64_t, std::milli>;
+using Small = std::chrono::duration<std::int16_t>;
+using SmallMillis = std::chrono::duration<std::int16_t, std::milli>;
+} // namespace
+
+TEST_CASE("safe_add and safe_sub")
+{
+  int ec = 0;
+  const auto sum = sdc::safe_add(Seconds{ 2 }, Millis{ 5 }, ec);
+  static_assert(std::is_same<decltype(sum), const Millis>::value, "");
+  REQUIRE(ec == 0);
+  REQUIRE(sum.count() == 2005);
+  REQUIRE(sdc::safe_sub(Seconds{ 2 }, Millis{ 5 }, ec).count() == 1995);
+  REQUIRE(ec == 0);
+
+  // the conversion to the common type overflows
+  REQUIRE(sdc::safe_add(Seconds::max(), Millis{ 0 }, ec).count() == 0);
+  REQUIRE(ec != 0);
+  // the sum overflows
+  sdc::safe_add(Millis::max(), Millis{ 1 }, ec);
+  REQUIRE(ec != 0);
+  sdc::safe_sub(Millis::min(), Millis{ 1 }, ec);
+  REQUIRE(ec != 0);
+  REQUIRE(sdc::safe_sub(Millis{ -1 }, Millis::max(), ec) == Millis::min());
+  REQUIRE(ec == 0);
+}
+
+TEST_CASE("safe_mul")
+{
+  int ec = 0;
+  REQUIRE(sdc::safe_mul(Small{ 100 }, 300, ec).count() == 30000);
+  REQUIRE(ec == 0);
+  // the product is in the common type of the representations, int
+  REQUIRE(sdc::safe_mul(Small{ 1000 }, 1000, ec).count() == 1000000);
+  REQUIRE(ec == 0);
+  sdc::safe_mul(Small{ 1000 }, std::int16_t{ 1000 }, ec);
+  REQUIRE(ec != 0);
+  sdc::safe_mul(Seconds::min(), -1, ec);
+  REQUIRE(ec != 0);
+  // the scalar does not fit in the common representation
+  sdc::safe_mul(Seconds{ 1 }, std::numeric_limits<std::uint64_t>::max(), ec);
+  REQUIRE(ec == 0);
+  sdc::safe_mul(Seconds{ -1 }, std::numeric_limits<std::uint64_t>::max(), ec);
+  REQUIRE(ec != 0);
+
+  const std::chrono::duration<double> huge{ 1e300 };
+  const auto f = sdc::safe_mul(huge, 1e300, ec);
+  REQUIRE(ec != 0);
+  REQUIRE(f.count() == 0);
+}
+
+TEST_CASE("safe_div and safe_mod")
+{
+  int ec = 0;
+  REQUIRE(sdc::safe_div(Seconds{ 7 }, 2, ec).count() == 3);
+  REQUIRE(ec == 0);
+  sdc::safe_div(Seconds{ 7 }, 0, ec);
+  REQUIRE(ec != 0);
+  sdc::safe_div(Seconds::min(), -1, ec);
+  REQUIRE(ec != 0);
+  REQUIRE(sdc::safe_div(Seconds{ 7 }, Millis{ 2000 }, ec) == 3);
+  REQUIRE(ec == 0);
+  sdc::safe_div(Seconds{ 7 }, Millis{ 0 }, ec);
+  REQUIRE(ec != 0);
+  sdc::safe_div(std::chrono::duration<double>{ 1.0 }, 0.0, ec);
+  REQUIRE(ec != 0);
+
+  REQUIRE(sdc::safe_mod(Seconds{ 7 }, 4, ec).count() == 3);
+  REQUIRE(ec == 0);
+  REQUIRE(sdc::safe_mod(Seconds::min(), -1, ec).count() == 0);
+  REQUIRE(ec == 0);
+  sdc::safe_mod(Seconds{ 7 }, 0, ec);
+  REQUIRE(ec != 0);
+  REQUIRE(sdc::safe_mod(Seconds{ 7 }, Millis{ 1500 }, ec).count() == 1000);
+  REQUIRE(ec == 0);
+}
+
+TEST_CASE("safe arithmetic agrees with std::chrono when in range")
+{
+  for (int a = -40; a <= 40; a += 3) {
+    for (int b = -40; b <= 40; b += 7) {
+      int ec = 0;
+      const Small x{ static_cast<std::int16_t>(a * 800) };
+      const SmallMillis y{ static_cast<std::int16_t>(b * 800) };
+      const auto sum = sdc::safe_add(x, y, ec);
+      const long exact = a * 800L * 1000 + b * 800L;
+      if (exact >= -32768 && exact <= 32767 && a * 800L * 1000 >= -32768 &&
+          a * 800L * 1000 <= 32767) {
+        REQUIRE(ec == 0);
+        REQUIRE(sum.count() == exact);
+      } else {
+        REQUIRE(ec != 0);
+      }
+    }
+  }
+}
+
+TEST_CASE("throwing safe arithmetic")
+{
+  REQUIRE(sdc::safe_add(Seconds{ 1 }, Seconds{ 2 }).count() == 3);
+  REQUIRE_THROWS_AS(sdc::safe_add(Millis::max(), Millis{ 1 }),
+                    std::runtime_error);
+  REQUIRE_THROWS_AS(sdc::safe_sub(Millis::min(), Millis{ 1 }),
+                    std::runtime_error);
+  REQUIRE_THROWS_AS(sdc::safe_mul(Millis::max(), 2), std::runtime_error);
+  REQUIRE_THROWS_AS(sdc::safe_div(Millis{ 1 }, 0), std::runtime_error);
+  REQUIRE_THROWS_AS(sdc::safe_mod(Millis{ 1 }, Millis{ 0 }),
+                    std::runtime_error);
+}
@@ -0,0 +1,180 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/batch.hpp>
+#include <vector>
+
+/**
+ * makes a mix of small values and values close to the limits of Rep.
+ */
+template<typename Rep>
+std::vector<Rep>
+makeInput(std::size_t n)
+{
+  using L = std::numeric_limits<Rep>;
+  std::vector<Rep> ret;
+  for (std::size_t i = 0; i < n; ++i) {
+    const Rep small = static_cast<Rep>(i % 100);
+    switch (i % 5) {
+      case 0:
+        ret.push_back(static_cast<Rep>(L::max() - small));
+        break;
+      case 1:
+        ret.push_back(static_cast<Rep>(L::min() + small));
+        break;
+      case 2:
+        ret.push_back(static_cast<Rep>(L::max() / 1000 + small - 50));
+        break;
+      case 3:
+        ret.push_back(static_cast<Rep>(L::min() / 1000 + small - 50));
+        break;
+      default:
+        ret.push_back(small);
+    }
+  }
+  return ret;
+}
+
+/**
+ * verifies the batch conversion gives the same results as converting one
+ * element at a time.
+ */
+template<typename From, typename To>
+void
+verifySameAsScalar(std::size_t n)
+{
+  std::vector<From> in;
+  for (auto count : makeInput<typename From::rep>(n)) {
+    in.push_back(From{ count });
+  }
+  std::vector<To> out(n);
+  std::vector<std::uint64_t> mask(
+    safe_duration_cast::batch_mask_words(n) + 1, ~std::uint64_t{});
+  const auto result =
+    safe_duration_cast::safe_duration_cast_n(in.data(), out.data(), n, mask.data());
+
+  std::size_t failures = 0;
+  std::size_t first_failure = n;
+  for (std::size_t i = 0; i < n; ++i) {
+    int ec = 0;
+    const auto expected = safe_duration_cast::safe_duration_cast<To>(in[i], ec);
+    const bool failed = (mask[i / 64] >> (i % 64)) & 1;
+    REQUIRE(failed == (ec != 0));
+    if (ec) {
+      REQUIRE(out[i].count() == 0);
+      if (failures++ == 0) {
+        first_failure = i;
+      }
+    } else {
+      REQUIRE(out[i] == expected);
+    }
+  }
+  REQUIRE(result.failures == failures);
+  REQUIRE(result.first_failure == first_failure);
+
+  // the bits beyond n are cleared, but nothing after the last word is touched
+  if (n % 64 != 0) {
+    REQUIRE((mask[n / 64] >> (n % 64)) == 0);
+  }
+  REQUIRE(mask.back() == ~std::uint64_t{});
+}
+
+template<typename From, typename To>
+void
+verifySizes()
+{
+  for (std::size_t n : { 0, 1, 3, 63, 64, 65, 200 }) {
+    verifySameAsScalar<From, To>(n);
+  }
+}
+
+TEST_CASE("batch int64 seconds to milliseconds")
+{
+  using From = std::chrono::duration<std::int64_t>;
+  using To = std::chrono::duration<std::int64_t, std::milli>;
+  verifySizes<From, To>();
+}
+
+TEST_CASE("batch int64 milliseconds to seconds")
+{
+  using From = std::chrono::duration<std::int64_t, std::milli>;
+  using To = std::chrono::duration<std::int64_t>;
+  verifySizes<From, To>();
+}
+
+TEST_CASE("batch uint64 to the 3/5 period")
+{
+  using From = std::chrono::duration<std::uint64_t>;
+  using To = std::chrono::duration<std::uint64_t, std::ratio<3, 5>>;
+  verifySizes<From, To>();
+}
+
+TEST_CASE("batch in place, where count*num overflows")
+{
+  using From = std::chrono::duration<std::int64_t>;
+  using To = std::chrono::duration<std::int64_t, std::ratio<3, 5>>;
+  using L = std::numeric_limits<std::int64_t>;
+  // the kernel rejects these, and the retry must see the original counts
+  std::vector<From> data;
+  for (auto count : makeInput<std::int64_t>(200)) {
+    data.push_back(From{ count });
+  }
+  for (auto count :
+       { L::max() / 2, L::min() / 2, L::max() / 4, L::max() / 5 + 1 }) {
+    data.push_back(From{ count });
+  }
+  const std::vector<From> original = data;
+  const std::size_t n = data.size();
+  std::vector<std::uint64_t> mask(safe_duration_cast::batch_mask_words(n));
+  To* out = reinterpret_cast<To*>(data.data());
+  safe_duration_cast::safe_duration_cast_n(data.data(), out, n, mask.data());
+  for (std::size_t i = 0; i < n; ++i) {
+    int ec = 0;
+    const auto expected =
+      safe_duration_cast::safe_duration_cast<To>(original[i], ec);
+    REQUIRE(((mask[i / 64] >> (i % 64)) & 1) == (ec != 0 ? 1U : 0U));
+    REQUIRE(out[i] == (ec ? To{} : expected));
+  }
+}
+
+TEST_CASE("batch with narrowing and sign change")
+{
+  using From = std::chrono::duration<int, std::milli>;
+  verifySizes<From, std::chrono::duration<short, std::deci>>();
+  verifySizes<From, std::chrono::duration<unsigned, std::micro>>();
+  verifySizes<std::chrono::duration<unsigned>, From>();
+}
+
+TEST_CASE("batch floating point")
+{
+  using From = std::chrono::duration<double, std::milli>;
+  verifySizes<From, std::chrono::duration<float, std::micro>>();
+  verifySizes<std::chrono::duration<std::int64_t, std::nano>,
+              std::chrono::duration<double>>();
+  verifySizes<std::chrono::duration<double>,
+              std::chrono::duration<std::int64_t, std::milli>>();
+  verifySizes<std::chrono::duration<float, std::milli>,
+              std::chrono::duration<std::uint32_t, std::micro>>();
+}
+
+TEST_CASE("batch without a mask, in place")
+{
+  using D = std::chrono::duration<std::int64_t>;
+  std::vector<D> data{ D{ 1 },
+                       D{ std::numeric_limits<std::int64_t>::max() },
+                       D{ -3 } };
+  const auto result = safe_duration_cast::safe_duration_cast_n(
+    data.data(), data.data(), data.size(), nullptr);
+  REQUIRE(result.failures == 0);
+  REQUIRE(result.first_failure == data.size());
+  REQUIRE(data[1].count() == std::numeric_limits<std::int64_t>::max());
+}
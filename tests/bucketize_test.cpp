@@ -0,0 +1,143 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/bucketize.hpp>
+#include <vector>
+
+#include "testsupport.hpp"
+
+namespace {
+// the bucket index computed in 128 bits. returns false on failure.
+template<typename Index, typename Rep>
+bool
+reference(Rep ts, Rep width, Rep origin, Index& index)
+{
+  using tests::Int128_t;
+  using R = std::numeric_limits<Rep>;
+  using I = std::numeric_limits<Index>;
+  index = 0;
+  if (width <= 0) {
+    return false;
+  }
+  const Int128_t offset = Int128_t(ts) - Int128_t(origin);
+  if (offset < Int128_t(R::min()) || offset > Int128_t(R::max())) {
+    return false;
+  }
+  Int128_t q = offset / Int128_t(width);
+  if (q * Int128_t(width) != offset && offset < 0) {
+    q -= 1;
+  }
+  if (q < Int128_t(I::min()) || q > Int128_t(I::max())) {
+    return false;
+  }
+  index = static_cast<Index>(q);
+  return true;
+}
+
+template<typename Index, typename Rep>
+void
+verify(Rep width, Rep origin)
+{
+  using Dur = std::chrono::duration<Rep, std::milli>;
+  const auto ts = tests::durations<Dur>();
+  std::vector<Index> idx(ts.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(ts.size()));
+  const auto summary = safe_duration_cast::safe_bucketize(
+    ts.data(), ts.size(), Dur{ width }, Dur{ origin }, idx.data(),
+    failmask.data());
+
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < ts.size(); ++i) {
+    Index expected;
+    const bool ok = reference(ts[i].count(), width, origin, expected);
+    int ec = 0;
+    const Index index = safe_duration_cast::safe_bucket<Index>(
+      ts[i], Dur{ width }, Dur{ origin }, ec);
+    REQUIRE(ec == (ok ? 0 : 1));
+    REQUIRE(index == expected);
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == !ok);
+    REQUIRE(idx[i] == expected);
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+}
+
+template<typename Index, typename Rep>
+void
+verifyWidths()
+{
+  using L = std::numeric_limits<Rep>;
+  const Rep origins[] = { Rep{ 0 }, static_cast<Rep>(L::max() / 3),
+                          L::min(), L::max() };
+  const Rep widths[] = { Rep{ 1 },  Rep{ 2 },  Rep{ 7 },
+                         Rep{ 60 }, Rep{ 100 }, L::max(),
+                         static_cast<Rep>(L::max() / 2 + 1) };
+  for (auto origin : origins) {
+    for (auto width : widths) {
+      verify<Index>(width, origin);
+    }
+  }
+}
+} // namespace
+
+TEST_CASE("bucket indices")
+{
+  using std::chrono::milliseconds;
+  using std::chrono::seconds;
+  int ec = 0;
+  const seconds minute{ 60 };
+  REQUIRE(safe_duration_cast::safe_bucket(seconds{ 59 }, minute, seconds{},
+                                          ec) == 0);
+  REQUIRE(safe_duration_cast::safe_bucket(seconds{ 60 }, minute, seconds{},
+                                          ec) == 1);
+  REQUIRE(safe_duration_cast::safe_bucket(seconds{ -1 }, minute, seconds{},
+                                          ec) == -1);
+  REQUIRE(safe_duration_cast::safe_bucket(seconds{ -60 }, minute, seconds{},
+                                          ec) == -1);
+  REQUIRE(safe_duration_cast::safe_bucket(seconds{ -61 }, minute, seconds{},
+                                          ec) == -2);
+  REQUIRE(safe_duration_cast::safe_bucket(seconds{ 100 }, minute,
+                                          seconds{ 40 }, ec) == 1);
+  REQUIRE(ec == 0);
+
+  // the subtraction of the origin overflows
+  using L = std::numeric_limits<std::int64_t>;
+  safe_duration_cast::safe_bucket(seconds{ L::min() }, minute, seconds{ 1 },
+                                  ec);
+  REQUIRE(ec == 1);
+  // the index does not fit
+  safe_duration_cast::safe_bucket<std::int32_t>(
+    seconds{ L::max() }, minute, seconds{}, ec);
+  REQUIRE(ec == 1);
+  safe_duration_cast::safe_bucket<std::uint32_t>(
+    seconds{ -1 }, minute, seconds{}, ec);
+  REQUIRE(ec == 1);
+  // invalid widths
+  safe_duration_cast::safe_bucket(seconds{ 1 }, seconds{}, seconds{}, ec);
+  REQUIRE(ec == 1);
+  safe_duration_cast::safe_bucket(seconds{ 1 }, seconds{ -60 }, seconds{}, ec);
+  REQUIRE(ec == 1);
+}
+
+TEST_CASE("safe_bucketize against a 128 bit reference")
+{
+  verifyWidths<std::int64_t, std::int64_t>();
+  verifyWidths<std::int32_t, std::int64_t>();
+  verifyWidths<std::uint32_t, std::int64_t>();
+  verifyWidths<std::int64_t, std::uint64_t>();
+  verifyWidths<std::int64_t, std::int32_t>();
+  verifyWidths<std::int8_t, std::int16_t>();
+  verifyWidths<std::uint16_t, std::uint16_t>();
+  verifyWidths<std::int64_t, std::int8_t>();
+}
@@ -0,0 +1,235 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include "testsupport.hpp"
+#include <cfenv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <safe_duration_cast/chronoconv.hpp>
+#include <type_traits>
+
+/**
+ * verifies the result is the same as std::chrono::duration_cast gives
+ */
+template<typename To, typename From>
+void
+verifySameAsChrono(From from)
+{
+  int ec = 0;
+  const To to = safe_duration_cast::safe_duration_cast<To>(from, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(to == std::chrono::duration_cast<To>(from));
+}
+
+template<typename To, typename Rep>
+void
+verifyLimits()
+{
+  using L = std::numeric_limits<Rep>;
+  using From = std::chrono::duration<Rep, std::nano>;
+  for (Rep small = 0; small < 10; ++small) {
+    verifySameAsChrono<To>(From{ small });
+    verifySameAsChrono<To>(From{ static_cast<Rep>(L::max() - small) });
+    verifySameAsChrono<To>(From{ static_cast<Rep>(L::min() + small) });
+  }
+}
+
+TEST_CASE("integral to floating point is the same as std::chrono")
+{
+  using Seconds = std::chrono::duration<double>;
+  using Hours = std::chrono::duration<float, std::ratio<3600>>;
+  using Nanos = std::chrono::duration<long double, std::nano>;
+  verifyLimits<Seconds, std::int64_t>();
+  verifyLimits<Seconds, std::uint64_t>();
+  verifyLimits<Hours, std::int64_t>();
+  verifyLimits<Hours, std::int8_t>();
+  verifyLimits<Nanos, std::int64_t>();
+  verifySameAsChrono<std::chrono::duration<float, std::ratio<3, 5>>>(
+    std::chrono::duration<int, std::ratio<5, 3>>{ 12345 });
+}
+
+#if HAVE_INT128_TYPE
+// 64 bit counts always fit in a float, even as attoseconds. wider ones do not.
+// __int128 is only integral in the gnu dialects.
+template<typename Int128>
+void
+verifyWideOverflow(std::false_type /*is integral*/)
+{}
+
+template<typename Int128>
+void
+verifyWideOverflow(std::true_type /*is integral*/)
+{
+  using Milli = std::chrono::duration<float, std::milli>;
+  using Seconds = std::chrono::duration<Int128>;
+  const auto max = std::numeric_limits<Int128>::max();
+  int ec = 0;
+  safe_duration_cast::safe_duration_cast<Milli>(Seconds{ max }, ec);
+  REQUIRE(ec != 0);
+  safe_duration_cast::safe_duration_cast<Milli>(Seconds{ -max }, ec);
+  REQUIRE(ec != 0);
+  const auto fine =
+    safe_duration_cast::safe_duration_cast<Milli>(Seconds{ max / 1000 }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(fine == std::chrono::duration_cast<Milli>(Seconds{ max / 1000 }));
+
+  // the conversion to float itself overflows
+  using UInt128 = typename std::make_unsigned<Int128>::type;
+  using Unsigned = std::chrono::duration<UInt128>;
+  using Float = std::chrono::duration<float>;
+  safe_duration_cast::safe_duration_cast<Float>(
+    Unsigned{ std::numeric_limits<UInt128>::max() }, ec);
+  REQUIRE(ec != 0);
+
+  // out of range is still reported as 1 by the exact cast
+  safe_duration_cast::exact_duration_cast<Milli>(Seconds{ max }, ec);
+  REQUIRE(ec == 1);
+}
+
+TEST_CASE("integral to floating point overflow")
+{
+  verifyWideOverflow<tests::Int128_t>(std::is_integral<tests::Int128_t>{});
+}
+#endif
+
+template<typename To, typename From>
+int
+exactError(From from)
+{
+  int ec = 0;
+  const To to = safe_duration_cast::exact_duration_cast<To>(from, ec);
+  if (ec == 0) {
+    // an exact result converts back to the input
+    REQUIRE(std::chrono::duration_cast<From>(to) == from);
+  }
+  return ec;
+}
+
+TEST_CASE("exact integral to floating point")
+{
+  using Nanos = std::chrono::duration<std::int64_t, std::nano>;
+  using Seconds = std::chrono::duration<double>;
+  using Millis = std::chrono::duration<double, std::milli>;
+
+  // half a second is exact, a millisecond is not
+  REQUIRE(exactError<Seconds>(Nanos{ 500000000 }) == 0);
+  REQUIRE(exactError<Seconds>(Nanos{ 1000000 }) == 2);
+  REQUIRE(exactError<Seconds>(Nanos{ 0 }) == 0);
+
+  // integer results are exact as long as they fit in the mantissa
+  using Micros = std::chrono::duration<std::int64_t, std::micro>;
+  const std::int64_t big = std::int64_t{ 1 } << 53;
+  REQUIRE(exactError<Millis>(Micros{ big * 1000 }) == 0);
+  REQUIRE(exactError<Millis>(Micros{ -big * 1000 }) == 0);
+  REQUIRE(exactError<Millis>(Micros{ (big + 1) * 1000 }) == 2);
+
+  // the count itself is rounded
+  using Float = std::chrono::duration<float, std::nano>;
+  REQUIRE(exactError<Float>(Nanos{ (1 << 24) + 1 }) == 2);
+  REQUIRE(exactError<Float>(Nanos{ std::numeric_limits<std::int64_t>::min() }) ==
+          0);
+  REQUIRE(exactError<Float>(Nanos{ std::numeric_limits<std::int64_t>::max() }) ==
+          2);
+
+  // multiplication that does not fit in the mantissa
+  using Hours = std::chrono::duration<std::int32_t, std::ratio<3600>>;
+  using FloatSeconds = std::chrono::duration<float>;
+  REQUIRE(exactError<FloatSeconds>(Hours{ 1 }) == 0);
+  REQUIRE(exactError<FloatSeconds>(Hours{ (1 << 20) + 1 }) == 2);
+}
+
+template<typename To, typename From>
+void
+verifyFloatToIntegral(From from, bool expect_success)
+{
+  int ec = 0;
+  const To to = safe_duration_cast::safe_duration_cast<To>(from, ec);
+  if (expect_success) {
+    REQUIRE(ec == 0);
+    REQUIRE(to == std::chrono::duration_cast<To>(from));
+  } else {
+    REQUIRE(ec != 0);
+  }
+}
+
+TEST_CASE("floating point to integral is the same as std::chrono")
+{
+  using Seconds = std::chrono::duration<double>;
+  using Nanos = std::chrono::duration<std::int64_t, std::nano>;
+  verifyFloatToIntegral<Nanos>(Seconds{ 1.5 }, true);
+  verifyFloatToIntegral<Nanos>(Seconds{ -1.5 }, true);
+  verifyFloatToIntegral<Nanos>(Seconds{ 1e-10 }, true);
+  verifyFloatToIntegral<Nanos>(Seconds{ -0.0 }, true);
+  verifyFloatToIntegral<Nanos>(Seconds{ 9.2e9 }, true);
+  verifyFloatToIntegral<Nanos>(Seconds{ 9.3e9 }, false);
+  verifyFloatToIntegral<Nanos>(Seconds{ -9.2e9 }, true);
+  verifyFloatToIntegral<Nanos>(Seconds{ -9.3e9 }, false);
+  verifyFloatToIntegral<Nanos>(Seconds{ 1e300 }, false);
+
+  using Minutes = std::chrono::duration<float, std::ratio<60>>;
+  using Millis = std::chrono::duration<std::uint16_t, std::milli>;
+  verifyFloatToIntegral<Millis>(Minutes{ 1.0f }, true);
+  verifyFloatToIntegral<Millis>(Minutes{ 1.1f }, false);
+  verifyFloatToIntegral<Millis>(Minutes{ -0.00001f }, true);
+  verifyFloatToIntegral<Millis>(Minutes{ -0.0001f }, false);
+}
+
+template<typename Int, typename Float>
+void
+verifyTruncationLimits()
+{
+  using L = std::numeric_limits<Int>;
+  using From = std::chrono::duration<Float>;
+  using To = std::chrono::duration<Int>;
+  // the largest float below max()+1 converts, max()+1 does not
+  const Float hi = static_cast<Float>(L::max() / 2 + 1) * 2;
+  const Float below_hi = std::nextafter(hi, static_cast<Float>(0));
+  verifyFloatToIntegral<To>(From{ below_hi }, true);
+  verifyFloatToIntegral<To>(From{ hi }, false);
+
+  // min() converts, and so does anything that truncates to min()
+  const Float lo = static_cast<Float>(L::min());
+  verifyFloatToIntegral<To>(From{ lo }, true);
+  const Float below_lo =
+    std::nextafter(lo, -std::numeric_limits<Float>::infinity());
+  const bool truncates_to_min = below_lo > static_cast<Float>(L::min()) - 1;
+  verifyFloatToIntegral<To>(From{ below_lo }, truncates_to_min);
+}
+
+TEST_CASE("floating point to integral at the limits")
+{
+  verifyTruncationLimits<std::int8_t, float>();
+  verifyTruncationLimits<std::uint8_t, float>();
+  verifyTruncationLimits<std::int32_t, float>();
+  verifyTruncationLimits<std::int32_t, double>();
+  verifyTruncationLimits<std::uint32_t, double>();
+  verifyTruncationLimits<std::int64_t, float>();
+  verifyTruncationLimits<std::int64_t, double>();
+  verifyTruncationLimits<std::uint64_t, double>();
+  verifyTruncationLimits<std::int64_t, long double>();
+  verifyTruncationLimits<std::uint64_t, long double>();
+}
+
+TEST_CASE("floating point to integral without floating point exceptions")
+{
+  using Seconds = std::chrono::duration<double>;
+  using Millis = std::chrono::duration<std::int64_t, std::milli>;
+  using L = std::numeric_limits<double>;
+  for (double bad : { L::quiet_NaN(), -L::quiet_NaN(), L::infinity(),
+                      -L::infinity(), L::max(), L::lowest(), 1e300 }) {
+    std::feclearexcept(FE_ALL_EXCEPT);
+    int ec = 0;
+    safe_duration_cast::safe_duration_cast<Millis>(Seconds{ bad }, ec);
+    REQUIRE(ec != 0);
+    REQUIRE(std::fetestexcept(FE_INVALID) == 0);
+  }
+}
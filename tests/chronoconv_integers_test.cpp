@@ -8,6 +8,9 @@
 #include <catch.hpp>
 
 #include "testsupport.hpp"
+#include <cstdint>
+#include <limits>
+#include <ratio>
 #include <safe_duration_cast/chronoconv.hpp>
 #include <type_traits>
 
@@ -89,3 +92,110 @@ TEST_CASE("expected to underflow, long")
   using Milli = std::chrono::duration<long, std::milli>;
   verify_expected_error(Milli{ std::numeric_limits<long>::min() }, Micro{});
 }
+
+/**
+ * converts from to To and verifies the result against a calculation done in
+ * 128 bits: it should succeed exactly when the correct result fits in To.
+ */
+template<typename To, typename From>
+void
+verify_against_wide(From from)
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using ToRep = typename To::rep;
+  const tests::Int128_t expected =
+    tests::Int128_t{ from.count() } * Factor::num / Factor::den;
+  const bool fits =
+    expected >= tests::Int128_t{ std::numeric_limits<ToRep>::min() } &&
+    expected <= tests::Int128_t{ std::numeric_limits<ToRep>::max() };
+
+  int err = 0;
+  const auto to = safe_duration_cast::safe_duration_cast<To>(from, err);
+  REQUIRE((err == 0) == fits);
+  if (fits) {
+    REQUIRE(tests::Int128_t{ to.count() } == expected);
+  }
+}
+
+/**
+ * verifies the values around value, but only those From can hold.
+ */
+template<typename To, typename From>
+void
+verify_around(tests::Int128_t value)
+{
+  using FromRep = typename From::rep;
+  for (int i = -3; i <= 3; ++i) {
+    const tests::Int128_t v = value + i;
+    if (v >= tests::Int128_t{ std::numeric_limits<FromRep>::min() } &&
+        v <= tests::Int128_t{ std::numeric_limits<FromRep>::max() }) {
+      verify_against_wide<To>(From{ static_cast<FromRep>(v) });
+    }
+  }
+}
+
+template<typename To, typename From>
+void
+verify_full_range()
+{
+  using FromRep = typename From::rep;
+  using ToRep = typename To::rep;
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  const tests::Int128_t fromlimits[] = { std::numeric_limits<FromRep>::min(),
+                                         std::numeric_limits<FromRep>::max(),
+                                         0 };
+  for (auto value : fromlimits) {
+    verify_around<To, From>(value);
+  }
+  // the inputs where count*num starts to overflow
+  const tests::Int128_t intmaxlimits[] = { INTMAX_MIN, INTMAX_MAX, UINTMAX_MAX };
+  for (auto value : intmaxlimits) {
+    verify_around<To, From>(value / Factor::num);
+  }
+  // the inputs where the result starts to overflow
+  const tests::Int128_t tolimits[] = { std::numeric_limits<ToRep>::min(),
+                                       std::numeric_limits<ToRep>::max() };
+  for (auto value : tolimits) {
+    verify_around<To, From>(value * Factor::den / Factor::num);
+  }
+}
+
+TEST_CASE("no false overflow errors for non unit ratios")
+{
+  using U = std::uint64_t;
+  using S = std::int64_t;
+  verify_full_range<std::chrono::duration<U, std::ratio<3, 5>>,
+                    std::chrono::duration<U>>();
+  verify_full_range<std::chrono::duration<S, std::ratio<3, 5>>,
+                    std::chrono::duration<S>>();
+  verify_full_range<std::chrono::duration<S, std::ratio<3, 5>>,
+                    std::chrono::duration<U>>();
+  verify_full_range<std::chrono::duration<U, std::ratio<3, 5>>,
+                    std::chrono::duration<S>>();
+  verify_full_range<std::chrono::duration<int, std::ratio<7, 1000>>,
+                    std::chrono::duration<S, std::ratio<1, 3>>>();
+}
+
+TEST_CASE("uint64 seconds to 3/5 works far beyond max/5")
+{
+  using From = std::chrono::duration<std::uint64_t>;
+  using To = std::chrono::duration<std::uint64_t, std::ratio<3, 5>>;
+  const std::uint64_t large = std::numeric_limits<std::uint64_t>::max() / 2;
+  verify_against_wide<To>(From{ large });
+  int err = 0;
+  safe_duration_cast::safe_duration_cast<To>(From{ large }, err);
+  REQUIRE(err == 0);
+}
+
+TEST_CASE("ratios too large to split")
+{
+  // num and den are both close to 2^62, so the remainder times num would
+  // overflow.
+  using From =
+    std::chrono::duration<std::int64_t, std::ratio<4611686018427387903>>;
+  using To =
+    std::chrono::duration<std::int64_t, std::ratio<4611686018427387901>>;
+  verify_full_range<To, From>();
+  verify_around<To, From>(3);
+  verify_around<To, From>(-3);
+}
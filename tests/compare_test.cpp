@@ -0,0 +1,151 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <ratio>
+#include <safe_duration_cast/compare.hpp>
+#include <vector>
+
+using safe_duration_cast::safe_compare;
+
+namespace {
+using Nanos = std::chrono::duration<std::int64_t, std::nano>;
+using Hours = std::chrono::duration<std::int64_t, std::ratio<3600>>;
+using Odd = std::chrono::duration<std::uint64_t, std::ratio<7, 3>>;
+
+// compares small durations through the common type, which can not
+// overflow for them
+template<typename D1, typename D2>
+int
+reference(D1 a, D2 b)
+{
+  using Period = typename std::common_type<D1, D2>::type::period;
+  using Wide = std::chrono::duration<std::int64_t, Period>;
+  const Wide x{ std::chrono::duration_cast<Wide>(a) };
+  const Wide y{ std::chrono::duration_cast<Wide>(b) };
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+} // namespace
+
+TEST_CASE("safe_compare where the common type overflows")
+{
+  // std::chrono converts the hours to nanoseconds, which overflows
+  REQUIRE(safe_compare(Nanos::max(), Hours{ 3000000 }) < 0);
+  REQUIRE(safe_compare(Hours{ 3000000 }, Nanos::max()) > 0);
+  REQUIRE(safe_compare(Nanos::min(), Hours{ -3000000 }) > 0);
+  REQUIRE(safe_compare(Hours::max(), Hours::max()) == 0);
+  REQUIRE(safe_compare(Nanos{ 3600000000000 }, Hours{ 1 }) == 0);
+  REQUIRE(safe_compare(Nanos{ 3600000000001 }, Hours{ 1 }) > 0);
+  REQUIRE(safe_compare(Nanos{ -3600000000001 }, Hours{ -1 }) < 0);
+  REQUIRE(safe_duration_cast::safe_equal(Hours{ -2 }, Nanos{ -7200000000000 }));
+  REQUIRE(safe_duration_cast::safe_less(Hours::min(), Nanos::min()));
+
+  // mixed signedness
+  REQUIRE(safe_compare(Odd::max(), Hours::max()) < 0);
+  REQUIRE(safe_compare(Odd::max(), Hours{ 10000000000000000 }) > 0);
+  REQUIRE(safe_compare(Odd{ 0 }, Hours{ -1 }) > 0);
+  REQUIRE(safe_compare(Hours::min(), Odd{ 0 }) < 0);
+  REQUIRE(safe_compare(Odd{ 10800 }, Hours{ 7 }) == 0);
+  REQUIRE(safe_compare(Odd{ 10801 }, Hours{ 7 }) > 0);
+}
+
+TEST_CASE("safe_compare agrees with std::chrono when it does not overflow")
+{
+  using A = std::chrono::duration<std::int16_t, std::ratio<7, 1000>>;
+  using B = std::chrono::duration<std::int16_t, std::ratio<3, 100>>;
+  using C = std::chrono::duration<std::uint8_t, std::ratio<11>>;
+  for (int i = -32768; i <= 32767; i += 13) {
+    for (int j = -32768; j <= 32767; j += 127) {
+      const A a{ static_cast<std::int16_t>(i) };
+      const B b{ static_cast<std::int16_t>(j) };
+      REQUIRE(safe_compare(a, b) == reference(a, b));
+    }
+    for (int j = 0; j < 256; ++j) {
+      const A a{ static_cast<std::int16_t>(i) };
+      const C c{ static_cast<std::uint8_t>(j) };
+      REQUIRE(safe_compare(a, c) == reference(a, c));
+      REQUIRE(safe_compare(c, a) == -reference(a, c));
+    }
+  }
+}
+
+TEST_CASE("comparing fractions")
+{
+  using safe_duration_cast::detail::compare_fractions;
+  std::mt19937_64 rng(12345);
+  for (int i = 0; i < 100000; ++i) {
+    // small enough to cross multiply
+    const std::uint64_t a = rng() >> 34;
+    const std::uint64_t b = (rng() >> 34) + 1;
+    const std::uint64_t c = i % 3 ? rng() >> 34 : a * 2;
+    const std::uint64_t d = i % 3 ? (rng() >> 34) + 1 : b * 2;
+    const std::uint64_t lhs = a * d;
+    const std::uint64_t rhs = c * b;
+    const int expected = lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+    REQUIRE(compare_fractions(a, b, c, d) == expected);
+  }
+  // large values, which are off by one
+  const std::uint64_t big = std::numeric_limits<std::uint64_t>::max();
+  REQUIRE(compare_fractions(big, big - 1, big - 1, big - 2) < 0);
+  REQUIRE(compare_fractions(big - 1, big, big - 2, big - 1) > 0);
+}
+
+TEST_CASE("safe_lower_bound")
+{
+  std::mt19937_64 rng(4711);
+  std::vector<Nanos> sorted;
+  for (int i = 0; i < 1000; ++i) {
+    sorted.push_back(Nanos{ static_cast<std::int64_t>(rng() >> 20) -
+                            (std::int64_t{ 1 } << 43) });
+  }
+  sorted.push_back(Nanos::max());
+  sorted.push_back(Nanos::min());
+  std::sort(sorted.begin(), sorted.end());
+  const Nanos* first = sorted.data();
+  const Nanos* last = first + sorted.size();
+
+  using Micros = std::chrono::duration<std::int32_t, std::micro>;
+  for (int i = 0; i < 1000; ++i) {
+    const Micros key{ static_cast<std::int32_t>(rng()) };
+    const auto expected =
+      std::lower_bound(first, last, key, [](Nanos e, Micros k) {
+        return e < std::chrono::duration_cast<Nanos>(k);
+      });
+    REQUIRE(safe_duration_cast::safe_lower_bound(first, last, key) == expected);
+  }
+
+  // keys outside of the range of the elements
+  REQUIRE(safe_duration_cast::safe_lower_bound(first, last, Hours::max()) ==
+          last);
+  REQUIRE(safe_duration_cast::safe_lower_bound(first, last, Hours::min()) ==
+          first);
+  REQUIRE(safe_duration_cast::safe_lower_bound(first, first, Hours{ 1 }) ==
+          first);
+  // the key is between two representable element values
+  const std::vector<Hours> hours{ Hours{ -2 }, Hours{ 0 }, Hours{ 2 } };
+  REQUIRE(safe_duration_cast::safe_lower_bound(
+            hours.data(), hours.data() + 3, Nanos{ 1 }) == hours.data() + 2);
+  REQUIRE(safe_duration_cast::safe_lower_bound(
+            hours.data(), hours.data() + 3, Nanos{ -1 }) == hours.data() + 1);
+}
+
+#if SDC_HAVE_THREE_WAY_COMPARISON
+TEST_CASE("safe_three_way_compare")
+{
+  using safe_duration_cast::safe_three_way_compare;
+  const auto less = safe_three_way_compare(Nanos::max(), Hours::max());
+  REQUIRE(less == std::strong_ordering::less);
+  const auto same = safe_three_way_compare(Hours{ 1 }, Nanos{ 3600000000000 });
+  REQUIRE(same == std::strong_ordering::equal);
+}
+#endif
@@ -0,0 +1,111 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/deadline.hpp>
+
+using safe_duration_cast::safe_deadline;
+
+TEST_CASE("deadlines with integral timeouts")
+{
+  using namespace std::chrono;
+  using TP = steady_clock::time_point;
+  const TP now{ hours{ 1000 } };
+  REQUIRE(safe_deadline(now, seconds{ 3 }) == now + seconds{ 3 });
+  REQUIRE(safe_deadline(now, milliseconds{ -3 }) == now - milliseconds{ 3 });
+  REQUIRE(safe_deadline(now, seconds::zero()) == now);
+
+  // the classic now + max() bug
+  REQUIRE(safe_deadline(now, steady_clock::duration::max()) == TP::max());
+  REQUIRE(safe_deadline(now, hours::max()) == TP::max());
+  REQUIRE(safe_deadline(now, seconds{ 1LL << 40 }) == TP::max());
+  REQUIRE(safe_deadline(TP{ -hours{ 1000 } }, hours::min()) == TP::min());
+  REQUIRE(safe_deadline(TP::max(), nanoseconds{ 1 }) == TP::max());
+  REQUIRE(safe_deadline(TP::max(), nanoseconds{ -1 }) ==
+          TP::max() - nanoseconds{ 1 });
+  REQUIRE(safe_deadline(TP::min(), nanoseconds{ -1 }) == TP::min());
+
+  // truncated towards zero, like duration_cast
+  using SecondsTP = time_point<steady_clock, seconds>;
+  REQUIRE(safe_deadline(SecondsTP{}, milliseconds{ 1999 }) ==
+          SecondsTP{ seconds{ 1 } });
+
+  // a clock which can not go before its epoch
+  using Unsigned = duration<std::uint32_t, std::milli>;
+  using UnsignedTP = time_point<steady_clock, Unsigned>;
+  REQUIRE(safe_deadline(UnsignedTP{ Unsigned{ 10 } }, seconds{ 5 }) ==
+          UnsignedTP{ Unsigned{ 5010 } });
+  REQUIRE(safe_deadline(UnsignedTP{ Unsigned{ 10 } }, hours{ 2000 }) ==
+          UnsignedTP::max());
+  REQUIRE(safe_deadline(UnsignedTP{ Unsigned{ 10 } }, milliseconds{ -11 }) ==
+          UnsignedTP::min());
+  REQUIRE(safe_deadline(UnsignedTP{ Unsigned{ 10 } }, milliseconds{ -10 }) ==
+          UnsignedTP{});
+  REQUIRE(safe_deadline(UnsignedTP{ Unsigned{ 5010 } }, seconds{ -5 }) ==
+          UnsignedTP{ Unsigned{ 10 } });
+  REQUIRE(safe_deadline(UnsignedTP{ Unsigned{ 5010 } }, minutes::min()) ==
+          UnsignedTP::min());
+  REQUIRE(safe_deadline(UnsignedTP::max(), milliseconds{ -1 }) ==
+          UnsignedTP{ Unsigned{ Unsigned::max().count() - 1 } });
+
+  // a negative timeout which does not fit in the unsigned clock as is
+  using Unsigned64 = duration<std::uint64_t, std::milli>;
+  using Unsigned64TP = time_point<steady_clock, Unsigned64>;
+  const Unsigned64TP now64{ Unsigned64{ 100000 } };
+  REQUIRE(safe_deadline(now64, seconds{ -5 }) ==
+          Unsigned64TP{ Unsigned64{ 95000 } });
+  REQUIRE(safe_deadline(now64, duration<double>{ -5.5 }) ==
+          Unsigned64TP{ Unsigned64{ 94500 } });
+  REQUIRE(safe_deadline(now64, duration<double>{ -1e300 }) ==
+          Unsigned64TP::min());
+  REQUIRE(safe_deadline(now64, duration<double>{ -0.0 }) == now64);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  REQUIRE(safe_deadline(now64, duration<double>{ nan }) == now64);
+  REQUIRE(safe_deadline(Unsigned64TP::max(), seconds::min()) ==
+          Unsigned64TP::min());
+}
+
+TEST_CASE("deadlines with floating point timeouts")
+{
+  using namespace std::chrono;
+  using TP = steady_clock::time_point;
+  using L = std::numeric_limits<double>;
+  using DoubleSeconds = duration<double>;
+  const TP now{ hours{ 1000 } };
+  REQUIRE(safe_deadline(now, DoubleSeconds{ 1.5 }) ==
+          now + milliseconds{ 1500 });
+  REQUIRE(safe_deadline(now, DoubleSeconds{ 1e300 }) == TP::max());
+  REQUIRE(safe_deadline(now, DoubleSeconds{ L::infinity() }) == TP::max());
+  REQUIRE(safe_deadline(now, DoubleSeconds{ -L::infinity() }) == TP::min());
+  REQUIRE(safe_deadline(now, DoubleSeconds{ L::quiet_NaN() }) == now);
+  // just below the limit of int64 nanoseconds
+  REQUIRE(safe_deadline(TP{}, DoubleSeconds{ 9.2e9 }) ==
+          TP{ seconds{ 9200000000LL } });
+
+  // a clock with a floating point representation
+  using FloatTP = time_point<steady_clock, duration<double>>;
+  REQUIRE(safe_deadline(FloatTP{ DoubleSeconds{ 1.0 } }, milliseconds{ 500 }) ==
+          FloatTP{ DoubleSeconds{ 1.5 } });
+  REQUIRE(safe_deadline(FloatTP{ DoubleSeconds{ L::max() } },
+                        DoubleSeconds{ L::max() }) == FloatTP::max());
+}
+
+TEST_CASE("deadlines from the clock")
+{
+  using namespace std::chrono;
+  const auto before = steady_clock::now();
+  const auto deadline = safe_deadline<steady_clock>(seconds{ 10 });
+  REQUIRE(deadline >= before + seconds{ 10 });
+  REQUIRE(safe_deadline<steady_clock>(hours::max()) ==
+          steady_clock::time_point::max());
+  REQUIRE(safe_deadline<system_clock>(duration<double>{ 1e300 }) ==
+          system_clock::time_point::max());
+}
@@ -0,0 +1,96 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <safe_duration_cast/error_policy.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+using Seconds = std::chrono::duration<std::int64_t>;
+using Millis = std::chrono::duration<std::int32_t, std::milli>;
+const Seconds good{ 3 };
+const Seconds bad{ std::int64_t{ 1 } << 40 };
+} // namespace
+
+namespace ep = safe_duration_cast::error_policy;
+
+// converts from seconds to milliseconds with an error policy object
+template<typename Policy>
+Millis
+convert(Seconds from, Policy&& policy)
+{
+  return safe_duration_cast::safe_duration_cast<Millis>(
+    from, std::forward<Policy>(policy));
+}
+
+// converts from seconds to milliseconds with an error policy type
+template<typename Policy>
+Millis
+convert(Seconds from)
+{
+  return safe_duration_cast::safe_duration_cast<Millis, Policy>(from);
+}
+
+TEST_CASE("error code policy")
+{
+  int ec = 17;
+  REQUIRE(convert(good, ep::error_code(ec)).count() == 3000);
+  REQUIRE(ec == 0);
+  REQUIRE(convert(bad, ep::error_code(ec)).count() == 0);
+  REQUIRE(ec != 0);
+}
+
+TEST_CASE("throwing policy")
+{
+  REQUIRE(convert<ep::throw_exception>(good).count() == 3000);
+  REQUIRE_THROWS_AS(convert<ep::throw_exception>(bad), std::runtime_error);
+}
+
+TEST_CASE("saturating policy")
+{
+  REQUIRE(convert<ep::saturate>(bad) == Millis::max());
+  REQUIRE(convert<ep::saturate>(-bad) == Millis::min());
+  REQUIRE(convert(good, ep::saturate{}).count() == 3000);
+}
+
+TEST_CASE("callback policy")
+{
+  int calls = 0;
+  auto policy = ep::make_callback([&calls](int ec) {
+    REQUIRE(ec != 0);
+    ++calls;
+  });
+  REQUIRE(convert(good, policy).count() == 3000);
+  REQUIRE(calls == 0);
+  REQUIRE(convert(bad, policy).count() == 0);
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("sticky policy")
+{
+  int errors = 0;
+  ep::sticky policy(errors);
+  convert(good, policy);
+  REQUIRE(errors == 0);
+  convert(bad, policy);
+  convert(good, policy);
+  REQUIRE(errors != 0);
+}
+
+TEST_CASE("the old overloads still work")
+{
+  int ec = 0;
+  REQUIRE(safe_duration_cast::safe_duration_cast<Millis>(good, ec).count() ==
+          3000);
+  REQUIRE(safe_duration_cast::safe_duration_cast<Millis>(good).count() == 3000);
+  static_assert(!safe_duration_cast::is_error_policy<int&>::value, "");
+  static_assert(safe_duration_cast::is_error_policy<ep::sticky&>::value, "");
+}
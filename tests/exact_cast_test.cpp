@@ -0,0 +1,259 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/chronoconv.hpp>
+#include <safe_duration_cast/detail/divisibility.hpp>
+#include <type_traits>
+#include <vector>
+
+#include "testsupport.hpp"
+
+namespace {
+// the shared counts, and multiples of common denominators
+template<typename Rep>
+std::vector<Rep>
+counts()
+{
+  return tests::counts<Rep>([](Rep x, std::vector<Rep>& ret) {
+    ret.push_back(static_cast<Rep>(x / 1000 * 1000));
+    ret.push_back(static_cast<Rep>(x / 60 * 60));
+  });
+}
+
+template<std::intmax_t Den, typename Int>
+void
+verifyDivisibility(Int x)
+{
+  using Wide = typename std::common_type<Int, std::intmax_t>::type;
+  const bool expected = static_cast<Wide>(x) % static_cast<Wide>(Den) == 0;
+  REQUIRE(safe_duration_cast::detail::is_divisible<Den>(x) == expected);
+}
+
+// exact_duration_cast between integral types, against the truncating cast
+// and the remainder
+template<typename To, typename From>
+void
+verifyIntegral()
+{
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using Rep = typename From::rep;
+  using Wide = typename std::common_type<Rep, std::intmax_t>::type;
+  std::vector<From> in;
+  for (auto c : counts<Rep>()) {
+    in.push_back(From{ c });
+  }
+  std::vector<To> out(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  std::vector<std::uint64_t> inexactmask(failmask.size());
+  const auto summary = safe_duration_cast::exact_duration_cast_n(
+    in.data(), out.data(), in.size(), failmask.data(), inexactmask.data());
+
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int truncating_ec = 0;
+    const To truncated =
+      safe_duration_cast::safe_duration_cast<To>(in[i], truncating_ec);
+    const bool divisible =
+      static_cast<Wide>(in[i].count()) % static_cast<Wide>(Factor::den) == 0;
+    const int expected_ec = truncating_ec ? truncating_ec : divisible ? 0 : 2;
+
+    int ec = 0;
+    const To to = safe_duration_cast::exact_duration_cast<To>(in[i], ec);
+    REQUIRE(ec == expected_ec);
+    REQUIRE(to == (ec ? To{} : truncated));
+
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    const bool inexact = (inexactmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == (expected_ec != 0));
+    REQUIRE(inexact == (expected_ec == 2));
+    REQUIRE(out[i] == to);
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+
+  // in place, if the representation is the same
+  const auto inplace = tests::convertInPlace<To>(
+    in, [](const From* first, To* result, std::size_t n) {
+      safe_duration_cast::exact_duration_cast_n(first, result, n);
+    });
+  if (!inplace.empty()) {
+    REQUIRE(inplace == out);
+  }
+}
+
+template<typename To, typename From>
+int
+exactError(From from)
+{
+  int ec = 0;
+  const To to = safe_duration_cast::exact_duration_cast<To>(from, ec);
+  if (ec == 0) {
+    // an exact result converts back to the input
+    REQUIRE(std::chrono::duration_cast<From>(to) == from);
+  } else {
+    REQUIRE(to.count() == 0);
+  }
+  return ec;
+}
+} // namespace
+
+TEST_CASE("divisibility test with the multiplicative inverse")
+{
+  for (auto x : counts<std::int64_t>()) {
+    verifyDivisibility<1>(x);
+    verifyDivisibility<3>(x);
+    verifyDivisibility<60>(x);
+    verifyDivisibility<1000>(x);
+    verifyDivisibility<1000000000>(x);
+    verifyDivisibility<std::numeric_limits<std::int64_t>::max()>(x);
+    verifyDivisibility<std::int64_t{ 1 } << 62>(x);
+  }
+  for (auto x : counts<std::uint64_t>()) {
+    verifyDivisibility<7>(x);
+    verifyDivisibility<86400>(x);
+  }
+  for (auto x : counts<std::int8_t>()) {
+    verifyDivisibility<3>(x);
+    verifyDivisibility<1000>(x);
+  }
+}
+
+TEST_CASE("exact integral conversions")
+{
+  using namespace std::chrono;
+  using Millis32 = duration<std::int32_t, std::milli>;
+  using UnsignedMillis = duration<std::uint64_t, std::milli>;
+  using Thirds = duration<std::int64_t, std::ratio<1, 3>>;
+  using Minutes8 = duration<std::int8_t, std::ratio<60>>;
+
+  int ec = 0;
+  safe_duration_cast::exact_duration_cast<milliseconds>(microseconds{ 1500 },
+                                                        ec);
+  REQUIRE(ec == 2);
+  REQUIRE(safe_duration_cast::exact_duration_cast<milliseconds>(
+            microseconds{ -2000 }, ec) == milliseconds{ -2 });
+  REQUIRE(ec == 0);
+  safe_duration_cast::exact_duration_cast<Millis32>(hours{ 1000 }, ec);
+  REQUIRE(ec == 1);
+
+  verifyIntegral<milliseconds, microseconds>();
+  verifyIntegral<seconds, nanoseconds>();
+  verifyIntegral<minutes, seconds>();
+  verifyIntegral<Millis32, nanoseconds>();
+  verifyIntegral<UnsignedMillis, microseconds>();
+  verifyIntegral<seconds, Thirds>();
+  verifyIntegral<Thirds, milliseconds>();
+  verifyIntegral<nanoseconds, seconds>();
+  verifyIntegral<Minutes8, duration<std::int8_t>>();
+  verifyIntegral<milliseconds, milliseconds>();
+  verifyIntegral<seconds, seconds>();
+}
+
+TEST_CASE("exact floating point to integral conversions")
+{
+  using FloatMillis = std::chrono::duration<double, std::milli>;
+  using FloatSeconds = std::chrono::duration<double>;
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  using std::chrono::seconds;
+
+  REQUIRE(exactError<milliseconds>(FloatSeconds{ 1.5 }) == 0);
+  REQUIRE(exactError<milliseconds>(FloatSeconds{ -0.25 }) == 0);
+  REQUIRE(exactError<seconds>(FloatMillis{ 1500 }) == 2);
+  REQUIRE(exactError<microseconds>(FloatMillis{ 0.1 }) == 2);
+  REQUIRE(exactError<seconds>(FloatSeconds{ 1e300 }) == 1);
+  REQUIRE(exactError<seconds>(FloatSeconds{
+            std::numeric_limits<double>::denorm_min() }) == 2);
+  int ec = 0;
+  safe_duration_cast::exact_duration_cast<seconds>(
+    FloatSeconds{ std::numeric_limits<double>::quiet_NaN() }, ec);
+  REQUIRE(ec == 1);
+
+  // count/4000 is integral if and only if 4000 divides count
+  for (int i = -20000; i <= 20000; i += 7) {
+    REQUIRE(exactError<seconds>(FloatMillis{ i / 4.0 }) ==
+            (i % 4000 == 0 ? 0 : 2));
+  }
+}
+
+TEST_CASE("exact floating point conversions")
+{
+  using FloatMillis = std::chrono::duration<double, std::milli>;
+  using FloatSeconds = std::chrono::duration<double>;
+  using Float32Seconds = std::chrono::duration<float>;
+  using L = std::numeric_limits<double>;
+
+  REQUIRE(exactError<FloatMillis>(FloatSeconds{ 1.5 }) == 0);
+  REQUIRE(exactError<FloatMillis>(FloatSeconds{ 0.1 }) == 2);
+  REQUIRE(exactError<FloatSeconds>(FloatMillis{ 500 }) == 0);
+  REQUIRE(exactError<FloatSeconds>(FloatMillis{ 1 }) == 2);
+  REQUIRE(exactError<FloatSeconds>(FloatMillis{ 0 }) == 0);
+  REQUIRE(exactError<Float32Seconds>(FloatMillis{ 1500 }) == 0);
+  // the result is exact in double, but rounded in float
+  REQUIRE(exactError<Float32Seconds>(FloatSeconds{ 1 + L::epsilon() }) == 2);
+  REQUIRE(exactError<FloatMillis>(Float32Seconds{ 0.5f }) == 0);
+  // close to the subnormal range, exactness is not checked
+  REQUIRE(exactError<FloatMillis>(FloatSeconds{ L::min() }) == 2);
+  REQUIRE(exactError<FloatMillis>(FloatSeconds{ L::denorm_min() }) == 2);
+  REQUIRE(exactError<FloatMillis>(FloatSeconds{ 1e307 }) == 1);
+
+  // NaN and infinity pass through
+  int ec = 0;
+  const auto nan = safe_duration_cast::exact_duration_cast<FloatMillis>(
+    FloatSeconds{ L::quiet_NaN() }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(std::isnan(nan.count()));
+  const auto inf = safe_duration_cast::exact_duration_cast<FloatMillis>(
+    FloatSeconds{ -L::infinity() }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(inf.count() == -L::infinity());
+}
+
+TEST_CASE("exact_duration_cast_n of floating point")
+{
+  using FloatMillis = std::chrono::duration<double, std::milli>;
+  using FloatSeconds = std::chrono::duration<double>;
+  std::vector<FloatMillis> in;
+  for (int i = -500; i < 500; ++i) {
+    in.push_back(FloatMillis{ i * 0.5 });
+  }
+  in.push_back(FloatMillis{ 1e308 });
+  std::vector<std::chrono::seconds> out(in.size());
+  std::vector<FloatSeconds> float_out(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  std::vector<std::uint64_t> inexactmask(failmask.size());
+  std::vector<std::uint64_t> float_inexactmask(failmask.size());
+  safe_duration_cast::exact_duration_cast_n(
+    in.data(), out.data(), in.size(), failmask.data(), inexactmask.data());
+  safe_duration_cast::exact_duration_cast_n(in.data(),
+                                            float_out.data(),
+                                            in.size(),
+                                            nullptr,
+                                            float_inexactmask.data());
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int ec = 0;
+    const auto expected =
+      safe_duration_cast::exact_duration_cast<std::chrono::seconds>(in[i], ec);
+    REQUIRE(out[i] == expected);
+    REQUIRE(((failmask[i / 64] >> (i % 64)) & 1U) == (ec != 0));
+    REQUIRE(((inexactmask[i / 64] >> (i % 64)) & 1U) == (ec == 2));
+    const auto float_expected =
+      safe_duration_cast::exact_duration_cast<FloatSeconds>(in[i], ec);
+    REQUIRE(float_out[i] == float_expected);
+    REQUIRE(((float_inexactmask[i / 64] >> (i % 64)) & 1U) == (ec == 2));
+  }
+}
@@ -0,0 +1,197 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <safe_duration_cast/format.hpp>
+#include <safe_duration_cast/parse.hpp>
+#include <string>
+#include <system_error>
+
+namespace {
+using picoseconds = std::chrono::duration<std::int64_t, std::pico>;
+
+template<typename Dur>
+std::string
+format(Dur d)
+{
+  char buf[64];
+  const auto r = safe_duration_cast::to_chars(buf, buf + sizeof(buf), d);
+  REQUIRE(r.ec == std::errc{});
+  return std::string(buf, r.ptr);
+}
+
+template<typename Dur>
+std::string
+humanized(Dur d)
+{
+  char buf[80];
+  const auto r =
+    safe_duration_cast::to_chars_humanized(buf, buf + sizeof(buf), d);
+  REQUIRE(r.ec == std::errc{});
+  return std::string(buf, r.ptr);
+}
+
+template<typename Dur>
+std::string
+inSeconds(Dur d, int precision)
+{
+  char buf[128];
+  const auto r =
+    safe_duration_cast::to_chars_seconds(buf, buf + sizeof(buf), d, precision);
+  REQUIRE(r.ec == std::errc{});
+  return std::string(buf, r.ptr);
+}
+
+// every shorter buffer gives value_too_large
+template<typename Fn>
+void
+verifyTooSmall(Fn fn, std::size_t needed)
+{
+  char buf[128];
+  for (std::size_t n = 0; n < needed; ++n) {
+    const auto r = fn(buf, buf + n);
+    REQUIRE(r.ec == std::errc::value_too_large);
+    REQUIRE(r.ptr == buf + n);
+  }
+  const auto r = fn(buf, buf + needed);
+  REQUIRE(r.ec == std::errc{});
+  REQUIRE(r.ptr == buf + needed);
+}
+} // namespace
+
+TEST_CASE("format count and unit")
+{
+  using namespace std::chrono;
+  using L = std::numeric_limits<std::int64_t>;
+  REQUIRE(format(milliseconds{ 150 }) == "150ms");
+  REQUIRE(format(nanoseconds{ -7 }) == "-7ns");
+  REQUIRE(format(microseconds{ 0 }) == "0us");
+  REQUIRE(format(seconds{ 12 }) == "12s");
+  REQUIRE(format(minutes{ 3 }) == "3m");
+  REQUIRE(format(hours{ 100 }) == "100h");
+  REQUIRE(format(nanoseconds{ L::max() }) == "9223372036854775807ns");
+  REQUIRE(format(nanoseconds{ L::min() }) == "-9223372036854775808ns");
+  REQUIRE(format(duration<std::uint64_t>{
+            std::numeric_limits<std::uint64_t>::max() }) ==
+          "18446744073709551615s");
+  REQUIRE(format(duration<std::int8_t>{ -128 }) == "-128s");
+  REQUIRE(format(picoseconds{ 5 }) == "5[1/1000000000000]s");
+  REQUIRE(format(duration<int, std::ratio<86400>>{ 2 }) == "2[86400]s");
+  REQUIRE(format(duration<int, std::ratio<3, 2>>{ 2 }) == "2[3/2]s");
+
+  verifyTooSmall(
+    [](char* first, char* last) {
+      return safe_duration_cast::to_chars(first, last, milliseconds{ -150 });
+    },
+    6);
+
+  // what is written is parsed back
+  std::mt19937_64 rng(2019);
+  for (int i = 0; i < 10000; ++i) {
+    const nanoseconds ns{ static_cast<std::int64_t>(rng()) >>
+                          static_cast<int>(rng() % 64) };
+    int ec = 0;
+    REQUIRE(safe_duration_cast::safe_parse_duration<nanoseconds>(format(ns),
+                                                                 ec) == ns);
+    REQUIRE(ec == 0);
+    REQUIRE(format(ns) == std::to_string(ns.count()) + "ns");
+  }
+}
+
+TEST_CASE("format humanized")
+{
+  using namespace std::chrono;
+  using L = std::numeric_limits<std::int64_t>;
+  REQUIRE(humanized(hours{ 1 } + minutes{ 2 } + seconds{ 3 } +
+                    milliseconds{ 4 }) == "1h02m03.004s");
+  REQUIRE(humanized(minutes{ 2 } + milliseconds{ 3500 }) == "2m03.5s");
+  REQUIRE(humanized(milliseconds{ 3004 }) == "3.004s");
+  REQUIRE(humanized(milliseconds{ -3004 }) == "-3.004s");
+  REQUIRE(humanized(seconds{ 0 }) == "0s");
+  REQUIRE(humanized(nanoseconds{ 0 }) == "0s");
+  REQUIRE(humanized(hours{ 5 }) == "5h00m00s");
+  REQUIRE(humanized(minutes{ 5 }) == "5m00s");
+  REQUIRE(humanized(seconds{ 59 }) == "59s");
+
+  // below a second, like go does it
+  REQUIRE(humanized(nanoseconds{ 1500000 }) == "1.5ms");
+  REQUIRE(humanized(nanoseconds{ 1500 }) == "1.5us");
+  REQUIRE(humanized(nanoseconds{ 15 }) == "15ns");
+  REQUIRE(humanized(nanoseconds{ -999999999 }) == "-999.999999ms");
+  REQUIRE(humanized(milliseconds{ 5 }) == "5ms");
+  REQUIRE(humanized(microseconds{ 5 }) == "5us");
+  REQUIRE(humanized(microseconds{ 5005 }) == "5.005ms");
+  REQUIRE(humanized(duration<int, std::deci>{ 5 }) == "500ms");
+  REQUIRE(humanized(picoseconds{ 1500 }) == "1.5ns");
+  REQUIRE(humanized(picoseconds{ 5 }) == "0.005ns");
+
+  REQUIRE(humanized(nanoseconds{ L::max() }) == "2562047h47m16.854775807s");
+  REQUIRE(humanized(nanoseconds{ L::min() }) == "-2562047h47m16.854775808s");
+  // the hours need more than 64 bits
+  REQUIRE(humanized(hours{ L::max() }) == "9223372036854775807h00m00s");
+  REQUIRE(humanized(duration<std::int64_t, std::ratio<86400>>{ L::min() }) ==
+          "-221360928884514619392h00m00s");
+  REQUIRE(humanized(duration<std::uint64_t, std::ratio<3600000>>{
+            std::numeric_limits<std::uint64_t>::max() }) ==
+          "18446744073709551615000h00m00s");
+  REQUIRE(humanized(duration<std::int64_t, std::ratio<7>>{ L::max() }) ==
+          "17934334516106508h30m49s");
+
+  verifyTooSmall(
+    [](char* first, char* last) {
+      return safe_duration_cast::to_chars_humanized(
+        first, last, milliseconds{ -3723004 });
+    },
+    13);
+
+  // what is written is parsed back
+  std::mt19937_64 rng(2019);
+  for (int i = 0; i < 10000; ++i) {
+    const nanoseconds ns{ static_cast<std::int64_t>(rng()) >>
+                          static_cast<int>(rng() % 64) };
+    int ec = 0;
+    REQUIRE(safe_duration_cast::safe_parse_duration<nanoseconds>(humanized(ns),
+                                                                 ec) == ns);
+    REQUIRE(ec == 0);
+  }
+}
+
+TEST_CASE("format fixed precision seconds")
+{
+  using namespace std::chrono;
+  using L = std::numeric_limits<std::int64_t>;
+  REQUIRE(inSeconds(milliseconds{ 1500 }, 3) == "1.500s");
+  REQUIRE(inSeconds(milliseconds{ -1500 }, 3) == "-1.500s");
+  REQUIRE(inSeconds(milliseconds{ 1500 }, 0) == "1s");
+  REQUIRE(inSeconds(milliseconds{ 1500 }, 1) == "1.5s");
+  REQUIRE(inSeconds(milliseconds{ 1500 }, 6) == "1.500000s");
+  REQUIRE(inSeconds(nanoseconds{ 1999999999 }, 3) == "1.999s");
+  REQUIRE(inSeconds(nanoseconds{ -1 }, 3) == "-0.000s");
+  REQUIRE(inSeconds(nanoseconds{ 1 }, 9) == "0.000000001s");
+  REQUIRE(inSeconds(seconds{ 5 }, 2) == "5.00s");
+  REQUIRE(inSeconds(seconds{ 5 }, 0) == "5s");
+  REQUIRE(inSeconds(minutes{ -2 }, 1) == "-120.0s");
+  REQUIRE(inSeconds(nanoseconds{ L::min() }, 9) == "-9223372036.854775808s");
+  REQUIRE(inSeconds(hours{ L::max() }, 0) == "33204139332677192905200s");
+  REQUIRE(inSeconds(picoseconds{ 1 }, 12) == "0.000000000001s");
+  REQUIRE(inSeconds(picoseconds{ 1 }, 20) == "0.00000000000100000000s");
+
+  char buf[8];
+  REQUIRE(safe_duration_cast::to_chars_seconds(buf, buf + 8, seconds{ 1 }, -1)
+            .ec == std::errc::invalid_argument);
+  verifyTooSmall(
+    [](char* first, char* last) {
+      return safe_duration_cast::to_chars_seconds(
+        first, last, milliseconds{ -1500 }, 4);
+    },
+    8);
+}
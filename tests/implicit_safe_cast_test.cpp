@@ -0,0 +1,80 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <safe_duration_cast/implicit_safe_cast.hpp>
+
+using safe_duration_cast::implicit_safe_cast;
+using safe_duration_cast::is_always_safe_cast;
+
+namespace {
+template<typename Rep, typename Period = std::ratio<1>>
+using D = std::chrono::duration<Rep, Period>;
+
+// verifies that an always safe conversion succeeds for every input, and
+// gives the same as safe_duration_cast
+template<typename From, typename To>
+void
+verifyAll()
+{
+  static_assert(is_always_safe_cast<From, To>::value, "");
+  using L = std::numeric_limits<typename From::rep>;
+  for (long v = L::min(); v <= static_cast<long>(L::max()); ++v) {
+    const From from{ static_cast<typename From::rep>(v) };
+    int ec = 0;
+    const To expected = safe_duration_cast::safe_duration_cast<To>(from, ec);
+    REQUIRE(ec == 0);
+    REQUIRE(implicit_safe_cast<To>(from) == expected);
+  }
+}
+} // namespace
+
+using Sec32 = D<std::int32_t>;
+using Sec64 = D<std::int64_t>;
+using Milli32 = D<std::int32_t, std::milli>;
+using Milli64 = D<std::int64_t, std::milli>;
+
+// integral to integral
+static_assert(is_always_safe_cast<Sec32, Milli64>::value, "");
+static_assert(is_always_safe_cast<Sec64, Sec64>::value, "");
+static_assert(is_always_safe_cast<D<std::uint32_t>, Sec64>::value, "");
+static_assert(!is_always_safe_cast<Sec64, Milli64>::value, "overflows");
+static_assert(!is_always_safe_cast<Milli32, Sec64>::value, "truncates");
+static_assert(!is_always_safe_cast<Sec32, D<std::uint64_t>>::value, "negative");
+
+// integral to floating point
+static_assert(is_always_safe_cast<Sec32, D<double, std::milli>>::value, "");
+static_assert(!is_always_safe_cast<Sec64, D<double>>::value, "rounds");
+static_assert(!is_always_safe_cast<Sec32, D<float>>::value, "rounds");
+static_assert(!is_always_safe_cast<Milli32, D<double>>::value, "rounds");
+
+// floating point
+static_assert(is_always_safe_cast<D<float>, D<double>>::value, "");
+static_assert(!is_always_safe_cast<D<double>, D<float>>::value, "overflows");
+static_assert(!is_always_safe_cast<D<float>, D<double, std::milli>>::value,
+              "rounds");
+static_assert(!is_always_safe_cast<D<double>, Sec64>::value, "NaN");
+
+TEST_CASE("implicit_safe_cast is constexpr")
+{
+  constexpr auto ms = implicit_safe_cast<Milli64>(Sec32{ -7 });
+  static_assert(ms.count() == -7000, "");
+  REQUIRE(implicit_safe_cast<D<double>>(D<float>{ 0.5f }).count() == 0.5);
+}
+
+TEST_CASE("implicit_safe_cast agrees with safe_duration_cast")
+{
+  verifyAll<D<std::int16_t>, D<std::int32_t, std::milli>>();
+  verifyAll<D<std::uint16_t, std::ratio<3>>, D<std::int32_t, std::deci>>();
+  verifyAll<D<std::int16_t, std::deca>, D<float>>();
+  verifyAll<D<std::int8_t, std::kilo>, D<float>>();
+}
@@ -0,0 +1,126 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <safe_duration_cast/multi.hpp>
+#include <tuple>
+#include <vector>
+
+#include "testsupport.hpp"
+
+namespace {
+using Millis32 = std::chrono::duration<std::int32_t, std::milli>;
+using UnsignedMicros = std::chrono::duration<std::uint64_t, std::micro>;
+using UnsignedSeconds = std::chrono::duration<std::uint32_t>;
+using Thirds = std::chrono::duration<std::int64_t, std::ratio<1, 3>>;
+using FloatSeconds = std::chrono::duration<double>;
+
+template<typename From, typename A, typename B, typename C>
+void
+verify()
+{
+  using safe_duration_cast::safe_duration_cast;
+  const auto in = tests::durations<From>();
+  std::vector<A> a(in.size());
+  std::vector<B> b(in.size());
+  std::vector<C> c(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  const auto summary = safe_duration_cast::safe_duration_cast_multi_n(
+    in.data(), in.size(), failmask.data(), a.data(), b.data(), c.data());
+
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int ec_a = 0;
+    int ec_b = 0;
+    int ec_c = 0;
+    const A expected_a = safe_duration_cast<A>(in[i], ec_a);
+    const B expected_b = safe_duration_cast<B>(in[i], ec_b);
+    const C expected_c = safe_duration_cast<C>(in[i], ec_c);
+    const int expected_ec = ec_a ? ec_a : ec_b ? ec_b : ec_c;
+
+    int ec = 0;
+    const auto multi =
+      safe_duration_cast::safe_duration_cast_multi<A, B, C>(in[i], ec);
+    REQUIRE(ec == expected_ec);
+    REQUIRE(std::get<0>(multi) == expected_a);
+    REQUIRE(std::get<1>(multi) == expected_b);
+    REQUIRE(std::get<2>(multi) == expected_c);
+
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == (expected_ec != 0));
+    REQUIRE(a[i] == expected_a);
+    REQUIRE(b[i] == expected_b);
+    REQUIRE(c[i] == expected_c);
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+}
+} // namespace
+
+TEST_CASE("safe_duration_cast_multi chains nested units")
+{
+  using safe_duration_cast::detail::chains;
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  using std::chrono::nanoseconds;
+  using std::chrono::seconds;
+  static_assert(chains<nanoseconds, microseconds, milliseconds>::value, "");
+  static_assert(chains<nanoseconds, milliseconds, Millis32>::value, "");
+  static_assert(!chains<nanoseconds, seconds, milliseconds>::value, "");
+  static_assert(!chains<nanoseconds, milliseconds, Thirds>::value, "");
+  static_assert(!chains<nanoseconds, UnsignedMicros, milliseconds>::value, "");
+  static_assert(!chains<nanoseconds, FloatSeconds, std::chrono::hours>::value,
+                "");
+
+  int ec = 0;
+  const auto t = safe_duration_cast::safe_duration_cast_multi<microseconds,
+                                                              milliseconds,
+                                                              seconds>(
+    nanoseconds{ -1234567890 }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(std::get<0>(t) == microseconds{ -1234567 });
+  REQUIRE(std::get<1>(t) == milliseconds{ -1234 });
+  REQUIRE(std::get<2>(t) == seconds{ -1 });
+
+  // the first target fails, but the later ones do not
+  const auto u =
+    safe_duration_cast::safe_duration_cast_multi<Millis32, seconds>(
+      std::chrono::hours{ 1000 }, ec);
+  REQUIRE(ec == 1);
+  REQUIRE(std::get<0>(u) == Millis32{ 0 });
+  REQUIRE(std::get<1>(u) == seconds{ 3600000 });
+
+  REQUIRE_THROWS(safe_duration_cast::safe_duration_cast_multi<seconds, Millis32>(
+    std::chrono::hours{ 1000 }));
+}
+
+TEST_CASE("safe_duration_cast_multi gives the same as separate casts")
+{
+  using std::chrono::hours;
+  using std::chrono::microseconds;
+  using std::chrono::milliseconds;
+  using std::chrono::nanoseconds;
+  using std::chrono::seconds;
+  using std::chrono::duration;
+  verify<nanoseconds, microseconds, milliseconds, seconds>();
+  verify<nanoseconds, Millis32, seconds, hours>();
+  verify<nanoseconds, UnsignedMicros, milliseconds, UnsignedSeconds>();
+  verify<duration<std::uint64_t, std::nano>,
+         UnsignedMicros,
+         UnsignedSeconds,
+         seconds>();
+  verify<Thirds, milliseconds, Thirds, seconds>();
+  verify<seconds, nanoseconds, Millis32, hours>();
+  verify<milliseconds, FloatSeconds, seconds, Millis32>();
+  verify<duration<std::int16_t, std::ratio<60>>, Millis32, seconds, hours>();
+}
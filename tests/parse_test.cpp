@@ -0,0 +1,249 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <safe_duration_cast/parse.hpp>
+#include <string>
+
+#include "testsupport.hpp"
+
+namespace {
+using picoseconds = std::chrono::duration<std::int64_t, std::pico>;
+
+template<typename To>
+To
+parse(const std::string& str, int expected_ec = 0)
+{
+  int ec = -1;
+  const To ret = safe_duration_cast::safe_parse_duration<To>(str, ec);
+  INFO(str);
+  REQUIRE(ec == expected_ec);
+  if (ec) {
+    REQUIRE(ret == To::zero());
+  }
+  return ret;
+}
+
+// the largest and smallest int64, in digits
+const std::string int64_max = std::to_string(INT64_MAX);
+const std::string int64_min = std::to_string(INT64_MIN);
+} // namespace
+
+TEST_CASE("parse durations")
+{
+  using namespace std::chrono;
+  REQUIRE(parse<milliseconds>("150ms") == milliseconds{ 150 });
+  REQUIRE(parse<seconds>("2h30m") == seconds{ 9000 });
+  REQUIRE(parse<milliseconds>("1.5s") == milliseconds{ 1500 });
+  REQUIRE(parse<nanoseconds>("-1.5h") == -minutes{ 90 });
+  REQUIRE(parse<nanoseconds>("+5s") == seconds{ 5 });
+  REQUIRE(parse<nanoseconds>("1h2m3s4ms5us6ns") ==
+          hours{ 1 } + minutes{ 2 } + seconds{ 3 } + milliseconds{ 4 } +
+            microseconds{ 5 } + nanoseconds{ 6 });
+  REQUIRE(parse<nanoseconds>("3\xC2\xB5s") == microseconds{ 3 });
+  REQUIRE(parse<nanoseconds>("3\xCE\xBCs") == microseconds{ 3 });
+  REQUIRE(parse<nanoseconds>("0") == nanoseconds{ 0 });
+  REQUIRE(parse<nanoseconds>("-0") == nanoseconds{ 0 });
+  REQUIRE(parse<nanoseconds>(".5s") == milliseconds{ 500 });
+  REQUIRE(parse<nanoseconds>("5.s") == seconds{ 5 });
+  REQUIRE(parse<nanoseconds>("1m1m") == minutes{ 2 });
+
+  // leading zeros and long digit strings, which are read eight at a time
+  REQUIRE(parse<nanoseconds>("00000000000000000000000000000001s") ==
+          seconds{ 1 });
+  REQUIRE(parse<nanoseconds>("12345678ns") == nanoseconds{ 12345678 });
+  REQUIRE(parse<nanoseconds>("1234567890123456ns") ==
+          nanoseconds{ 1234567890123456 });
+  REQUIRE(parse<nanoseconds>("1.234567890123456789s") ==
+          nanoseconds{ 1234567890 });
+
+  // the terms are truncated towards zero
+  REQUIRE(parse<seconds>("90s") == seconds{ 90 });
+  REQUIRE(parse<minutes>("90s") == minutes{ 1 });
+  REQUIRE(parse<minutes>("-90s") == minutes{ -1 });
+  REQUIRE(parse<nanoseconds>("1.9999999999ns") == nanoseconds{ 1 });
+  REQUIRE(parse<nanoseconds>("0.0000000015s") == nanoseconds{ 1 });
+  REQUIRE(parse<picoseconds>("1.5ns") == picoseconds{ 1500 });
+  REQUIRE(parse<picoseconds>("0.001ns") == picoseconds{ 1 });
+  REQUIRE(parse<picoseconds>("0.0009ns") == picoseconds{ 0 });
+
+  // exact, where a double would not be. a third of an hour is 1200 s, and
+  // these are just below and above it.
+  const std::string third = "0." + std::string(40, '3') + "h";
+  REQUIRE(parse<nanoseconds>(third) == nanoseconds{ 1199999999999 });
+  REQUIRE(parse<nanoseconds>("0." + std::string(40, '3') + "4h") ==
+          nanoseconds{ 1200000000000 });
+  REQUIRE(parse<nanoseconds>("0." + std::string(40, '9') + "h") ==
+          nanoseconds{ 3600000000000 - 1 });
+  using thirds = duration<std::int64_t, std::ratio<1, 3>>;
+  REQUIRE(parse<thirds>("0.3333333334s") == thirds{ 1 });
+  REQUIRE(parse<thirds>("0.3333333333s") == thirds{ 0 });
+  REQUIRE(parse<thirds>("1m") == thirds{ 180 });
+  REQUIRE(parse<thirds>("1500ms") == thirds{ 4 });
+}
+
+TEST_CASE("parse adds the terms before truncating")
+{
+  using namespace std::chrono;
+  using thirds = duration<std::int64_t, std::ratio<1, 3>>;
+  REQUIRE(parse<hours>("30m30m") == hours{ 1 });
+  REQUIRE(parse<seconds>("1.5s1.5s") == seconds{ 3 });
+  REQUIRE(parse<seconds>("-1.5s1.5s") == seconds{ -3 });
+  REQUIRE(parse<minutes>("30s30s") == minutes{ 1 });
+  REQUIRE(parse<hours>("59m59s999ms1ms") == hours{ 1 });
+  REQUIRE(parse<hours>("59m59s999ms") == hours{ 0 });
+  REQUIRE(parse<seconds>("999ms500us500us") == seconds{ 1 });
+  REQUIRE(parse<milliseconds>("0.5ms0.5ms") == milliseconds{ 1 });
+  REQUIRE(parse<thirds>("0.2s0.2s") == thirds{ 1 });
+  REQUIRE(parse<microseconds>("0.0005ms0.0005ms") == microseconds{ 1 });
+  REQUIRE(parse<hours>("0.5h0.25h0.25h") == hours{ 1 });
+  REQUIRE(parse<hours>("2562047h47m16.854775807s") == hours{ 2562047 });
+
+  // terms of mixed units, whose exact sum in nanoseconds is known
+  using tests::Int128_t;
+  const char* const units[] = { "ns", "us", "ms", "s", "m", "h" };
+  const std::int64_t unit_ns[] = {
+    1, 1000, 1000000, 1000000000, 60000000000, 3600000000000
+  };
+  // fraction digits which keep a term a whole number of nanoseconds
+  const int max_digits[] = { 0, 3, 6, 9, 9, 9 };
+  std::mt19937_64 rng(2019);
+  for (int i = 0; i < 10000; ++i) {
+    std::string str;
+    Int128_t total = 0;
+    const int terms = 1 + static_cast<int>(rng() % 4);
+    for (int t = 0; t < terms; ++t) {
+      const int u = static_cast<int>(rng() % 6);
+      const std::int64_t whole = static_cast<std::int64_t>(rng() % 100);
+      const int digits =
+        static_cast<int>(rng() % static_cast<unsigned>(max_digits[u] + 1));
+      std::int64_t scale = 1;
+      for (int d = 0; d < digits; ++d) {
+        scale *= 10;
+      }
+      const std::int64_t frac = static_cast<std::int64_t>(rng()) % scale;
+      const std::int64_t f = frac < 0 ? -frac : frac;
+      str += std::to_string(whole);
+      if (digits > 0) {
+        const std::string fs = std::to_string(scale + f).substr(1);
+        str += "." + fs;
+      }
+      str += units[u];
+      total += Int128_t(whole) * unit_ns[u] + Int128_t(f) * unit_ns[u] / scale;
+    }
+    INFO(str);
+    REQUIRE(parse<nanoseconds>(str).count() ==
+            static_cast<std::int64_t>(total));
+    REQUIRE(parse<seconds>(str).count() ==
+            static_cast<std::int64_t>(total / 1000000000));
+    REQUIRE(parse<hours>(str).count() ==
+            static_cast<std::int64_t>(total / 3600000000000));
+    REQUIRE(parse<thirds>(str).count() ==
+            static_cast<std::int64_t>(total * 3 / 1000000000));
+    REQUIRE(parse<picoseconds>(str).count() ==
+            static_cast<std::int64_t>(total * 1000));
+  }
+}
+
+TEST_CASE("parse durations out of range")
+{
+  using namespace std::chrono;
+  REQUIRE(parse<nanoseconds>(int64_max + "ns") == nanoseconds::max());
+  REQUIRE(parse<nanoseconds>(int64_min + "ns") == nanoseconds::min());
+  parse<nanoseconds>("9223372036854775808ns", 1);
+  parse<nanoseconds>("-9223372036854775809ns", 1);
+  parse<nanoseconds>("18446744073709551616ns", 1);
+  parse<nanoseconds>("100000000000000000000000000000ns", 1);
+  REQUIRE(parse<nanoseconds>("2562047h") == hours{ 2562047 });
+  parse<nanoseconds>("2562048h", 1);
+  // the terms fit, the sum does not
+  parse<nanoseconds>("2562047h2562047h", 1);
+  parse<nanoseconds>(int64_max + "ns1ns", 1);
+
+  using U32 = duration<std::uint32_t>;
+  REQUIRE(parse<U32>("4294967295s") == U32{ 4294967295U });
+  parse<U32>("4294967296s", 1);
+  parse<U32>("-1s", 1);
+  REQUIRE(parse<U32>("-0s") == U32{ 0 });
+  using U64 = duration<std::uint64_t, std::nano>;
+  REQUIRE(parse<U64>("18446744073709551615ns") ==
+          U64{ std::numeric_limits<std::uint64_t>::max() });
+  using I8 = duration<std::int8_t>;
+  REQUIRE(parse<I8>("-2m8s") == I8{ -128 });
+  parse<I8>("2m8s", 1);
+}
+
+TEST_CASE("parse invalid durations")
+{
+  using namespace std::chrono;
+  for (const char* str : { "",       "s",    "1",    "1x",   "-",   "+",
+                           ".s",     "1.5",  "1 s",  " 1s",  "1s ", "1e3s",
+                           "--1s",   "+-1s", "1ns1", "1ms-", "ms",  "1.5.5s",
+                           "1\xC2s", "1\xCE\xB5s",   "00",   "1S",  "1nss" }) {
+    parse<nanoseconds>(str, 3);
+  }
+  // a string with a zero inside is not cut there
+  parse<nanoseconds>(std::string("1s\0", 3), 3);
+}
+
+TEST_CASE("parse random durations")
+{
+  using namespace std::chrono;
+  std::mt19937_64 rng(2019);
+  for (int i = 0; i < 10000; ++i) {
+    const auto count =
+      static_cast<std::int64_t>(rng()) >> static_cast<int>(rng() % 64);
+    const nanoseconds ns{ count };
+    // as plain nanoseconds
+    REQUIRE(parse<nanoseconds>(std::to_string(count) + "ns") == ns);
+    // as hours, minutes and fractional seconds, like go formats them
+    const auto magnitude =
+      count < 0 ? 0 - static_cast<std::uint64_t>(count) : std::uint64_t(count);
+    const std::uint64_t frac = magnitude % 1000000000;
+    const std::uint64_t secs = magnitude / 1000000000;
+    std::string digits = std::to_string(1000000000 + frac).substr(1);
+    const std::string str = (count < 0 ? "-" : "") +
+                            std::to_string(secs / 3600) + "h" +
+                            std::to_string(secs / 60 % 60) + "m" +
+                            std::to_string(secs % 60) + "." + digits + "s";
+    REQUIRE(parse<nanoseconds>(str) == ns);
+    // and truncated to coarser units
+    REQUIRE(parse<milliseconds>(str) == duration_cast<milliseconds>(ns));
+    REQUIRE(parse<minutes>(str) == duration_cast<minutes>(ns));
+    // and to a finer one
+    const bool fits = magnitude <= INT64_MAX / 1000;
+    REQUIRE(parse<picoseconds>(str, fits ? 0 : 1) ==
+            (fits ? picoseconds{ ns } : picoseconds{ 0 }));
+  }
+}
+
+TEST_CASE("parse overloads")
+{
+  using namespace std::chrono;
+  int ec = 0;
+  const char str[] = "15ms and more";
+  REQUIRE(safe_duration_cast::safe_parse_duration<milliseconds>(
+            str, str + 4, ec) == milliseconds{ 15 });
+  REQUIRE(safe_duration_cast::safe_parse_duration<milliseconds>("15ms", ec) ==
+          milliseconds{ 15 });
+#if SDC_HAVE_STRING_VIEW
+  REQUIRE(safe_duration_cast::safe_parse_duration<milliseconds>(
+            std::string_view(str, 4), ec) == milliseconds{ 15 });
+#endif
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+  REQUIRE(safe_duration_cast::safe_parse_duration<milliseconds>("1s") ==
+          seconds{ 1 });
+  REQUIRE_THROWS(safe_duration_cast::safe_parse_duration<milliseconds>("1"));
+  REQUIRE_THROWS(
+    safe_duration_cast::safe_parse_duration<milliseconds>("10000000000000h"));
+#endif
+}
@@ -0,0 +1,277 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/posix_time.hpp>
+#include <vector>
+
+#include "testsupport.hpp"
+
+namespace {
+using picoseconds = std::chrono::duration<std::int64_t, std::pico>;
+
+// a timespec with 32 bit fields, to see that too large seconds are caught
+struct narrow_timespec
+{
+  std::int32_t tv_sec;
+  long tv_nsec;
+};
+
+// the reference splits in 128 bits: seconds rounded down, and the
+// nanoseconds truncated towards zero.
+template<typename Rep, typename Period>
+void
+referenceSplit(std::chrono::duration<Rep, Period> d,
+               tests::Int128_t& sec,
+               tests::Int128_t& nsec)
+{
+  using tests::Int128_t;
+  // d in units of 1/den seconds
+  using F = std::ratio_divide<Period, std::ratio<1>>;
+  const Int128_t count = Int128_t(d.count()) * Int128_t(F::num);
+  const Int128_t den = F::den;
+  Int128_t total_ns = count * 1000000000 / den;
+  sec = total_ns / 1000000000;
+  nsec = total_ns % 1000000000;
+  if (nsec < 0) {
+    nsec += 1000000000;
+    sec -= 1;
+  }
+}
+
+template<typename Dur>
+void
+verifyRoundTrip(Dur d)
+{
+  using tests::Int128_t;
+  Int128_t sec;
+  Int128_t nsec;
+  referenceSplit(d, sec, nsec);
+  using Sec = decltype(::timespec{}.tv_sec);
+  using F = std::ratio_divide<typename Dur::period, std::ratio<1>>;
+  // the count in units of the fraction of a second must fit in intmax_t
+  const Int128_t count = Int128_t(d.count()) * Int128_t(F::num);
+  const bool fits = sec >= Int128_t(std::numeric_limits<Sec>::min()) &&
+                    sec <= Int128_t(std::numeric_limits<Sec>::max()) &&
+                    count >= Int128_t(INTMAX_MIN) &&
+                    count <= Int128_t(INTMAX_MAX);
+  int ec = 0;
+  const ::timespec ts = safe_duration_cast::safe_to_timespec(d, ec);
+  REQUIRE(ec == (fits ? 0 : 1));
+  if (!fits) {
+    return;
+  }
+  REQUIRE(Int128_t(ts.tv_sec) == sec);
+  REQUIRE(Int128_t(ts.tv_nsec) == nsec);
+
+  // back again, which is exact if the unit is a whole number of
+  // nanoseconds
+  const Dur back = safe_duration_cast::safe_from_timespec<Dur>(ts, ec);
+  if (1000000000 % F::den == 0) {
+    REQUIRE(ec == 0);
+    REQUIRE(back == d);
+  }
+}
+
+template<typename Dur>
+void
+verifyRandom()
+{
+  for (const auto d : tests::durations<Dur>(50)) {
+    verifyRoundTrip(d);
+  }
+}
+} // namespace
+
+TEST_CASE("durations to timespec")
+{
+  using namespace std::chrono;
+  int ec = 0;
+  ::timespec ts =
+    safe_duration_cast::safe_to_timespec(milliseconds{ 1500 }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(ts.tv_sec == 1);
+  REQUIRE(ts.tv_nsec == 500000000);
+
+  // negative durations round the seconds down, like posix wants it
+  ts = safe_duration_cast::safe_to_timespec(nanoseconds{ -1 }, ec);
+  REQUIRE(ts.tv_sec == -1);
+  REQUIRE(ts.tv_nsec == 999999999);
+
+  // below a nanosecond, the result truncates towards zero
+  ts = safe_duration_cast::safe_to_timespec(picoseconds{ -1 }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(ts.tv_sec == 0);
+  REQUIRE(ts.tv_nsec == 0);
+  ts = safe_duration_cast::safe_to_timespec(picoseconds{ -1001 }, ec);
+  REQUIRE(ts.tv_sec == -1);
+  REQUIRE(ts.tv_nsec == 999999999);
+  ts = safe_duration_cast::safe_to_timespec(picoseconds{ 1999 }, ec);
+  REQUIRE(ts.tv_sec == 0);
+  REQUIRE(ts.tv_nsec == 1);
+
+  ts = safe_duration_cast::safe_to_timespec(minutes{ -2 }, ec);
+  REQUIRE(ts.tv_sec == -120);
+  REQUIRE(ts.tv_nsec == 0);
+
+  using thirds = duration<int, std::ratio<1, 3>>;
+  ts = safe_duration_cast::safe_to_timespec(thirds{ 4 }, ec);
+  REQUIRE(ts.tv_sec == 1);
+  REQUIRE(ts.tv_nsec == 333333333);
+
+  // the seconds do not fit in 32 bits
+  safe_duration_cast::safe_to_timespec<narrow_timespec>(
+    seconds{ std::int64_t{ 1 } << 31 }, ec);
+  REQUIRE(ec == 1);
+  const auto narrow = safe_duration_cast::safe_to_timespec<narrow_timespec>(
+    milliseconds{ -1 }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(narrow.tv_sec == -1);
+  REQUIRE(narrow.tv_nsec == 999000000);
+
+  // hours which do not fit in intmax_t seconds
+  safe_duration_cast::safe_to_timespec(
+    hours{ std::numeric_limits<std::int64_t>::max() }, ec);
+  REQUIRE(ec == 1);
+
+  verifyRandom<nanoseconds>();
+  verifyRandom<microseconds>();
+  verifyRandom<milliseconds>();
+  verifyRandom<seconds>();
+  verifyRandom<duration<std::int32_t, std::milli>>();
+  verifyRandom<duration<std::uint64_t, std::micro>>();
+  verifyRandom<duration<std::int16_t, std::ratio<60>>>();
+  verifyRandom<duration<std::int64_t, std::ratio<1, 3>>>();
+  verifyRandom<picoseconds>();
+}
+
+TEST_CASE("timespec to durations")
+{
+  using namespace std::chrono;
+  int ec = 0;
+  ::timespec ts{};
+  ts.tv_sec = -1;
+  ts.tv_nsec = 999999999;
+  // -1 ns, truncated towards zero
+  REQUIRE(safe_duration_cast::safe_from_timespec<nanoseconds>(ts, ec) ==
+          nanoseconds{ -1 });
+  REQUIRE(safe_duration_cast::safe_from_timespec<microseconds>(ts, ec) ==
+          microseconds{ 0 });
+  REQUIRE(safe_duration_cast::safe_from_timespec<seconds>(ts, ec) ==
+          seconds{ 0 });
+  REQUIRE(safe_duration_cast::safe_from_timespec<picoseconds>(ts, ec) ==
+          picoseconds{ -1000 });
+  REQUIRE(ec == 0);
+
+  ts.tv_sec = -61;
+  ts.tv_nsec = 1;
+  REQUIRE(safe_duration_cast::safe_from_timespec<minutes>(ts, ec) ==
+          minutes{ -1 });
+  ts.tv_sec = 61;
+  REQUIRE(safe_duration_cast::safe_from_timespec<minutes>(ts, ec) ==
+          minutes{ 1 });
+  REQUIRE(ec == 0);
+
+  // invalid nanoseconds
+  ts.tv_nsec = 1000000000;
+  safe_duration_cast::safe_from_timespec<nanoseconds>(ts, ec);
+  REQUIRE(ec == 1);
+  ts.tv_nsec = -1;
+  safe_duration_cast::safe_from_timespec<seconds>(ts, ec);
+  REQUIRE(ec == 1);
+
+  // does not fit in the target
+  ts.tv_sec = 3;
+  ts.tv_nsec = 0;
+  safe_duration_cast::safe_from_timespec<duration<std::int32_t, std::nano>>(
+    ts, ec);
+  REQUIRE(ec == 1);
+  ts.tv_sec = -1;
+  safe_duration_cast::safe_from_timespec<duration<std::uint32_t>>(ts, ec);
+  REQUIRE(ec == 1);
+  ts.tv_sec = std::numeric_limits<decltype(ts.tv_sec)>::max();
+  safe_duration_cast::safe_from_timespec<nanoseconds>(ts, ec);
+  REQUIRE(ec == 1);
+}
+
+#if SDC_HAVE_TIMEVAL
+TEST_CASE("timeval")
+{
+  using namespace std::chrono;
+  int ec = 0;
+  ::timeval tv = safe_duration_cast::safe_to_timeval(nanoseconds{ -1500 }, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(tv.tv_sec == -1);
+  REQUIRE(tv.tv_usec == 999999);
+  REQUIRE(safe_duration_cast::safe_from_timeval<nanoseconds>(tv, ec) ==
+          nanoseconds{ -1000 });
+  REQUIRE(ec == 0);
+  tv.tv_usec = 1000000;
+  safe_duration_cast::safe_from_timeval<nanoseconds>(tv, ec);
+  REQUIRE(ec == 1);
+}
+#endif
+
+TEST_CASE("arrays of timespec")
+{
+  using namespace std::chrono;
+  using L = std::numeric_limits<std::int64_t>;
+  std::vector<hours> in;
+  for (int i = 0; i < 200; ++i) {
+    in.push_back(hours{ i % 3 == 0 ? L::max() - i : i - 100 });
+  }
+  std::vector<::timespec> ts(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  auto summary = safe_duration_cast::safe_to_timespec_n(
+    in.data(), ts.data(), in.size(), failmask.data());
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int ec = 0;
+    const ::timespec expected = safe_duration_cast::safe_to_timespec(in[i], ec);
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == (ec != 0));
+    REQUIRE(ts[i].tv_sec == expected.tv_sec);
+    REQUIRE(ts[i].tv_nsec == expected.tv_nsec);
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+  REQUIRE(summary.first_failure == 0);
+
+  // and back, with some invalid nanoseconds
+  ts[5].tv_nsec = -3;
+  std::vector<seconds> back(ts.size());
+  summary = safe_duration_cast::safe_from_timespec_n(
+    ts.data(), back.data(), ts.size(), failmask.data());
+  REQUIRE(summary.failures == 1);
+  for (std::size_t i = 0; i < ts.size(); ++i) {
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    // the conversions which failed above left zeros
+    REQUIRE(failed == (i == 5));
+    REQUIRE(back[i] ==
+            (failed || i % 3 == 0 ? seconds{ 0 } : seconds{ in[i] }));
+  }
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+TEST_CASE("throwing timespec conversions")
+{
+  using namespace std::chrono;
+  REQUIRE_THROWS(safe_duration_cast::safe_to_timespec<narrow_timespec>(
+    hours{ 1000000 }));
+  ::timespec ts{};
+  ts.tv_nsec = -1;
+  REQUIRE_THROWS(safe_duration_cast::safe_from_timespec<nanoseconds>(ts));
+  ts.tv_nsec = 1;
+  REQUIRE(safe_duration_cast::safe_from_timespec<nanoseconds>(ts) ==
+          nanoseconds{ 1 });
+}
+#endif
@@ -0,0 +1,167 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <safe_duration_cast/detail/reciprocal.hpp>
+#include <vector>
+
+using safe_duration_cast::detail::reciprocal;
+
+/**
+ * divisors which are interesting: small ones, powers of two and their
+ * neighbours, the ones used by the standard ratios, and the largest ones.
+ */
+template<typename T>
+std::vector<T>
+makeDivisors()
+{
+  using L = std::numeric_limits<T>;
+  std::vector<T> ret;
+  for (int d = 1; d <= 20; ++d) {
+    ret.push_back(static_cast<T>(d));
+  }
+  for (int shift = 2; shift < L::digits; ++shift) {
+    const auto p = static_cast<std::uint64_t>(1) << shift;
+    ret.push_back(static_cast<T>(p - 1));
+    ret.push_back(static_cast<T>(p));
+    ret.push_back(static_cast<T>(p + 1));
+  }
+  for (std::uint64_t p = 10; p <= static_cast<std::uint64_t>(L::max()) / 10;
+       p *= 10) {
+    ret.push_back(static_cast<T>(p));
+    ret.push_back(static_cast<T>(p * 6));
+  }
+  ret.push_back(static_cast<T>(L::max() - 1));
+  ret.push_back(L::max());
+  return ret;
+}
+
+/**
+ * numerators which are interesting for divisor d: the limits, and values
+ * close to multiples of d.
+ */
+template<typename T>
+std::vector<T>
+makeNumerators(T d)
+{
+  using L = std::numeric_limits<T>;
+  // wraparound is fine here, but must not be done on signed types
+  using U = typename std::make_unsigned<T>::type;
+  auto add = [](T a, int b) {
+    return static_cast<T>(static_cast<U>(static_cast<U>(a) + static_cast<U>(b)));
+  };
+  std::vector<T> ret;
+  const T base[] = { 0, L::max(), L::min(), static_cast<T>(L::max() / 2),
+                     static_cast<T>(L::min() / 2) };
+  for (auto b : base) {
+    const T q = static_cast<T>(b / d);
+    for (int k = -2; k <= 2; ++k) {
+      // multiples of d close to b, plus or minus one
+      const T m = static_cast<T>(
+        static_cast<U>(static_cast<U>(add(q, k)) * static_cast<U>(d)));
+      for (int delta = -1; delta <= 1; ++delta) {
+        ret.push_back(add(m, delta));
+      }
+      ret.push_back(add(b, k));
+    }
+  }
+  return ret;
+}
+
+template<typename T>
+void
+verifyDivisor(T d, const std::vector<T>& numerators)
+{
+  const reciprocal<T> r(d);
+  REQUIRE(r.divisor() == d);
+  for (auto n : numerators) {
+    const T expected = static_cast<T>(n / d);
+    const T actual = r.divide(n);
+    if (actual != expected) {
+      CAPTURE(static_cast<long long>(d));
+      CAPTURE(static_cast<long long>(n));
+      REQUIRE(actual == expected);
+    }
+    REQUIRE(r.remainder(n) == static_cast<T>(n % d));
+  }
+}
+
+template<typename T>
+void
+verifyExhaustively()
+{
+  using L = std::numeric_limits<T>;
+  std::vector<T> all;
+  for (auto n = static_cast<long>(L::min()); n <= static_cast<long>(L::max());
+       ++n) {
+    all.push_back(static_cast<T>(n));
+  }
+  for (auto d = 1L; d <= static_cast<long>(L::max()); ++d) {
+    verifyDivisor(static_cast<T>(d), all);
+  }
+}
+
+template<typename T>
+void
+verifyInterestingValues()
+{
+  for (auto d : makeDivisors<T>()) {
+    if (d > 0) {
+      verifyDivisor(d, makeNumerators(d));
+    }
+  }
+}
+
+TEST_CASE("reciprocal of all 8 bit values")
+{
+  verifyExhaustively<std::int8_t>();
+  verifyExhaustively<std::uint8_t>();
+}
+
+TEST_CASE("reciprocal of 16 bit values")
+{
+  std::vector<std::int16_t> signed_numerators;
+  std::vector<std::uint16_t> unsigned_numerators;
+  for (long n = -32768; n <= 32767; ++n) {
+    signed_numerators.push_back(static_cast<std::int16_t>(n));
+    unsigned_numerators.push_back(static_cast<std::uint16_t>(n));
+  }
+  for (auto d : makeDivisors<std::int16_t>()) {
+    verifyDivisor(d, signed_numerators);
+  }
+  for (auto d : makeDivisors<std::uint16_t>()) {
+    verifyDivisor(d, unsigned_numerators);
+  }
+}
+
+TEST_CASE("reciprocal of 32 and 64 bit values")
+{
+  verifyInterestingValues<std::int32_t>();
+  verifyInterestingValues<std::uint32_t>();
+  verifyInterestingValues<std::int64_t>();
+  verifyInterestingValues<std::uint64_t>();
+}
+
+#if __cplusplus >= 201402L
+TEST_CASE("reciprocal at compile time")
+{
+  constexpr reciprocal<std::int64_t> milli(1000);
+  static_assert(milli.divide(-1999) == -1, "");
+  static_assert(milli.divide(std::numeric_limits<std::int64_t>::min()) ==
+                  std::numeric_limits<std::int64_t>::min() / 1000,
+                "");
+  constexpr reciprocal<std::uint64_t> nano(1000000000);
+  static_assert(nano.divide(std::numeric_limits<std::uint64_t>::max()) ==
+                  std::numeric_limits<std::uint64_t>::max() / 1000000000,
+                "");
+  REQUIRE(milli.divide(2000) == 2);
+}
+#endif
@@ -0,0 +1,203 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <safe_duration_cast/parallel_reduce.hpp>
+#include <safe_duration_cast/reduce.hpp>
+#include <vector>
+
+#include "testsupport.hpp"
+
+namespace {
+template<typename Rep>
+std::vector<std::chrono::duration<Rep>>
+randomDurations(std::size_t n, int shift)
+{
+  std::mt19937_64 rng(2019 + shift);
+  std::vector<std::chrono::duration<Rep>> ret;
+  for (std::size_t i = 0; i < n; ++i) {
+    ret.push_back(
+      std::chrono::duration<Rep>{ static_cast<Rep>(rng() >> shift) });
+  }
+  return ret;
+}
+
+// sum, min, max and mean against a 128 bit reference, sequential and on
+// threads
+template<typename Rep>
+void
+verifyIntegral(const std::vector<std::chrono::duration<Rep>>& in)
+{
+  using tests::Int128_t;
+  using L = std::numeric_limits<Rep>;
+  const std::size_t n = in.size();
+  Int128_t sum = 0;
+  for (auto d : in) {
+    sum += d.count();
+  }
+  const bool fits = sum >= Int128_t(L::min()) && sum <= Int128_t(L::max());
+
+  for (unsigned threads : { 1U, 3U, 0U }) {
+    int ec = 0;
+    const auto s = threads == 1
+                     ? safe_duration_cast::safe_sum(in.data(), n, ec)
+                     : safe_duration_cast::safe_sum_parallel(
+                         in.data(), n, ec, threads);
+    REQUIRE(ec == (fits ? 0 : 1));
+    REQUIRE(Int128_t(s.count()) == (fits ? sum : Int128_t(0)));
+
+    const auto mean = threads == 1
+                        ? safe_duration_cast::safe_mean(in.data(), n, ec)
+                        : safe_duration_cast::safe_mean_parallel(
+                            in.data(), n, ec, threads);
+    REQUIRE(ec == 0);
+    REQUIRE(Int128_t(mean.count()) == sum / Int128_t(n));
+
+    const auto mm = threads == 1
+                      ? safe_duration_cast::safe_minmax(in.data(), n, ec)
+                      : safe_duration_cast::safe_minmax_parallel(
+                          in.data(), n, ec, threads);
+    REQUIRE(ec == 0);
+    REQUIRE(mm.first == *std::min_element(in.begin(), in.end()));
+    REQUIRE(mm.second == *std::max_element(in.begin(), in.end()));
+  }
+}
+
+template<typename Rep>
+void
+verifyIntegral()
+{
+  using L = std::numeric_limits<Rep>;
+  using D = std::chrono::duration<Rep>;
+  for (std::size_t n : { 1U, 7U, 64U, 1000U, 300000U }) {
+    for (int shift : { 0, 1, 8, 40 }) {
+      verifyIntegral<Rep>(randomDurations<Rep>(n, shift));
+    }
+  }
+  // all at the edges
+  verifyIntegral<Rep>(std::vector<D>(1000, D{ L::max() }));
+  verifyIntegral<Rep>(std::vector<D>(1000, D{ L::min() }));
+  verifyIntegral<Rep>(std::vector<D>(1, D{ L::max() }));
+  std::vector<D> alternating;
+  for (int i = 0; i < 1001; ++i) {
+    alternating.push_back(D{ i % 2 ? L::min() : L::max() });
+  }
+  verifyIntegral<Rep>(alternating);
+}
+} // namespace
+
+TEST_CASE("reductions of integral durations")
+{
+  verifyIntegral<std::int64_t>();
+  verifyIntegral<std::uint64_t>();
+  verifyIntegral<std::int32_t>();
+  verifyIntegral<std::uint16_t>();
+  verifyIntegral<std::int8_t>();
+
+  // an empty array has a sum, but no mean or extremes
+  int ec = 0;
+  REQUIRE(safe_duration_cast::safe_sum<std::int64_t, std::milli>(
+            nullptr, 0, ec) == std::chrono::milliseconds{ 0 });
+  REQUIRE(ec == 0);
+  safe_duration_cast::safe_mean<std::int64_t, std::milli>(nullptr, 0, ec);
+  REQUIRE(ec == 1);
+  safe_duration_cast::safe_minmax<std::int64_t, std::milli>(nullptr, 0, ec);
+  REQUIRE(ec == 1);
+
+  // latencies which add up to more than nanoseconds can hold
+  std::vector<std::chrono::nanoseconds> day(100,
+                                            std::chrono::hours{ 24 * 2000 });
+  safe_duration_cast::safe_sum(day.data(), day.size(), ec);
+  REQUIRE(ec == 1);
+  REQUIRE(safe_duration_cast::safe_mean(day.data(), day.size(), ec) ==
+          std::chrono::hours{ 24 * 2000 });
+  REQUIRE(ec == 0);
+}
+
+TEST_CASE("reductions of floating point durations")
+{
+  using FloatSeconds = std::chrono::duration<float>;
+  using DoubleSeconds = std::chrono::duration<double>;
+  using L = std::numeric_limits<double>;
+  int ec = 0;
+
+  // plain summation of a million 0.1f in float is off by almost 1%
+  std::vector<FloatSeconds> tenths(1000000, FloatSeconds{ 0.1f });
+  for (unsigned threads : { 1U, 4U }) {
+    const auto s =
+      threads == 1
+        ? safe_duration_cast::safe_sum(tenths.data(), tenths.size(), ec)
+        : safe_duration_cast::safe_sum_parallel(
+            tenths.data(), tenths.size(), ec, threads);
+    REQUIRE(ec == 0);
+    REQUIRE(s == FloatSeconds{ 100000.0f });
+    const auto mean =
+      threads == 1
+        ? safe_duration_cast::safe_mean(tenths.data(), tenths.size(), ec)
+        : safe_duration_cast::safe_mean_parallel(
+            tenths.data(), tenths.size(), ec, threads);
+    REQUIRE(ec == 0);
+    REQUIRE(mean == FloatSeconds{ 0.1f });
+  }
+
+  // cancellation, which compensation handles
+  std::vector<DoubleSeconds> cancel = { DoubleSeconds{ 1.0 },
+                                        DoubleSeconds{ 1e100 },
+                                        DoubleSeconds{ 1.0 },
+                                        DoubleSeconds{ -1e100 } };
+  REQUIRE(safe_duration_cast::safe_sum(cancel.data(), cancel.size(), ec) ==
+          DoubleSeconds{ 2.0 });
+
+  // finite values which overflow, where the mean still fits
+  std::vector<DoubleSeconds> huge(10, DoubleSeconds{ L::max() });
+  safe_duration_cast::safe_sum(huge.data(), huge.size(), ec);
+  REQUIRE(ec == 1);
+  const auto huge_mean =
+    safe_duration_cast::safe_mean(huge.data(), huge.size(), ec);
+  REQUIRE(ec == 0);
+  REQUIRE(huge_mean.count() >= L::max() * (1 - 4 * L::epsilon()));
+
+  // infinity and NaN pass through
+  std::vector<DoubleSeconds> inf = { DoubleSeconds{ 1.0 },
+                                     DoubleSeconds{ L::infinity() } };
+  REQUIRE(safe_duration_cast::safe_sum(inf.data(), inf.size(), ec) ==
+          DoubleSeconds{ L::infinity() });
+  REQUIRE(ec == 0);
+  std::vector<DoubleSeconds> nan = { DoubleSeconds{ 1.0 },
+                                     DoubleSeconds{ L::quiet_NaN() },
+                                     DoubleSeconds{ -3.0 } };
+  REQUIRE(std::isnan(
+    safe_duration_cast::safe_sum(nan.data(), nan.size(), ec).count()));
+  REQUIRE(ec == 0);
+  const auto mm = safe_duration_cast::safe_minmax(nan.data(), nan.size(), ec);
+  REQUIRE(ec == 0);
+  REQUIRE(std::isnan(mm.first.count()));
+  REQUIRE(std::isnan(mm.second.count()));
+
+  const auto mm2 =
+    safe_duration_cast::safe_minmax(cancel.data(), cancel.size(), ec);
+  REQUIRE(mm2.first == DoubleSeconds{ -1e100 });
+  REQUIRE(mm2.second == DoubleSeconds{ 1e100 });
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+TEST_CASE("throwing reductions")
+{
+  std::vector<std::chrono::nanoseconds> day(100,
+                                            std::chrono::hours{ 24 * 2000 });
+  REQUIRE_THROWS(safe_duration_cast::safe_sum(day.data(), day.size()));
+  REQUIRE_THROWS(safe_duration_cast::safe_mean(day.data(), 0));
+  REQUIRE(safe_duration_cast::safe_minmax(day.data(), day.size()).first ==
+          day[0]);
+}
+#endif
@@ -0,0 +1,72 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/result.hpp>
+#include <type_traits>
+
+using safe_duration_cast::cast_error;
+using safe_duration_cast::try_duration_cast;
+
+namespace {
+using Seconds = std::chrono::duration<std::int64_t>;
+using Millis = std::chrono::duration<std::int32_t, std::milli>;
+} // namespace
+
+static_assert(
+  std::is_trivially_copyable<safe_duration_cast::cast_result<Millis>>::value,
+  "the result should be cheap to return");
+
+TEST_CASE("try_duration_cast success")
+{
+  const auto r = try_duration_cast<Millis>(Seconds{ 3 });
+  REQUIRE(r.ok());
+  REQUIRE(static_cast<bool>(r));
+  REQUIRE(r.error == cast_error::none);
+  REQUIRE(r.value.count() == 3000);
+}
+
+TEST_CASE("try_duration_cast failure")
+{
+  const auto r = try_duration_cast<Millis>(Seconds{ std::int64_t{ 1 } << 40 });
+  REQUIRE(!r.ok());
+  REQUIRE(r.error == cast_error::out_of_range);
+  REQUIRE(r.value.count() == 0);
+
+  const auto nan = try_duration_cast<Millis>(
+    std::chrono::duration<double>{ std::numeric_limits<double>::quiet_NaN() });
+  REQUIRE(!nan.ok());
+}
+
+TEST_CASE("try_duration_cast agrees with the error code form")
+{
+  for (std::int64_t s = -5000000; s <= 5000000; s += 9973) {
+    int ec = 0;
+    const auto expected =
+      safe_duration_cast::safe_duration_cast<Millis>(Seconds{ s }, ec);
+    const auto r = try_duration_cast<Millis>(Seconds{ s });
+    REQUIRE(static_cast<int>(r.error) == ec);
+    REQUIRE(r.value == expected);
+  }
+}
+
+#if SDC_HAVE_STD_EXPECTED
+TEST_CASE("try_duration_cast to std::expected")
+{
+  const auto good =
+    safe_duration_cast::expected_duration_cast<Millis>(Seconds{ 3 });
+  REQUIRE(good.has_value());
+  REQUIRE(good->count() == 3000);
+  const auto bad = try_duration_cast<Millis>(Seconds::max()).to_expected();
+  REQUIRE(!bad.has_value());
+  REQUIRE(bad.error() == cast_error::out_of_range);
+}
+#endif
@@ -0,0 +1,334 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <safe_duration_cast/compare.hpp>
+#include <safe_duration_cast/rounding.hpp>
+#include <type_traits>
+#include <vector>
+
+#include "testsupport.hpp"
+
+namespace {
+using Millis32 = std::chrono::duration<std::int32_t, std::milli>;
+using UnsignedSeconds = std::chrono::duration<std::uint32_t>;
+using UnsignedMillis = std::chrono::duration<std::uint64_t, std::milli>;
+using Thirds = std::chrono::duration<std::int64_t, std::ratio<1, 3>>;
+using Minutes8 = std::chrono::duration<std::int8_t, std::ratio<60>>;
+using FloatSeconds = std::chrono::duration<double>;
+using FloatMillis = std::chrono::duration<double, std::milli>;
+
+// the shared inputs, and ties for the common denominators
+template<typename From>
+std::vector<From>
+inputs()
+{
+  using Rep = typename From::rep;
+  return tests::durations<From>([](Rep x, std::vector<Rep>& ret) {
+    ret.push_back(static_cast<Rep>(x / 1000 * 1000 + 500));
+    ret.push_back(static_cast<Rep>(x / 60 * 60 - 30));
+  });
+}
+
+struct expectation
+{
+  int ec;
+  std::intmax_t count;
+};
+
+// steps from the truncated result t towards from, if they differ. the
+// comparison is exact, so this does not repeat the arithmetic under test.
+template<typename To, typename From>
+expectation
+step(From from, typename To::rep t, int direction)
+{
+  using L = std::numeric_limits<typename To::rep>;
+  const int c = safe_duration_cast::safe_compare(To{ t }, from);
+  if (c == 0 || (c < 0) != (direction > 0)) {
+    return { 0, static_cast<std::intmax_t>(t) };
+  }
+  if (direction > 0 ? t == L::max() : t == L::min()) {
+    return { 1, 0 };
+  }
+  return { 0, static_cast<std::intmax_t>(t) + direction };
+}
+
+template<typename To, typename From, typename Cast, typename CastN>
+void
+verifyBatch(const std::vector<From>& in,
+            const std::vector<expectation>& expected,
+            Cast cast,
+            CastN cast_n)
+{
+  std::vector<To> out(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  const auto summary =
+    cast_n(in.data(), out.data(), in.size(), failmask.data());
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int ec = 0;
+    const To to = cast(in[i], ec);
+    REQUIRE(ec == expected[i].ec);
+    REQUIRE(static_cast<std::intmax_t>(to.count()) == expected[i].count);
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == (ec != 0));
+    REQUIRE(out[i] == to);
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+
+  // in place, if the representation is the same
+  const auto inplace = tests::convertInPlace<To>(
+    in, [&cast_n](const From* first, To* result, std::size_t n) {
+      cast_n(first, result, n, nullptr);
+    });
+  if (!inplace.empty()) {
+    REQUIRE(inplace == out);
+  }
+}
+
+// safe_floor, safe_ceil and safe_round against a reference built from the
+// truncating cast and exact comparisons
+template<typename To, typename From>
+void
+verifyIntegral()
+{
+  using Half = std::chrono::duration<
+    std::intmax_t,
+    std::ratio_multiply<typename To::period, std::ratio<1, 2>>>;
+  const auto in = inputs<From>();
+  std::vector<expectation> floors;
+  std::vector<expectation> ceils;
+  std::vector<expectation> rounds;
+  std::vector<From> roundable;
+  for (const auto from : in) {
+    int ec = 0;
+    const To t = safe_duration_cast::safe_duration_cast<To>(from, ec);
+    if (ec) {
+      floors.push_back({ ec, 0 });
+      ceils.push_back({ ec, 0 });
+      continue;
+    }
+    const auto f = step<To>(from, t.count(), -1);
+    const auto c = step<To>(from, t.count(), +1);
+    floors.push_back(f);
+    ceils.push_back(c);
+    // the reference for rounding compares with the midpoint in half units
+    if (f.ec || c.ec) {
+      continue;
+    }
+    const std::intmax_t lim = std::numeric_limits<std::intmax_t>::max() / 4;
+    if (f.count < -lim || f.count > lim) {
+      continue;
+    }
+    roundable.push_back(from);
+    if (f.count == c.count) {
+      rounds.push_back(f);
+      continue;
+    }
+    const int m =
+      safe_duration_cast::safe_compare(from, Half{ 2 * f.count + 1 });
+    const bool even_floor = f.count % 2 == 0;
+    rounds.push_back(m < 0 || (m == 0 && even_floor) ? f : c);
+  }
+
+  using safe_duration_cast::safe_ceil;
+  using safe_duration_cast::safe_ceil_n;
+  using safe_duration_cast::safe_floor;
+  using safe_duration_cast::safe_floor_n;
+  using safe_duration_cast::safe_round;
+  using safe_duration_cast::safe_round_n;
+  verifyBatch<To>(in,
+                  floors,
+                  [](From x, int& ec) { return safe_floor<To>(x, ec); },
+                  [](const From* a, To* b, std::size_t n, std::uint64_t* m) {
+                    return safe_floor_n(a, b, n, m);
+                  });
+  verifyBatch<To>(in,
+                  ceils,
+                  [](From x, int& ec) { return safe_ceil<To>(x, ec); },
+                  [](const From* a, To* b, std::size_t n, std::uint64_t* m) {
+                    return safe_ceil_n(a, b, n, m);
+                  });
+  verifyBatch<To>(roundable,
+                  rounds,
+                  [](From x, int& ec) { return safe_round<To>(x, ec); },
+                  [](const From* a, To* b, std::size_t n, std::uint64_t* m) {
+                    return safe_round_n(a, b, n, m);
+                  });
+}
+
+template<typename To, typename From>
+std::intmax_t
+floored(From from, int& ec)
+{
+  return safe_duration_cast::safe_floor<To>(from, ec).count();
+}
+
+template<typename To, typename From>
+std::intmax_t
+ceiled(From from, int& ec)
+{
+  return safe_duration_cast::safe_ceil<To>(from, ec).count();
+}
+
+template<typename To, typename From>
+std::intmax_t
+rounded(From from, int& ec)
+{
+  return safe_duration_cast::safe_round<To>(from, ec).count();
+}
+} // namespace
+
+TEST_CASE("rounding integral durations")
+{
+  using namespace std::chrono;
+  int ec = 0;
+  REQUIRE(floored<seconds>(milliseconds{ -1500 }, ec) == -2);
+  REQUIRE(ceiled<seconds>(milliseconds{ -1500 }, ec) == -1);
+  REQUIRE(rounded<seconds>(milliseconds{ -1500 }, ec) == -2);
+  REQUIRE(rounded<seconds>(milliseconds{ -2500 }, ec) == -2);
+  REQUIRE(rounded<seconds>(milliseconds{ 2500 }, ec) == 2);
+  REQUIRE(rounded<seconds>(milliseconds{ 2501 }, ec) == 3);
+  REQUIRE(rounded<seconds>(Thirds{ 4 }, ec) == 1);
+  REQUIRE(rounded<seconds>(Thirds{ 5 }, ec) == 2);
+  REQUIRE(ec == 0);
+
+  // the adjustment would step past the edge of the representation
+  using L = std::numeric_limits<std::int64_t>;
+  REQUIRE(ceiled<seconds>(duration<std::int64_t, std::milli>{ L::max() }, ec) ==
+          L::max() / 1000 + 1);
+  REQUIRE(ec == 0);
+  REQUIRE(ceiled<Millis32>(microseconds{ 2147483647001 }, ec) == 0);
+  REQUIRE(ec == 1);
+  REQUIRE(floored<Millis32>(microseconds{ 2147483647999 }, ec) == 2147483647);
+  REQUIRE(ec == 0);
+  REQUIRE(floored<Millis32>(microseconds{ -2147483648001 }, ec) == 0);
+  REQUIRE(ec == 1);
+  REQUIRE(floored<UnsignedSeconds>(milliseconds{ -1 }, ec) == 0);
+  REQUIRE(ec == 1);
+  REQUIRE(ceiled<UnsignedSeconds>(milliseconds{ -1 }, ec) == 0);
+  REQUIRE(ec == 0);
+  REQUIRE(rounded<UnsignedSeconds>(milliseconds{ -500 }, ec) == 0);
+  REQUIRE(ec == 0);
+  REQUIRE(rounded<UnsignedSeconds>(milliseconds{ -501 }, ec) == 0);
+  REQUIRE(ec == 1);
+
+  verifyIntegral<seconds, milliseconds>();
+  verifyIntegral<seconds, nanoseconds>();
+  verifyIntegral<minutes, seconds>();
+  verifyIntegral<Millis32, microseconds>();
+  verifyIntegral<UnsignedSeconds, milliseconds>();
+  verifyIntegral<UnsignedMillis, microseconds>();
+  verifyIntegral<seconds, Thirds>();
+  verifyIntegral<Thirds, milliseconds>();
+  verifyIntegral<nanoseconds, seconds>();
+  verifyIntegral<Minutes8, duration<std::int8_t>>();
+  verifyIntegral<milliseconds, milliseconds>();
+}
+
+TEST_CASE("rounding floating point durations")
+{
+  using std::chrono::milliseconds;
+  using std::chrono::seconds;
+  using L = std::numeric_limits<double>;
+  int ec = 0;
+  REQUIRE(floored<seconds>(FloatSeconds{ -1.5 }, ec) == -2);
+  REQUIRE(ceiled<seconds>(FloatSeconds{ -1.5 }, ec) == -1);
+  REQUIRE(rounded<seconds>(FloatSeconds{ -1.5 }, ec) == -2);
+  REQUIRE(rounded<seconds>(FloatSeconds{ 2.5 }, ec) == 2);
+  REQUIRE(rounded<seconds>(FloatSeconds{ -2.5 }, ec) == -2);
+  REQUIRE(rounded<seconds>(FloatSeconds{ 2.5000001 }, ec) == 3);
+  REQUIRE(rounded<seconds>(FloatSeconds{ 0.49999999999999994 }, ec) == 0);
+  REQUIRE(floored<milliseconds>(FloatSeconds{ 0.0015 }, ec) == 1);
+  REQUIRE(ceiled<UnsignedSeconds>(FloatSeconds{ -0.5 }, ec) == 0);
+  REQUIRE(ec == 0);
+  floored<UnsignedSeconds>(FloatSeconds{ -0.5 }, ec);
+  REQUIRE(ec == 1);
+  ceiled<UnsignedSeconds>(FloatSeconds{ 4294967295.5 }, ec);
+  REQUIRE(ec == 1);
+  REQUIRE(floored<UnsignedSeconds>(FloatSeconds{ 4294967295.5 }, ec) ==
+          4294967295);
+  REQUIRE(ec == 0);
+  floored<seconds>(FloatSeconds{ L::quiet_NaN() }, ec);
+  REQUIRE(ec == 1);
+  ceiled<seconds>(FloatSeconds{ L::infinity() }, ec);
+  REQUIRE(ec == 1);
+
+  // quarter milliseconds are exact, so the reference can round them
+  std::vector<FloatMillis> in;
+  std::vector<expectation> floors;
+  std::vector<expectation> ceils;
+  std::vector<expectation> rounds;
+  for (int i = -20000; i <= 20000; i += 7) {
+    in.push_back(FloatMillis{ i * 250.0 });
+    const std::intmax_t f = i >= 0 ? i / 4 : -((-i + 3) / 4);
+    const std::intmax_t c = i % 4 == 0 ? f : f + 1;
+    const bool tie = i % 4 == 2 || i % 4 == -2;
+    floors.push_back({ 0, f });
+    ceils.push_back({ 0, c });
+    rounds.push_back(
+      { 0, tie ? (f % 2 == 0 ? f : c) : (i - 4 * f < 2 ? f : c) });
+  }
+  in.push_back(FloatMillis{ L::quiet_NaN() });
+  in.push_back(FloatMillis{ -1e300 });
+  floors.push_back({ 1, 0 });
+  floors.push_back({ 1, 0 });
+  ceils.push_back({ 1, 0 });
+  ceils.push_back({ 1, 0 });
+  rounds.push_back({ 1, 0 });
+  rounds.push_back({ 1, 0 });
+
+  using safe_duration_cast::safe_ceil;
+  using safe_duration_cast::safe_ceil_n;
+  using safe_duration_cast::safe_floor;
+  using safe_duration_cast::safe_floor_n;
+  using safe_duration_cast::safe_round;
+  using safe_duration_cast::safe_round_n;
+  verifyBatch<seconds>(
+    in,
+    floors,
+    [](FloatMillis x, int& ec) { return safe_floor<seconds>(x, ec); },
+    [](const FloatMillis* a, seconds* b, std::size_t n, std::uint64_t* m) {
+      return safe_floor_n(a, b, n, m);
+    });
+  verifyBatch<seconds>(
+    in,
+    ceils,
+    [](FloatMillis x, int& ec) { return safe_ceil<seconds>(x, ec); },
+    [](const FloatMillis* a, seconds* b, std::size_t n, std::uint64_t* m) {
+      return safe_ceil_n(a, b, n, m);
+    });
+  verifyBatch<seconds>(
+    in,
+    rounds,
+    [](FloatMillis x, int& ec) { return safe_round<seconds>(x, ec); },
+    [](const FloatMillis* a, seconds* b, std::size_t n, std::uint64_t* m) {
+      return safe_round_n(a, b, n, m);
+    });
+}
+
+#if SAFE_CHRONO_CONV_HAVE_EXCEPTIONS
+TEST_CASE("throwing rounding")
+{
+  using std::chrono::milliseconds;
+  REQUIRE(safe_duration_cast::safe_floor<UnsignedSeconds>(milliseconds{ 1 }) ==
+          UnsignedSeconds{ 0 });
+  REQUIRE_THROWS(
+    safe_duration_cast::safe_floor<UnsignedSeconds>(milliseconds{ -1 }));
+  REQUIRE_THROWS(safe_duration_cast::safe_ceil<Millis32>(
+    std::chrono::microseconds{ 2147483647001 }));
+  REQUIRE_THROWS(
+    safe_duration_cast::safe_round<std::chrono::seconds>(FloatMillis{ 1e300 }));
+}
+#endif
@@ -0,0 +1,154 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <ratio>
+#include <safe_duration_cast/runtime_converter.hpp>
+#include <safe_duration_cast/safe_range.hpp>
+#include <vector>
+
+using safe_duration_cast::runtime_duration_converter;
+
+namespace {
+// verifies that the converter set up from the ratio between the periods
+// agrees with safe_duration_cast, one at a time and in batches
+template<typename From, typename To>
+void
+verifyAgainstCompileTime()
+{
+  using FromRep = typename From::rep;
+  using ToRep = typename To::rep;
+  using Factor = std::ratio_divide<typename From::period, typename To::period>;
+  using L = std::numeric_limits<FromRep>;
+  using Range = safe_duration_cast::safe_range<From, To>;
+
+  int ec = 1;
+  const runtime_duration_converter<FromRep, ToRep> conv(
+    Factor::num, Factor::den, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(conv.min_count() == Range::min().count());
+  REQUIRE(conv.max_count() == Range::max().count());
+
+  std::vector<FromRep> in{ L::min(),
+                           static_cast<FromRep>(L::min() + 1),
+                           L::max(),
+                           static_cast<FromRep>(L::max() - 1),
+                           0,
+                           1,
+                           static_cast<FromRep>(-1),
+                           conv.min_count(),
+                           conv.max_count() };
+  if (conv.min_count() != L::min()) {
+    in.push_back(static_cast<FromRep>(conv.min_count() - 1));
+  }
+  if (conv.max_count() != L::max()) {
+    in.push_back(static_cast<FromRep>(conv.max_count() + 1));
+  }
+  std::mt19937_64 rng(1234);
+  for (int i = 0; i < 2000; ++i) {
+    // spread out over all magnitudes
+    const auto x = static_cast<FromRep>(rng() >> (rng() % 64));
+    in.push_back(x);
+  }
+
+  std::vector<ToRep> out(in.size());
+  std::vector<std::uint64_t> failmask(
+    safe_duration_cast::batch_mask_words(in.size()));
+  const auto summary =
+    conv.convert_n(in.data(), out.data(), in.size(), failmask.data());
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int expected_ec = 0;
+    const To expected =
+      safe_duration_cast::safe_duration_cast<To>(From{ in[i] }, expected_ec);
+    int actual_ec = 0;
+    const ToRep actual = conv.convert(in[i], actual_ec);
+    REQUIRE(actual_ec == expected_ec);
+    REQUIRE(actual == expected.count());
+    const bool failed = (failmask[i / 64] >> (i % 64)) & 1U;
+    REQUIRE(failed == (expected_ec != 0));
+    REQUIRE(out[i] == expected.count());
+    failures += failed;
+  }
+  REQUIRE(summary.failures == failures);
+}
+} // namespace
+
+TEST_CASE("runtime converter agrees with safe_duration_cast")
+{
+  using std::chrono::duration;
+  verifyAgainstCompileTime<std::chrono::seconds, std::chrono::seconds>();
+  verifyAgainstCompileTime<std::chrono::seconds, std::chrono::nanoseconds>();
+  verifyAgainstCompileTime<std::chrono::nanoseconds, std::chrono::seconds>();
+  verifyAgainstCompileTime<duration<std::int64_t, std::ratio<7, 3>>,
+                           duration<std::int32_t, std::milli>>();
+  verifyAgainstCompileTime<duration<std::int32_t, std::ratio<1, 90000>>,
+                           duration<std::int64_t, std::ratio<1, 44100>>>();
+  verifyAgainstCompileTime<duration<std::uint64_t, std::micro>,
+                           duration<std::int64_t, std::ratio<1, 30>>>();
+  verifyAgainstCompileTime<duration<std::int64_t, std::micro>,
+                           duration<std::uint32_t, std::milli>>();
+  verifyAgainstCompileTime<duration<std::int8_t, std::ratio<3>>,
+                           duration<std::int16_t, std::ratio<1, 7>>>();
+  // too large to split, the exact path needs 128 bits
+  verifyAgainstCompileTime<
+    duration<std::int64_t, std::ratio<1099511627777>>,
+    duration<std::int64_t, std::ratio<1073741823>>>();
+}
+
+TEST_CASE("runtime converter reduces the ratio and picks a kernel")
+{
+  using Conv = runtime_duration_converter<std::int64_t, std::int64_t>;
+  const Conv ms_to_us(2000, 2);
+  REQUIRE(ms_to_us.num() == 1000);
+  REQUIRE(ms_to_us.den() == 1);
+  REQUIRE(ms_to_us.selected_kernel() == Conv::kernel::multiply);
+  REQUIRE(Conv(3, 3000).selected_kernel() == Conv::kernel::divide);
+  REQUIRE(Conv(6, 6).selected_kernel() == Conv::kernel::identity);
+  REQUIRE(Conv(6, 4).selected_kernel() == Conv::kernel::multiply_divide);
+  REQUIRE(Conv(6, 4).num() == 3);
+  REQUIRE(Conv(6, 4).den() == 2);
+  REQUIRE(ms_to_us.convert(-7) == -7000);
+}
+
+TEST_CASE("runtime converter with an invalid ratio")
+{
+  int ec = 0;
+  const runtime_duration_converter<int, int> conv(1, 0, ec);
+  REQUIRE(ec == 1);
+  REQUIRE(conv.convert(0, ec) == 0);
+  REQUIRE(ec == 1);
+  const int in[3] = { 0, 1, -1 };
+  int out[3] = { 1, 1, 1 };
+  REQUIRE(conv.convert_n(in, out, 3).failures == 3);
+  REQUIRE(out[0] == 0);
+  REQUIRE_THROWS(runtime_duration_converter<int, int>(-1, 1));
+  REQUIRE_THROWS(runtime_duration_converter<int, int>(2, 1).convert(
+    std::numeric_limits<int>::max()));
+}
+
+TEST_CASE("runtime converter in place")
+{
+  // large enough that count*num overflows, so the exact path is taken
+  const runtime_duration_converter<std::int64_t, std::int64_t> conv(7, 3);
+  std::vector<std::int64_t> v(200);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    v[i] = std::numeric_limits<std::int64_t>::max() / 4 -
+           static_cast<std::int64_t>(i);
+  }
+  const std::vector<std::int64_t> orig = v;
+  const auto summary = conv.convert_n(v.data(), v.data(), v.size());
+  REQUIRE(summary.failures == 0);
+  for (std::size_t i = 0; i < v.size(); ++i) {
+    REQUIRE(v[i] == conv.convert(orig[i]));
+  }
+}
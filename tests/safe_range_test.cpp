@@ -0,0 +1,102 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <safe_duration_cast/safe_range.hpp>
+
+using safe_duration_cast::safe_range;
+
+namespace {
+// true if the conversion of count succeeds
+template<typename From, typename To>
+bool
+converts(typename From::rep count)
+{
+  int ec = 0;
+  safe_duration_cast::safe_duration_cast<To>(From{ count }, ec);
+  return ec == 0;
+}
+
+// verifies that the ends of the safe range convert, and their neighbours
+// outside of it do not
+template<typename From, typename To>
+void
+verifyEnds()
+{
+  using L = std::numeric_limits<typename From::rep>;
+  constexpr auto lo = safe_range<From, To>::min().count();
+  constexpr auto hi = safe_range<From, To>::max().count();
+  REQUIRE(converts<From, To>(lo));
+  REQUIRE(converts<From, To>(hi));
+  if (lo != L::min()) {
+    REQUIRE_FALSE(converts<From, To>(lo - 1));
+  }
+  if (hi != L::max()) {
+    REQUIRE_FALSE(converts<From, To>(hi + 1));
+  }
+}
+
+// verifies the range against every value of a small From
+template<typename From, typename To>
+void
+verifyAll()
+{
+  using L = std::numeric_limits<typename From::rep>;
+  for (long v = L::min(); v <= static_cast<long>(L::max()); ++v) {
+    const From from{ static_cast<typename From::rep>(v) };
+    REQUIRE(converts<From, To>(from.count()) ==
+            safe_range<From, To>::contains(from));
+  }
+}
+} // namespace
+
+TEST_CASE("safe range is known at compile time")
+{
+  using Seconds = std::chrono::duration<std::int32_t>;
+  using Millis = std::chrono::duration<std::int32_t, std::milli>;
+  static_assert(safe_range<Seconds, Millis>::max().count() == 2147483, "");
+  static_assert(safe_range<Seconds, Millis>::min().count() == -2147483, "");
+  static_assert(safe_range<Millis, Seconds>::max() == Millis::max(), "");
+}
+
+TEST_CASE("safe range ends")
+{
+  using namespace std::chrono;
+  using R35 = std::ratio<3, 5>;
+  using R53 = std::ratio<5, 3>;
+  verifyEnds<seconds, nanoseconds>();
+  verifyEnds<nanoseconds, seconds>();
+  verifyEnds<hours, nanoseconds>();
+  verifyEnds<duration<std::int64_t, R35>, duration<std::int64_t, R53>>();
+  verifyEnds<duration<std::uint64_t, R35>, duration<std::int64_t, R53>>();
+  verifyEnds<duration<std::int64_t, R53>, duration<std::uint64_t, R35>>();
+  verifyEnds<duration<std::int64_t, R53>, duration<std::int32_t, R35>>();
+  verifyEnds<duration<std::int64_t, std::femto>,
+             duration<std::uint8_t, std::ratio<3600>>>();
+  // num and den are too large to split
+  using Big = std::ratio<(std::int64_t{ 1 } << 40) + 1>;
+  using Odd = std::ratio<(std::int64_t{ 1 } << 30) - 1>;
+  verifyEnds<duration<std::int64_t, Big>, duration<std::int64_t, Odd>>();
+  verifyEnds<duration<std::int64_t, Odd>, duration<std::uint64_t, Big>>();
+}
+
+TEST_CASE("safe range exhaustive")
+{
+  using namespace std::chrono;
+  using R35 = std::ratio<3, 5>;
+  using R53 = std::ratio<5, 3>;
+  verifyAll<duration<std::int16_t, R35>, duration<std::int8_t, R53>>();
+  verifyAll<duration<std::int16_t, R53>, duration<std::uint8_t, R35>>();
+  verifyAll<duration<std::uint16_t, std::milli>, duration<std::int8_t>>();
+  verifyAll<duration<std::int8_t>, duration<std::uint16_t, std::milli>>();
+  verifyAll<duration<std::int16_t, std::milli>, duration<bool>>();
+}
@@ -0,0 +1,128 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/saturate.hpp>
+#include <vector>
+
+#include "testsupport.hpp"
+
+using safe_duration_cast::saturate_duration_cast;
+
+TEST_CASE("saturate integral")
+{
+  using Seconds = std::chrono::duration<std::int64_t>;
+  using Millis = std::chrono::duration<std::int32_t, std::milli>;
+  REQUIRE(saturate_duration_cast<Millis>(Seconds{ 3 }).count() == 3000);
+  REQUIRE(saturate_duration_cast<Millis>(Seconds{ -3 }).count() == -3000);
+  REQUIRE(saturate_duration_cast<Millis>(Seconds{ 1 << 30 }) == Millis::max());
+  REQUIRE(saturate_duration_cast<Millis>(Seconds{ -(1 << 30) }) ==
+          Millis::min());
+  REQUIRE(saturate_duration_cast<Millis>(Seconds::max()) == Millis::max());
+  REQUIRE(saturate_duration_cast<Millis>(Seconds::min()) == Millis::min());
+
+  // sign changes
+  using Unsigned = std::chrono::duration<std::uint16_t>;
+  REQUIRE(saturate_duration_cast<Unsigned>(Seconds{ -1 }).count() == 0);
+  REQUIRE(saturate_duration_cast<Unsigned>(Seconds{ 65536 }) ==
+          Unsigned::max());
+  using Big = std::chrono::duration<std::uint64_t>;
+  REQUIRE(saturate_duration_cast<Seconds>(Big::max()) == Seconds::max());
+}
+
+TEST_CASE("saturate floating point")
+{
+  using L = std::numeric_limits<double>;
+  using Seconds = std::chrono::duration<double>;
+  using Nanos = std::chrono::duration<float, std::nano>;
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ 1.5 }).count() == 1.5e9f);
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ 1e300 }) == Nanos::max());
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ -1e300 }) == Nanos::min());
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ L::infinity() }).count() ==
+          std::numeric_limits<float>::infinity());
+  REQUIRE(std::isnan(
+    saturate_duration_cast<Nanos>(Seconds{ L::quiet_NaN() }).count()));
+}
+
+TEST_CASE("saturate floating point to integral")
+{
+  using L = std::numeric_limits<double>;
+  using Seconds = std::chrono::duration<double>;
+  using Nanos = std::chrono::duration<std::int64_t, std::nano>;
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ 1.5 }).count() == 1500000000);
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ 1e10 }) == Nanos::max());
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ -1e10 }) == Nanos::min());
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ L::infinity() }) ==
+          Nanos::max());
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ -L::infinity() }) ==
+          Nanos::min());
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ L::quiet_NaN() }).count() ==
+          0);
+  REQUIRE(saturate_duration_cast<Nanos>(Seconds{ -L::quiet_NaN() }).count() ==
+          0);
+}
+
+template<typename From, typename To>
+void
+verifyBatch(const std::vector<From>& in)
+{
+  const std::size_t n = in.size();
+  std::vector<To> out(n);
+  std::vector<std::uint64_t> mask(safe_duration_cast::batch_mask_words(n));
+  const auto result = safe_duration_cast::saturate_duration_cast_n(
+    in.data(), out.data(), n, mask.data());
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    int ec = 0;
+    safe_duration_cast::safe_duration_cast<To>(in[i], ec);
+    REQUIRE(((mask[i / 64] >> (i % 64)) & 1) == (ec != 0 ? 1U : 0U));
+    failures += ec != 0;
+    REQUIRE(out[i] == saturate_duration_cast<To>(in[i]));
+  }
+  REQUIRE(result.failures == failures);
+
+  // in place, if the representation is the same
+  const auto inplace = tests::convertInPlace<To>(
+    in, [](const From* first, To* result, std::size_t count) {
+      safe_duration_cast::saturate_duration_cast_n(first, result, count);
+    });
+  if (!inplace.empty()) {
+    REQUIRE(inplace == out);
+  }
+}
+
+TEST_CASE("saturate batch")
+{
+  using Seconds = std::chrono::duration<std::int64_t>;
+  using Millis = std::chrono::duration<std::int32_t, std::milli>;
+  std::vector<Seconds> in;
+  for (int i = 0; i < 150; ++i) {
+    in.push_back(Seconds{ (i % 3 - 1) * std::int64_t{ i } * 100000 });
+  }
+  verifyBatch<Seconds, Millis>(in);
+
+  // negative overflow must saturate to min, also in place
+  using Millis64 = std::chrono::duration<std::int64_t, std::milli>;
+  const std::int64_t big = std::numeric_limits<std::int64_t>::max() / 10;
+  in.push_back(Seconds{ -big });
+  in.push_back(Seconds{ big });
+  verifyBatch<Seconds, Millis64>(in);
+
+  using Double = std::chrono::duration<double>;
+  using Nanos = std::chrono::duration<std::int64_t, std::nano>;
+  std::vector<Double> din;
+  for (int i = 0; i < 70; ++i) {
+    din.push_back(Double{ (i % 3 - 1) * 1e8 * i });
+  }
+  din.push_back(Double{ std::numeric_limits<double>::quiet_NaN() });
+  verifyBatch<Double, Nanos>(din);
+}
@@ -17,6 +17,12 @@
 #error "no 128 bit integer types available"
 #endif
 
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
 namespace tests {
 // make a 128 bit integer type
 #if HAVE_INT128_TYPE
@@ -29,4 +35,82 @@ using Int128_t = boost::multiprecision::int128_t;
 #else
 #error "no 128 bit type available"
 #endif
+
+/**
+ * counts near the edges of Rep, around zero, and random ones of every
+ * magnitude, per_magnitude of each. more(x, ret) may append values derived
+ * from each random x, like multiples of a denominator.
+ */
+template<typename Rep, typename More>
+std::vector<Rep>
+counts(More more, int per_magnitude = 20)
+{
+  using L = std::numeric_limits<Rep>;
+  std::vector<Rep> ret;
+  for (int i = 0; i < 100; ++i) {
+    ret.push_back(static_cast<Rep>(L::min() + i));
+    ret.push_back(static_cast<Rep>(L::max() - i));
+    ret.push_back(static_cast<Rep>(i - 50));
+  }
+  std::mt19937_64 rng(2019);
+  for (int shift = 0; shift < 64; ++shift) {
+    for (int i = 0; i < per_magnitude; ++i) {
+      const auto x = static_cast<Rep>(rng() >> shift);
+      ret.push_back(x);
+      more(x, ret);
+    }
+  }
+  return ret;
+}
+
+template<typename Rep>
+std::vector<Rep>
+counts(int per_magnitude = 20)
+{
+  return counts<Rep>([](Rep, std::vector<Rep>&) {}, per_magnitude);
+}
+
+// the same, as durations
+template<typename Dur, typename... More>
+std::vector<Dur>
+durations(More... more)
+{
+  std::vector<Dur> ret;
+  for (const auto count : counts<typename Dur::rep>(more...)) {
+    ret.push_back(Dur{ count });
+  }
+  return ret;
+}
+
+template<typename To, typename From, typename CastN>
+std::vector<To>
+convertInPlace(const std::vector<From>& in, CastN cast_n, std::true_type)
+{
+  std::vector<From> data = in;
+  To* const out = reinterpret_cast<To*>(data.data());
+  cast_n(data.data(), out, data.size());
+  return std::vector<To>(out, out + data.size());
+}
+
+template<typename To, typename From, typename CastN>
+std::vector<To>
+convertInPlace(const std::vector<From>&, CastN, std::false_type)
+{
+  return {};
+}
+
+/**
+ * runs cast_n(in, out, n) with out in the same array as in, and returns
+ * the result. that needs the same representation, so if From and To have
+ * different ones, nothing is converted and the result is empty.
+ */
+template<typename To, typename From, typename CastN>
+std::vector<To>
+convertInPlace(const std::vector<From>& in, CastN cast_n)
+{
+  return convertInPlace<To>(
+    in,
+    cast_n,
+    std::is_same<typename From::rep, typename To::rep>{});
+}
 }
@@ -0,0 +1,129 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ */
+#include <catch.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <safe_duration_cast/time_point.hpp>
+#include <vector>
+
+using safe_duration_cast::safe_time_point_cast;
+
+namespace {
+using Clock = std::chrono::system_clock;
+using Nanos = std::chrono::duration<std::int64_t, std::nano>;
+using Micros = std::chrono::duration<std::int64_t, std::micro>;
+using Seconds32 = std::chrono::duration<std::int32_t>;
+using NanoTP = std::chrono::time_point<Clock, Nanos>;
+using MicroTP = std::chrono::time_point<Clock, Micros>;
+using SecondTP = std::chrono::time_point<Clock, Seconds32>;
+
+// a clock with its epoch at 2000-01-01, like some wire formats
+struct WireClock
+{
+  using duration = Micros;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<WireClock>;
+  static constexpr bool is_steady = false;
+};
+using WireTP = WireClock::time_point;
+// the system clock epoch, 1970-01-01, on the wire clock
+const std::chrono::seconds unix_epoch_on_wire{ -946684800 };
+} // namespace
+
+TEST_CASE("time point cast")
+{
+  int ec = 0;
+  const NanoTP t{ Nanos{ 1500000123456LL } };
+  REQUIRE(safe_time_point_cast<MicroTP>(t, ec).time_since_epoch().count() ==
+          1500000123);
+  REQUIRE(ec == 0);
+  REQUIRE(safe_time_point_cast<SecondTP>(t, ec).time_since_epoch().count() ==
+          1500);
+  REQUIRE(ec == 0);
+
+  // seconds since 1970 do not fit in 32 bits beyond 2038
+  const MicroTP late{ Micros{ std::int64_t{ 1 } << 52 } };
+  safe_time_point_cast<SecondTP>(late, ec);
+  REQUIRE(ec != 0);
+  const SecondTP s{ Seconds32::max() };
+  safe_time_point_cast<NanoTP>(s, ec);
+  REQUIRE(ec == 0);
+  safe_time_point_cast<NanoTP>(MicroTP::max(), ec);
+  REQUIRE(ec != 0);
+}
+
+TEST_CASE("time point cast with epoch offset")
+{
+  int ec = 0;
+  // 2000-01-01 00:00:00.000001500 on the system clock
+  const NanoTP t{ Nanos{ 946684800000001500LL } };
+  const WireTP w = safe_time_point_cast<WireTP>(t, unix_epoch_on_wire, ec);
+  REQUIRE(ec == 0);
+  REQUIRE(w.time_since_epoch().count() == 1);
+  // and back again
+  const NanoTP back = safe_time_point_cast<NanoTP>(
+    w, -std::chrono::duration_cast<Micros>(unix_epoch_on_wire), ec);
+  REQUIRE(ec == 0);
+  REQUIRE(back.time_since_epoch().count() == 946684800000001000LL);
+
+  // the sum is truncated once, not each term separately
+  const NanoTP before{ Nanos{ -500 } };
+  REQUIRE(safe_time_point_cast<MicroTP>(before, Nanos{ 1000 }, ec)
+            .time_since_epoch()
+            .count() == 0);
+  REQUIRE(ec == 0);
+
+  // overflow in the sum
+  safe_time_point_cast<NanoTP>(NanoTP::max(), Nanos{ 1 }, ec);
+  REQUIRE(ec != 0);
+  // the offset does not fit in the common type
+  safe_time_point_cast<MicroTP>(NanoTP{}, std::chrono::hours::max(), ec);
+  REQUIRE(ec != 0);
+}
+
+TEST_CASE("time point batch")
+{
+  std::vector<MicroTP> in;
+  for (int i = 0; i < 200; ++i) {
+    const std::int64_t sign = i % 2 ? 1 : -1;
+    in.push_back(MicroTP{ Micros{ sign * (std::int64_t{ 1 } << (i % 64)) } });
+  }
+  const std::size_t words = safe_duration_cast::batch_mask_words(in.size());
+  std::vector<std::uint64_t> mask(words);
+
+  std::vector<NanoTP> out(in.size());
+  auto result = safe_duration_cast::safe_time_point_cast_n(
+    in.data(), out.data(), in.size(), mask.data());
+  std::size_t failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int ec = 0;
+    const auto expected = safe_time_point_cast<NanoTP>(in[i], ec);
+    REQUIRE(out[i] == expected);
+    REQUIRE(((mask[i / 64] >> (i % 64)) & 1) == (ec != 0 ? 1U : 0U));
+    failures += ec != 0;
+  }
+  REQUIRE(result.failures == failures);
+  REQUIRE(failures > 0);
+
+  const Nanos offset{ std::numeric_limits<std::int64_t>::max() / 2 };
+  std::vector<NanoTP> shifted(in.size());
+  result = safe_duration_cast::safe_time_point_cast_n(
+    in.data(), shifted.data(), in.size(), offset, mask.data());
+  failures = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    int ec = 0;
+    const auto expected = safe_time_point_cast<NanoTP>(in[i], offset, ec);
+    REQUIRE(shifted[i] == expected);
+    REQUIRE(((mask[i / 64] >> (i % 64)) & 1) == (ec != 0 ? 1U : 0U));
+    failures += ec != 0;
+  }
+  REQUIRE(result.failures == failures);
+}
@@ -0,0 +1,431 @@
+/*
+ * By Paul Dreik 2019
+ *
+ * License:
+ * dual license, pick your choice. Either Boost license 1.0, or GPL(v2 or later,
+ * at your option).
+ *
+ * Converts a file of native endian int64 timestamps to another unit, and
+ * optionally to another epoch. The file is memory mapped and converted in
+ * parallel parts with safe_duration_cast_n, or safe_time_point_cast_n if the
+ * epoch is shifted. The byte offsets of the timestamps which could not be
+ * converted are written to a sidecar file, one per line, and they are zero in
+ * the output.
+ *
+ * With --baseline, std::chrono::duration_cast is used instead, without any
+ * checks, to see what the checks cost.
+ */
+
+#include <safe_duration_cast/batch.hpp>
+#include <safe_duration_cast/parallel_reduce.hpp>
+#include <safe_duration_cast/parse.hpp>
+#include <safe_duration_cast/time_point.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ratio>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const usage =
+  "usage: convert_timestamps [options] input [output]\n"
+  "\n"
+  "converts a file of native endian int64 timestamps. without output, the\n"
+  "input is converted in place, which needs 64 bit output.\n"
+  "\n"
+  "  --from UNIT        unit of the input, ns, us, ms or s (default ns)\n"
+  "  --to UNIT          unit of the output, ns, us, ms or s (default us)\n"
+  "  --bits N           32 or 64 bit output (default 64)\n"
+  "  --shift DURATION   added to each input timestamp before it is\n"
+  "                     converted, like -946684800s to move a unix time to\n"
+  "                     the year 2000 epoch. a whole number of input units.\n"
+  "  --threads N        threads to use (default one per hardware thread)\n"
+  "  --failures PATH    where to write the byte offsets of the timestamps\n"
+  "                     which failed (default output.failures)\n"
+  "  --huge-pages       ask for transparent huge pages for the mappings\n"
+  "  --baseline         convert with std::chrono::duration_cast, without\n"
+  "                     checks, and write no failures\n";
+
+struct Options
+{
+  std::string input;
+  std::string output;
+  std::string failures;
+  int from = 0;
+  int to = 1;
+  int bits = 64;
+  std::chrono::nanoseconds shift{ 0 };
+  unsigned threads = 0;
+  bool huge_pages = false;
+  bool baseline = false;
+};
+
+// the units, as index into this
+const char* const unitNames[] = { "ns", "us", "ms", "s" };
+
+int
+unitIndex(const std::string& name)
+{
+  for (int i = 0; i < 4; ++i) {
+    if (name == unitNames[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool
+parseOptions(int argc, char* argv[], Options& options)
+{
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--from" && has_value) {
+      options.from = unitIndex(argv[++i]);
+    } else if (arg == "--to" && has_value) {
+      options.to = unitIndex(argv[++i]);
+    } else if (arg == "--bits" && has_value) {
+      options.bits = std::atoi(argv[++i]);
+    } else if (arg == "--shift" && has_value) {
+      int ec = 0;
+      options.shift =
+        safe_duration_cast::safe_parse_duration<std::chrono::nanoseconds>(
+          argv[++i], ec);
+      if (ec) {
+        std::cerr << "invalid shift " << argv[i] << "\n";
+        return false;
+      }
+    } else if (arg == "--threads" && has_value) {
+      options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else if (arg == "--failures" && has_value) {
+      options.failures = argv[++i];
+    } else if (arg == "--huge-pages") {
+      options.huge_pages = true;
+    } else if (arg == "--baseline") {
+      options.baseline = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      return false;
+    } else {
+      positional.push_back(arg);
+    }
+  }
+  if (positional.empty() || positional.size() > 2 || options.from < 0 ||
+      options.to < 0 || (options.bits != 32 && options.bits != 64)) {
+    return false;
+  }
+  options.input = positional[0];
+  if (positional.size() == 2) {
+    options.output = positional[1];
+  } else if (options.bits != 64) {
+    std::cerr << "converting in place needs 64 bit output\n";
+    return false;
+  }
+  if (options.failures.empty()) {
+    options.failures =
+      (options.output.empty() ? options.input : options.output) + ".failures";
+  }
+  return true;
+}
+
+// a file mapped into memory, unmapped and closed when it goes out of scope
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile()
+  {
+    if (m_data != MAP_FAILED) {
+      ::munmap(m_data, m_size);
+    }
+    if (m_fd >= 0) {
+      ::close(m_fd);
+    }
+  }
+
+  // maps an existing file, for writing as well if writable is set
+  bool open(const std::string& path, bool writable)
+  {
+    m_fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    struct stat st;
+    if (m_fd < 0 || ::fstat(m_fd, &st) != 0) {
+      return false;
+    }
+    return map(static_cast<std::size_t>(st.st_size), writable);
+  }
+
+  // creates or truncates a file of the given size, and maps it for writing
+  bool create(const std::string& path, std::size_t size)
+  {
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0 || ::ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+      return false;
+    }
+    return map(size, true);
+  }
+
+  // tells the kernel that the mapping is read from start to end, once
+  void advise(bool huge_pages)
+  {
+    if (m_data == MAP_FAILED) {
+      return;
+    }
+#ifdef MADV_SEQUENTIAL
+    ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_HUGEPAGE
+    // only has an effect if the kernel supports huge pages for the page
+    // cache of this file system
+    if (huge_pages) {
+      ::madvise(m_data, m_size, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  void* data() const { return m_size != 0 ? m_data : nullptr; }
+  std::size_t size() const { return m_size; }
+
+private:
+  bool map(std::size_t size, bool writable)
+  {
+    m_size = size;
+    if (size == 0) {
+      // mmap does not take empty ranges
+      return true;
+    }
+    m_data = ::mmap(nullptr,
+                    size,
+                    PROT_READ | (writable ? PROT_WRITE : 0),
+                    MAP_SHARED,
+                    m_fd,
+                    0);
+    return m_data != MAP_FAILED;
+  }
+
+  int m_fd = -1;
+  void* m_data = MAP_FAILED;
+  std::size_t m_size = 0;
+};
+
+// the indices of the failed timestamps in a part of the file, in order
+struct Failures
+{
+  std::vector<std::uint64_t> indices;
+
+  void add(const Failures& other)
+  {
+    indices.insert(indices.end(), other.indices.begin(), other.indices.end());
+  }
+};
+
+// the time points in the files, which only differ in their epochs
+struct InputEpoch
+{};
+struct OutputEpoch
+{};
+
+template<typename FromPeriod, typename ToPeriod, typename ToRep>
+Failures
+convert(const Options& options,
+        const void* input,
+        void* output,
+        std::size_t n,
+        int& ec)
+{
+  using From = std::chrono::duration<std::int64_t, FromPeriod>;
+  using To = std::chrono::duration<ToRep, ToPeriod>;
+  using FromTP = std::chrono::time_point<InputEpoch, From>;
+  using ToTP = std::chrono::time_point<OutputEpoch, To>;
+
+  const From shift =
+    safe_duration_cast::exact_duration_cast<From>(options.shift, ec);
+  if (ec) {
+    std::cerr << "the shift is not a whole number of "
+              << unitNames[options.from] << "\n";
+    return Failures{};
+  }
+  const bool shifted = shift != From::zero();
+
+  // the parts are this many elements, so the failure masks are small
+  constexpr std::size_t chunk = std::size_t{ 1 } << 16;
+  const auto convertPart = [&](std::size_t first, std::size_t len) {
+    Failures failures;
+    std::vector<std::uint64_t> failmask(
+      safe_duration_cast::batch_mask_words(chunk));
+    for (std::size_t offset = first; offset < first + len; offset += chunk) {
+      const std::size_t m = std::min(chunk, first + len - offset);
+      if (options.baseline) {
+        const From* in = static_cast<const From*>(input) + offset;
+        To* out = static_cast<To*>(output) + offset;
+        for (std::size_t i = 0; i < m; ++i) {
+          out[i] = std::chrono::duration_cast<To>(in[i] + shift);
+        }
+        continue;
+      }
+      const safe_duration_cast::batch_result result =
+        shifted
+          ? safe_duration_cast::safe_time_point_cast_n(
+              static_cast<const FromTP*>(input) + offset,
+              static_cast<ToTP*>(output) + offset,
+              m,
+              shift,
+              failmask.data())
+          : safe_duration_cast::safe_duration_cast_n<To>(
+              static_cast<const From*>(input) + offset,
+              static_cast<To*>(output) + offset,
+              m,
+              failmask.data());
+      if (result.failures == 0) {
+        continue;
+      }
+      const std::size_t words = safe_duration_cast::batch_mask_words(m);
+      for (std::size_t w = 0; w < words; ++w) {
+        for (std::uint64_t bits = failmask[w]; bits != 0; bits &= bits - 1) {
+          const int j = safe_duration_cast::detail::countr_zero64(bits);
+          failures.indices.push_back(offset + 64 * w +
+                                     static_cast<std::size_t>(j));
+        }
+      }
+    }
+    return failures;
+  };
+  return safe_duration_cast::detail::parallel_reduction(options.threads)
+    .run<Failures>(n, convertPart);
+}
+
+template<typename FromPeriod, typename ToPeriod>
+Failures
+convertTo(const Options& options,
+          const void* input,
+          void* output,
+          std::size_t n,
+          int& ec)
+{
+  if (options.bits == 32) {
+    return convert<FromPeriod, ToPeriod, std::int32_t>(
+      options, input, output, n, ec);
+  }
+  return convert<FromPeriod, ToPeriod, std::int64_t>(
+    options, input, output, n, ec);
+}
+
+template<typename FromPeriod>
+Failures
+convertFrom(const Options& options,
+            const void* input,
+            void* output,
+            std::size_t n,
+            int& ec)
+{
+  switch (options.to) {
+    case 0:
+      return convertTo<FromPeriod, std::nano>(options, input, output, n, ec);
+    case 1:
+      return convertTo<FromPeriod, std::micro>(options, input, output, n, ec);
+    case 2:
+      return convertTo<FromPeriod, std::milli>(options, input, output, n, ec);
+  }
+  return convertTo<FromPeriod, std::ratio<1>>(options, input, output, n, ec);
+}
+
+Failures
+convertAny(const Options& options,
+           const void* input,
+           void* output,
+           std::size_t n,
+           int& ec)
+{
+  switch (options.from) {
+    case 0:
+      return convertFrom<std::nano>(options, input, output, n, ec);
+    case 1:
+      return convertFrom<std::micro>(options, input, output, n, ec);
+    case 2:
+      return convertFrom<std::milli>(options, input, output, n, ec);
+  }
+  return convertFrom<std::ratio<1>>(options, input, output, n, ec);
+}
+
+bool
+writeFailures(const std::string& path, const Failures& failures)
+{
+  std::ofstream out(path);
+  for (const auto index : failures.indices) {
+    out << index * sizeof(std::int64_t) << '\n';
+  }
+  return static_cast<bool>(out);
+}
+
+} // namespace
+
+int
+main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  const bool in_place = options.output.empty();
+  MappedFile input;
+  if (!input.open(options.input, in_place)) {
+    std::cerr << "can not map " << options.input << ": "
+              << std::strerror(errno) << "\n";
+    return EXIT_FAILURE;
+  }
+  if (input.size() % sizeof(std::int64_t) != 0) {
+    std::cerr << options.input << " is not a whole number of int64\n";
+    return EXIT_FAILURE;
+  }
+  const std::size_t n = input.size() / sizeof(std::int64_t);
+  input.advise(options.huge_pages);
+
+  MappedFile output;
+  void* out = input.data();
+  if (!in_place) {
+    if (!output.create(options.output, n * (options.bits / 8))) {
+      std::cerr << "can not map " << options.output << ": "
+                << std::strerror(errno) << "\n";
+      return EXIT_FAILURE;
+    }
+    output.advise(options.huge_pages);
+    out = output.data();
+  }
+
+  int ec = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  const Failures failures = convertAny(options, input.data(), out, n, ec);
+  const auto t1 = std::chrono::steady_clock::now();
+  if (ec) {
+    return EXIT_FAILURE;
+  }
+  const auto elapsed_seconds =
+    std::chrono::duration_cast<std::chrono::duration<double>>(t1 - t0).count();
+
+  if (!options.baseline && !writeFailures(options.failures, failures)) {
+    std::cerr << "can not write " << options.failures << "\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << (options.baseline ? "duration_cast" : "safe_duration_cast")
+            << ": converted " << n << " timestamps from "
+            << unitNames[options.from] << " to " << unitNames[options.to]
+            << " in " << elapsed_seconds << " s, "
+            << static_cast<double>(input.size()) / elapsed_seconds * 1e-9
+            << " GB/s, failures=" << failures.indices.size() << "\n";
+}